@@ -0,0 +1,39 @@
+/// ***************************************************************************
+/// @file    adc.c
+/// @author  NeoProg
+/// @brief   Host stand-in for ADC driver. Conversion completes immediately
+/// ***************************************************************************
+#include "adc.h"
+#include "project-base.h"
+#include "host-hal.h"
+
+// Reverse of system monitor calculation: VIN-[10k]-OUT-[3k3]-GND, 12 bit, 3.3V
+#define VOLTAGE_TO_BINS(mv)             ((uint32_t)((mv) * 3300.0f / 13300.0f * 4096.0f / 3300.0f))
+
+static bool adc_data_is_updated = false;
+static uint16_t adc_data = VOLTAGE_TO_BINS(12600);
+
+
+void adc_init(void) {
+    adc_data_is_updated = false;
+}
+
+void adc_start_conversion(void) {
+    adc_data_is_updated = true;
+}
+
+bool adc_is_conversion_complete(void) {
+    return adc_data_is_updated;
+}
+
+uint16_t adc_read(void) {
+    return adc_data;
+}
+
+
+
+
+
+void host_adc_set_battery_voltage(uint32_t voltage_mv) {
+    adc_data = VOLTAGE_TO_BINS(voltage_mv);
+}
@@ -0,0 +1,154 @@
+/// ***************************************************************************
+/// @file    host-clock.c
+/// @author  NeoProg
+/// @brief   Simulated clock for host build
+/// @note    Single thread and deterministic. Time advances only at polling
+///          points of host stand-ins, due events are dispatched there as
+///          interrupts. Events with equal time are dispatched by slot order
+/// ***************************************************************************
+#include "project-base.h"
+#include "host-hal.h"
+
+#define EVENT_DISABLED                  (UINT64_MAX)
+
+
+static uint64_t current_time_us = 0;
+static uint64_t poll_cost_us = HOST_CLOCK_DEFAULT_POLL_COST_US;
+static uint64_t event_time_us[HOST_EVENTS_COUNT];
+static host_clock_handler_t event_handlers[HOST_EVENTS_COUNT];
+static bool is_dispatching = false;
+static bool is_initialized = false;
+
+
+static void init_events(void);
+
+
+/// ***************************************************************************
+/// @brief  Reset clock and stop all events
+/// ***************************************************************************
+void host_clock_reset(void) {
+    current_time_us = 0;
+    for (uint32_t i = 0; i < HOST_EVENTS_COUNT; ++i) {
+        event_time_us[i] = EVENT_DISABLED;
+    }
+    is_initialized = true;
+}
+
+/// ***************************************************************************
+/// @brief  Get current time
+/// @return time [us]
+/// ***************************************************************************
+uint64_t host_clock_get_time_us(void) {
+    return current_time_us;
+}
+
+/// ***************************************************************************
+/// @brief  Set CPU cost of one polling point
+/// @param  cost_us: cost [us]
+/// ***************************************************************************
+void host_clock_set_poll_cost(uint64_t cost_us) {
+    poll_cost_us = cost_us;
+}
+
+/// ***************************************************************************
+/// @brief  Polling point. Firmware code waits something here
+/// ***************************************************************************
+void host_clock_poll(void) {
+    host_clock_advance_us(poll_cost_us);
+}
+
+/// ***************************************************************************
+/// @brief  Advance time and dispatch due events
+/// @note   Call from event handler (interrupt context) only spends time,
+///         events are dispatched after handler return
+/// @param  delta_us: time delta [us]
+/// ***************************************************************************
+void host_clock_advance_us(uint64_t delta_us) {
+    init_events();
+    uint64_t end_time_us = current_time_us + delta_us;
+    if (is_dispatching || __get_interrupt_state() != 0) {
+        current_time_us = end_time_us;
+        return;
+    }
+
+    is_dispatching = true;
+    while (true) {
+        // Find nearest event
+        uint32_t event = HOST_EVENTS_COUNT;
+        for (uint32_t i = 0; i < HOST_EVENTS_COUNT; ++i) {
+            if (event_time_us[i] <= end_time_us && (event == HOST_EVENTS_COUNT || event_time_us[i] < event_time_us[event])) {
+                event = i;
+            }
+        }
+        if (event == HOST_EVENTS_COUNT) {
+            break;
+        }
+
+        // Handler can spend time (end of interrupt can be later than event)
+        if (event_time_us[event] > current_time_us) {
+            current_time_us = event_time_us[event];
+        }
+        event_time_us[event] = EVENT_DISABLED;
+        if (event_handlers[event]) {
+            event_handlers[event]();
+        }
+        if (current_time_us > end_time_us) {
+            end_time_us = current_time_us;
+        }
+    }
+    current_time_us = end_time_us;
+    is_dispatching = false;
+}
+
+/// ***************************************************************************
+/// @brief  Set event handler
+/// @param  event: event slot
+/// @param  handler: handler, called from interrupt context
+/// ***************************************************************************
+void host_clock_set_handler(host_clock_event_t event, host_clock_handler_t handler) {
+    init_events();
+    event_handlers[event] = handler;
+}
+
+/// ***************************************************************************
+/// @brief  Start one-shot event
+/// @note   Restart event if it already started
+/// @param  event: event slot
+/// @param  delay_us: delay from current time [us]
+/// ***************************************************************************
+void host_clock_start_event(host_clock_event_t event, uint64_t delay_us) {
+    init_events();
+    event_time_us[event] = current_time_us + delay_us;
+}
+
+/// ***************************************************************************
+/// @brief  Stop event
+/// @param  event: event slot
+/// ***************************************************************************
+void host_clock_stop_event(host_clock_event_t event) {
+    init_events();
+    event_time_us[event] = EVENT_DISABLED;
+}
+
+/// ***************************************************************************
+/// @brief  Check event is started
+/// @param  event: event slot
+/// @return true - event started, false - no
+/// ***************************************************************************
+bool host_clock_is_event_started(host_clock_event_t event) {
+    init_events();
+    return event_time_us[event] != EVENT_DISABLED;
+}
+
+
+
+
+
+/// ***************************************************************************
+/// @brief  Lazy events initialization. Events are stopped after power on
+/// ***************************************************************************
+static void init_events(void) {
+    if (!is_initialized) {
+        host_clock_reset();
+    }
+}
@@ -0,0 +1,102 @@
+/// ***************************************************************************
+/// @file    host-i2c.c
+/// @author  NeoProg
+/// @brief   Common I2C bus model for host stand-ins of I2C drivers
+/// @note    Transfer spends bus time on host clock. Missing device - NACK
+/// ***************************************************************************
+#include "project-base.h"
+#include "host-i2c.h"
+
+#define I2C_BITS_PER_BYTE               (9) // 8 data bits + ACK
+#define I2C_FRAME_OVERHEAD_BITS         (2) // START + STOP
+
+
+static const host_i2c_device_t* find_device(host_i2c_bus_t* bus, uint8_t i2c_address);
+static void spend_bus_time(host_i2c_bus_t* bus, uint32_t bytes_count);
+
+
+/// ***************************************************************************
+/// @brief  Bus initialization
+/// @note   Attached devices are kept
+/// @param  bus: bus
+/// @param  speed_hz: bus speed [Hz]
+/// ***************************************************************************
+void host_i2c_init(host_i2c_bus_t* bus, uint32_t speed_hz) {
+    bus->speed_hz = speed_hz;
+}
+
+/// ***************************************************************************
+/// @brief  Attach device model to bus
+/// @param  bus: bus
+/// @param  i2c_address: device address (8 bit format, as in drivers)
+/// @param  device: device model, NULL - detach device
+/// ***************************************************************************
+void host_i2c_attach(host_i2c_bus_t* bus, uint8_t i2c_address, const host_i2c_device_t* device) {
+    for (uint32_t i = 0; i < HOST_I2C_MAX_DEVICES_COUNT; ++i) {
+        if (bus->slots[i].device != NULL && bus->slots[i].i2c_address == i2c_address) {
+            bus->slots[i].device = device;
+            return;
+        }
+    }
+    for (uint32_t i = 0; i < HOST_I2C_MAX_DEVICES_COUNT; ++i) {
+        if (bus->slots[i].device == NULL) {
+            bus->slots[i].i2c_address = i2c_address;
+            bus->slots[i].device = device;
+            return;
+        }
+    }
+}
+
+/// ***************************************************************************
+/// @brief  Read data from I2C device
+/// @return true - success, false - error
+/// ***************************************************************************
+bool host_i2c_read(host_i2c_bus_t* bus, uint8_t i2c_address, uint32_t internal_address, uint8_t internal_address_size, uint8_t* buffer, uint8_t bytes_count) {
+    const host_i2c_device_t* device = find_device(bus, i2c_address);
+    if (device == NULL || device->read == NULL) {
+        spend_bus_time(bus, 1);
+        return false;
+    }
+    spend_bus_time(bus, 2 + internal_address_size + bytes_count); // Address twice (write and read phases)
+    return device->read(internal_address, buffer, bytes_count);
+}
+
+/// ***************************************************************************
+/// @brief  Write data to I2C device
+/// @return true - success, false - error
+/// ***************************************************************************
+bool host_i2c_write(host_i2c_bus_t* bus, uint8_t i2c_address, uint32_t internal_address, uint8_t internal_address_size, const uint8_t* data, uint8_t bytes_count) {
+    const host_i2c_device_t* device = find_device(bus, i2c_address);
+    if (device == NULL || device->write == NULL) {
+        spend_bus_time(bus, 1);
+        return false;
+    }
+    spend_bus_time(bus, 1 + internal_address_size + bytes_count);
+    return device->write(internal_address, data, bytes_count);
+}
+
+
+
+
+
+/// ***************************************************************************
+/// @brief  Find device on bus
+/// @return device model, NULL - no device
+/// ***************************************************************************
+static const host_i2c_device_t* find_device(host_i2c_bus_t* bus, uint8_t i2c_address) {
+    for (uint32_t i = 0; i < HOST_I2C_MAX_DEVICES_COUNT; ++i) {
+        if (bus->slots[i].device != NULL && bus->slots[i].i2c_address == i2c_address) {
+            return bus->slots[i].device;
+        }
+    }
+    return NULL;
+}
+
+/// ***************************************************************************
+/// @brief  Spend time for bytes transfer
+/// ***************************************************************************
+static void spend_bus_time(host_i2c_bus_t* bus, uint32_t bytes_count) {
+    uint32_t speed_hz = bus->speed_hz ? bus->speed_hz : 100000;
+    uint64_t bits = (uint64_t)bytes_count * I2C_BITS_PER_BYTE + I2C_FRAME_OVERHEAD_BITS;
+    host_clock_advance_us((bits * 1000000 + speed_hz - 1) / speed_hz);
+}
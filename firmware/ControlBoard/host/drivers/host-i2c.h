@@ -0,0 +1,30 @@
+/// ***************************************************************************
+/// @file    host-i2c.h
+/// @author  NeoProg
+/// @brief   Common I2C bus model for host stand-ins of I2C drivers
+/// ***************************************************************************
+#ifndef _HOST_I2C_H_
+#define _HOST_I2C_H_
+#include "host-hal.h"
+
+#define HOST_I2C_MAX_DEVICES_COUNT          (4)
+
+
+typedef struct {
+    uint8_t i2c_address;
+    const host_i2c_device_t* device;
+} host_i2c_slot_t;
+
+typedef struct {
+    uint32_t speed_hz;
+    host_i2c_slot_t slots[HOST_I2C_MAX_DEVICES_COUNT];
+} host_i2c_bus_t;
+
+
+extern void host_i2c_init(host_i2c_bus_t* bus, uint32_t speed_hz);
+extern void host_i2c_attach(host_i2c_bus_t* bus, uint8_t i2c_address, const host_i2c_device_t* device);
+extern bool host_i2c_read(host_i2c_bus_t* bus, uint8_t i2c_address, uint32_t internal_address, uint8_t internal_address_size, uint8_t* buffer, uint8_t bytes_count);
+extern bool host_i2c_write(host_i2c_bus_t* bus, uint8_t i2c_address, uint32_t internal_address, uint8_t internal_address_size, const uint8_t* data, uint8_t bytes_count);
+
+
+#endif // _HOST_I2C_H_
@@ -0,0 +1,37 @@
+/// ***************************************************************************
+/// @file    host-mcu.c
+/// @author  NeoProg
+/// @brief   Peripheral registers and core functions for host build
+/// ***************************************************************************
+#include "project-base.h"
+#include "host-hal.h"
+
+
+// Clock ready flags are set, because nobody on host will set them
+host_mcu_t host_mcu = {
+    .rcc = {
+        .CR   = RCC_CR_HSIRDY | RCC_CR_HSERDY | RCC_CR_PLLRDY,
+        .CFGR = RCC_CFGR_SWS_PLL
+    }
+};
+__istate_t host_interrupt_state = 0;
+
+static uint32_t nvic_enabled_irq[4] = {0};
+static uint8_t  nvic_priority[128] = {0};
+
+
+void host_nvic_enable_irq(int32_t irq) {
+    if (irq >= 0) nvic_enabled_irq[irq >> 5] |= (1u << (irq & 0x1F));
+}
+void host_nvic_disable_irq(int32_t irq) {
+    if (irq >= 0) nvic_enabled_irq[irq >> 5] &= ~(1u << (irq & 0x1F));
+}
+void host_nvic_set_priority(int32_t irq, uint32_t priority) {
+    if (irq >= 0) nvic_priority[irq] = (uint8_t)priority;
+}
+bool host_nvic_is_irq_enabled(int32_t irq) {
+    return irq < 0 || (nvic_enabled_irq[irq >> 5] & (1u << (irq & 0x1F))) != 0;
+}
+void host_nvic_system_reset(void) {
+    exit(EXIT_SUCCESS);
+}
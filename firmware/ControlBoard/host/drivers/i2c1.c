@@ -0,0 +1,82 @@
+/// ***************************************************************************
+/// @file    i2c1.c
+/// @author  NeoProg
+/// @brief   Host stand-in for I2C1 driver. Devices are host models
+/// ***************************************************************************
+#include "project-base.h"
+#include "i2c1.h"
+#include "host-i2c.h"
+
+
+static host_i2c_bus_t i2c_bus = {0};
+
+
+/// ***************************************************************************
+/// @brief  I2C initialization
+/// @param  speed: I2C speed. @Ref i2c1_speed_t
+/// ***************************************************************************
+void i2c1_init(i2c1_speed_t speed) {
+    host_i2c_init(&i2c_bus, (speed == I2C1_SPEED_400KHZ) ? 400000 : 100000);
+}
+
+/// ***************************************************************************
+/// @brief  Read data from I2C device
+/// @return true - success, false - error
+/// ***************************************************************************
+bool i2c1_read(uint8_t i2c_address, uint32_t internal_address, uint8_t internal_address_size, uint8_t* buffer, uint8_t bytes_count) {
+    return host_i2c_read(&i2c_bus, i2c_address, internal_address, internal_address_size, buffer, bytes_count);
+}
+
+/// ***************************************************************************
+/// @brief  Wrappers for read function
+/// @return readed value, 0 - error
+/// ***************************************************************************
+uint8_t i2c1_read8(uint8_t i2c_address, uint32_t internal_address, uint8_t internal_address_size) {
+    uint8_t data = 0;
+    if (!i2c1_read(i2c_address, internal_address, internal_address_size, &data, 1)) {
+        return 0;
+    }
+    return data;
+}
+uint16_t i2c1_read16(uint8_t i2c_address, uint32_t internal_address, uint8_t internal_address_size, bool is_msbf) {
+    uint8_t data[2] = {0};
+    if (!i2c1_read(i2c_address, internal_address, internal_address_size, data, 2)) {
+        return 0;
+    }
+    if (is_msbf) {
+        return make16(data[0], data[1]);
+    }
+    return make16(data[1], data[0]);
+}
+
+/// ***************************************************************************
+/// @brief  Write data to I2C device
+/// @return true - success, false - error
+/// ***************************************************************************
+bool i2c1_write(uint8_t i2c_address, uint32_t internal_address, uint8_t internal_address_size, uint8_t* data, uint8_t bytes_count) {
+    return host_i2c_write(&i2c_bus, i2c_address, internal_address, internal_address_size, data, bytes_count);
+}
+
+/// ***************************************************************************
+/// @brief  Wrappers for write function
+/// @return true - success, false - error
+/// ***************************************************************************
+bool i2c1_write8(uint8_t i2c_address, uint32_t internal_address, uint8_t internal_address_size, uint8_t data) {
+    return i2c1_write(i2c_address, internal_address, internal_address_size, &data, 1);
+}
+bool i2c1_write16(uint8_t i2c_address, uint32_t internal_address, uint8_t internal_address_size, uint16_t data) {
+    return i2c1_write(i2c_address, internal_address, internal_address_size, (uint8_t*)&data, 2);
+}
+
+
+
+
+
+/// ***************************************************************************
+/// @brief  Attach device model
+/// @param  i2c_address: device address
+/// @param  device: device model, NULL - detach device
+/// ***************************************************************************
+void host_i2c1_attach(uint8_t i2c_address, const host_i2c_device_t* device) {
+    host_i2c_attach(&i2c_bus, i2c_address, device);
+}
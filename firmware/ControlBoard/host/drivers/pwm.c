@@ -0,0 +1,211 @@
+/// ***************************************************************************
+/// @file    pwm.c
+/// @author  NeoProg
+/// @brief   Host stand-in for PWM driver. TIM17 is driven by host clock
+/// @note    TIM17 ISR spends time of waveform edges processing as firmware
+///          ISR and starts latest published widths or repeats previous ones.
+///          Motion tick spends configured CPU time on buffers swap
+/// ***************************************************************************
+#include "project-base.h"
+#include "pwm.h"
+#include "system-monitor.h"
+#include "host-hal.h"
+
+#define PWM_CHANNEL_DISABLE_VALUE           (0xFFFF)
+#define DEFAULT_TICK_COST_US                (250)
+#define ISR_EDGE_COST_US                    (1)
+#define PWM_SYNC_ERROR_HOLD_TICKS           (200)       // 1s at 200 Hz
+
+
+static uint32_t pwm_widths[SUPPORT_PWM_CHANNELS_COUNT];
+static uint32_t pwm_published_widths[SUPPORT_PWM_CHANNELS_COUNT];
+static uint32_t pwm_active_widths[SUPPORT_PWM_CHANNELS_COUNT];
+static uint32_t pwm_frequency = PWM_START_FREQUENCY_HZ;
+static bool pwm_published = false;
+static bool pwm_ready = false;
+static uint32_t pwm_overruns_count = 0;
+static uint32_t pwm_last_overruns_count = 0;
+static uint32_t pwm_sync_error_hold_ticks = 0;
+static uint64_t tick_cost_us = DEFAULT_TICK_COST_US;
+static uint64_t periods_count = 0;
+
+
+static void tim17_event_handler(void);
+
+
+/// ***************************************************************************
+/// @brief  PWM driver initialization
+/// @param  frequency: frequency [Hz]
+/// ***************************************************************************
+void pwm_init(uint32_t frequency) {
+    pwm_frequency = frequency;
+    for (uint32_t i = 0; i < SUPPORT_PWM_CHANNELS_COUNT; ++i) {
+        pwm_widths[i] = PWM_CHANNEL_DISABLE_VALUE;
+        pwm_published_widths[i] = PWM_CHANNEL_DISABLE_VALUE;
+        pwm_active_widths[i] = PWM_CHANNEL_DISABLE_VALUE;
+    }
+    pwm_published = true;
+    NVIC_EnableIRQ(TIM17_IRQn);
+    NVIC_SetPriority(TIM17_IRQn, TIM17_IRQ_PRIORITY);
+    host_clock_set_handler(HOST_EVENT_TIM17, tim17_event_handler);
+}
+
+/// ***************************************************************************
+/// @brief  PWM enable/disable
+/// @param  is_enable: true - PWM enable, false - PWM disable
+/// ***************************************************************************
+void pwm_set_state(bool is_enable) {
+    if (is_enable) {
+        if (!host_clock_is_event_started(HOST_EVENT_TIM17)) {
+            host_clock_start_event(HOST_EVENT_TIM17, 1000000 / pwm_frequency);
+        }
+    } else {
+        host_clock_stop_event(HOST_EVENT_TIM17);
+    }
+}
+
+/// ***************************************************************************
+/// @brief  Get PWM frequency
+/// @return frequency [Hz]
+/// ***************************************************************************
+uint32_t pwm_get_frequency(void) {
+    return pwm_frequency;
+}
+
+/// ***************************************************************************
+/// @brief  Publish channels pulse widths
+/// @note   Swap finishes motion tick, so tick CPU time is spent here.
+///         Overruns are reported by SYSMON_SYNC_ERROR as in firmware driver
+/// ***************************************************************************
+void pwm_swap_buffers(void) {
+    host_clock_advance_us(tick_cost_us);
+    memcpy(pwm_published_widths, pwm_widths, sizeof(pwm_widths));
+    pwm_published = true;
+
+    // Report overruns by SYSMON_SYNC_ERROR. Error is cleared after
+    // PWM_SYNC_ERROR_HOLD_TICKS ticks without overruns
+    uint32_t overruns_count = pwm_overruns_count;
+    if (overruns_count != pwm_last_overruns_count) {
+        pwm_last_overruns_count = overruns_count;
+        pwm_sync_error_hold_ticks = PWM_SYNC_ERROR_HOLD_TICKS;
+        sysmon_set_error(SYSMON_SYNC_ERROR);
+    } else if (pwm_sync_error_hold_ticks != 0 && --pwm_sync_error_hold_ticks == 0) {
+        sysmon_clear_error(SYSMON_SYNC_ERROR);
+    }
+}
+
+/// ***************************************************************************
+/// @brief  Check PWM ready for load pulse width
+/// @note   Polling point
+/// ***************************************************************************
+bool pwm_is_ready(void) {
+    host_clock_poll();
+    if (pwm_published) {
+        return false;
+    }
+    bool f = pwm_ready;
+    pwm_ready = false;
+    return f;
+}
+
+/// ***************************************************************************
+/// @brief  Get overruns count
+/// @return overruns count
+/// ***************************************************************************
+uint32_t pwm_get_overruns_count(void) {
+    return pwm_overruns_count;
+}
+
+#ifndef NDEBUG
+/// ***************************************************************************
+/// @brief  Get edge timing statistics
+/// @note   Edges are not measured on host: simulated clock does not model
+///         edge error and ISR latency
+/// @return NULL - statistics is not available
+/// ***************************************************************************
+const pwm_stats_t* pwm_get_stats(void) {
+    return NULL;
+}
+
+/// ***************************************************************************
+/// @brief  Reset edge timing statistics
+/// ***************************************************************************
+void pwm_reset_stats(void) {
+}
+#endif
+
+/// ***************************************************************************
+/// @brief  Set PWM channel pulse width
+/// @param  channel: PWM channel index
+/// @param  width: pulse width
+/// ***************************************************************************
+void pwm_set_width(uint32_t channel, uint32_t width) {
+    pwm_widths[channel] = width;
+}
+
+
+
+
+
+/// ***************************************************************************
+/// @brief  Set CPU time of motion tick
+/// @param  cost_us: time [us]
+/// ***************************************************************************
+void host_pwm_set_tick_cost(uint64_t cost_us) {
+    tick_cost_us = cost_us;
+}
+
+/// ***************************************************************************
+/// @brief  Get pulse width of last PWM period
+/// @param  ch: channel index
+/// @return pulse width [us]
+/// ***************************************************************************
+uint32_t host_pwm_get_width(uint32_t ch) {
+    return (ch < SUPPORT_PWM_CHANNELS_COUNT) ? pwm_active_widths[ch] : PWM_CHANNEL_DISABLE_VALUE;
+}
+
+/// ***************************************************************************
+/// @brief  Get PWM periods count
+/// @return periods count
+/// ***************************************************************************
+uint64_t host_pwm_get_periods_count(void) {
+    return periods_count;
+}
+
+/// ***************************************************************************
+/// @brief  PWM timer ISR
+/// ***************************************************************************
+static void tim17_event_handler(void) {
+    uint32_t period_us = 1000000 / pwm_frequency;
+    host_clock_start_event(HOST_EVENT_TIM17, period_us);
+    if (!host_nvic_is_irq_enabled(TIM17_IRQn)) {
+        return;
+    }
+
+    if (pwm_published) {
+        memcpy(pwm_active_widths, pwm_published_widths, sizeof(pwm_active_widths));
+        pwm_published = false;
+    } else {
+        ++pwm_overruns_count;
+    }
+    ++periods_count;
+
+    // Create pulses. Each pulse end time costs short compare ISR, channels
+    // with equal width are reset by same ISR
+    uint32_t edges_count = 0;
+    for (uint32_t i = 0; i < SUPPORT_PWM_CHANNELS_COUNT; ++i) {
+        if (pwm_active_widths[i] > period_us) {
+            continue;
+        }
+        bool is_merged = false;
+        for (uint32_t j = 0; j < i; ++j) {
+            is_merged |= (pwm_active_widths[j] == pwm_active_widths[i]);
+        }
+        if (!is_merged) {
+            ++edges_count;
+        }
+    }
+    host_clock_advance_us(edges_count * ISR_EDGE_COST_US);
+
+    pwm_ready = true;
+}
@@ -0,0 +1,83 @@
+/// ***************************************************************************
+/// @file    systimer.c
+/// @author  NeoProg
+/// @brief   Host stand-in for system timer. SysTick is driven by host clock
+/// ***************************************************************************
+#include "systimer.h"
+#include "project-base.h"
+#include "host-hal.h"
+
+#define SYSTICK_PERIOD_US               (1000)
+
+
+static volatile uint64_t systime_ms = 0;
+static uint64_t systime_start_us = 0;
+
+
+static void systick_event_handler(void);
+
+
+/// ***************************************************************************
+/// @brief  System timer initialize
+/// ***************************************************************************
+void systimer_init(void) {
+    systime_ms = 0;
+    systime_start_us = host_clock_get_time_us();
+
+    SysTick->VAL = 0;
+    SysTick->LOAD = SYSTEM_CLOCK_FREQUENCY / 1000;
+    SysTick->CTRL = (1 << SysTick_CTRL_TICKINT_Pos) | (1 << SysTick_CTRL_CLKSOURCE_Pos) | (1 << SysTick_CTRL_ENABLE_Pos);
+    NVIC_EnableIRQ(SysTick_IRQn);
+
+    host_clock_set_handler(HOST_EVENT_SYSTICK, systick_event_handler);
+    host_clock_start_event(HOST_EVENT_SYSTICK, SYSTICK_PERIOD_US);
+}
+
+/// ***************************************************************************
+/// @brief  Get current time in milliseconds
+/// @note   Polling point
+/// @return Milliseconds
+/// ***************************************************************************
+uint64_t get_time_ms(void) {
+    host_clock_poll();
+    return systime_ms;
+}
+
+/// ***************************************************************************
+/// @brief  Get current time in microseconds
+/// @note   Not polling point, firmware reads time without waiting
+/// @return Microseconds
+/// ***************************************************************************
+uint64_t get_time_us(void) {
+    return host_clock_get_time_us() - systime_start_us;
+}
+
+/// ***************************************************************************
+/// @brief  Synchronous delay
+/// @note   Nobody will advance time while we are wait, so do it here
+/// @param  ms: time delay [ms]
+/// ***************************************************************************
+void delay_ms(uint32_t ms) {
+    host_clock_advance_us((uint64_t)ms * SYSTICK_PERIOD_US);
+}
+
+
+
+
+
+/// ***************************************************************************
+/// @brief  Systimer ISR
+/// ***************************************************************************
+void SysTick_Handler(void) {
+    ++systime_ms;
+}
+
+/// ***************************************************************************
+/// @brief  SysTick event of host clock
+/// ***************************************************************************
+static void systick_event_handler(void) {
+    host_clock_start_event(HOST_EVENT_SYSTICK, SYSTICK_PERIOD_US);
+    if (SysTick->CTRL & SysTick_CTRL_ENABLE_Msk) {
+        SysTick_Handler();
+    }
+}
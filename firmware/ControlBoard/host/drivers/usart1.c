@@ -0,0 +1,130 @@
+/// ***************************************************************************
+/// @file    usart1.c
+/// @author  NeoProg
+/// @brief   Host stand-in for USART1 driver. Line is connected to host side
+/// ***************************************************************************
+#include "usart1.h"
+#include "project-base.h"
+#include "host-hal.h"
+
+#define USART_CHAR_BITS                 (10)   // 8N1
+#define USART_RX_TIMEOUT_BITS           (35)   // 3.5 char timer
+
+
+static uint8_t  tx_buffer[USART1_TX_BUFFER_SIZE] = {0};
+static uint8_t  rx_buffer[512]  = {0};
+static uint32_t rx_bytes_count = 0;
+static bool     is_rx_enabled = false;
+static uint32_t usart_baud_rate = 1;
+static usart1_callbacks_t usart_callbacks;
+static host_usart_tx_handler_t host_tx_handler = NULL;
+
+
+static void rx_timeout_event_handler(void);
+static uint64_t get_transfer_time_us(uint32_t bits);
+
+
+/// ***************************************************************************
+/// @brief  USART initialization
+/// @param  baud_rate: USART baud rate
+/// ***************************************************************************
+void usart1_init(uint32_t baud_rate, usart1_callbacks_t* callbacks) {
+    usart_callbacks = *callbacks;
+    usart_baud_rate = baud_rate;
+    is_rx_enabled = false;
+    NVIC_EnableIRQ(USART1_IRQn);
+    NVIC_SetPriority(USART1_IRQn, USART1_IRQ_PRIORITY);
+    host_clock_set_handler(HOST_EVENT_USART1_RX, rx_timeout_event_handler);
+}
+
+/// ***************************************************************************
+/// @brief  USART start frame transmit
+/// @note   Synchronous, spends transfer time
+/// @param  bytes_count: bytes count for transmit
+/// ***************************************************************************
+void usart1_start_sync_tx(uint32_t bytes_count) {
+    if (bytes_count) {
+        if (bytes_count > sizeof(tx_buffer)) {
+            bytes_count = sizeof(tx_buffer);
+        }
+        host_clock_advance_us(get_transfer_time_us(bytes_count * USART_CHAR_BITS));
+        if (host_tx_handler) {
+            host_tx_handler(tx_buffer, bytes_count);
+        }
+    }
+}
+
+/// ***************************************************************************
+/// @brief  USART start frame receive
+/// ***************************************************************************
+void usart1_start_rx(void) {
+    host_clock_stop_event(HOST_EVENT_USART1_RX);
+    memset(rx_buffer, 0, sizeof(rx_buffer));
+    rx_bytes_count = 0;
+    is_rx_enabled = true;
+}
+
+/// ***************************************************************************
+/// @brief  Get USART TX buffer address
+/// @return TX buffer address
+/// ***************************************************************************
+uint8_t* usart1_get_tx_buffer(void) {
+    return tx_buffer;
+}
+
+/// ***************************************************************************
+/// @brief  Get USART RX buffer address
+/// @return RX buffer address
+/// ***************************************************************************
+uint8_t* usart1_get_rx_buffer(void) {
+    return rx_buffer;
+}
+
+
+
+
+
+/// ***************************************************************************
+/// @brief  Set handler for transmitted data
+/// @param  handler: handler, NULL - data is dropped
+/// ***************************************************************************
+void host_usart1_set_tx_handler(host_usart_tx_handler_t handler) {
+    host_tx_handler = handler;
+}
+
+/// ***************************************************************************
+/// @brief  Send frame to USART
+/// @note   Receive timeout interrupt is raised after frame transfer time
+/// @param  data: frame
+/// @param  bytes_count: frame size
+/// @return true - frame accepted, false - receiver is disabled
+/// ***************************************************************************
+bool host_usart1_receive(const uint8_t* data, uint32_t bytes_count) {
+    if (!is_rx_enabled || rx_bytes_count != 0) {
+        return false;
+    }
+    rx_bytes_count = (bytes_count < sizeof(rx_buffer)) ? bytes_count : sizeof(rx_buffer) - 1; // Keep null terminator
+    memcpy(rx_buffer, data, rx_bytes_count);
+    host_clock_start_event(HOST_EVENT_USART1_RX, get_transfer_time_us(bytes_count * USART_CHAR_BITS + USART_RX_TIMEOUT_BITS));
+    return true;
+}
+
+/// ***************************************************************************
+/// @brief  USART receive timeout interrupt
+/// ***************************************************************************
+static void rx_timeout_event_handler(void) {
+    if (!is_rx_enabled || !host_nvic_is_irq_enabled(USART1_IRQn)) {
+        return;
+    }
+    is_rx_enabled = false;
+    usart_callbacks.frame_received_callback(rx_bytes_count);
+}
+
+/// ***************************************************************************
+/// @brief  Calculate transfer time
+/// @param  bits: bits count
+/// @return time [us]
+/// ***************************************************************************
+static uint64_t get_transfer_time_us(uint32_t bits) {
+    return ((uint64_t)bits * 1000000 + usart_baud_rate - 1) / usart_baud_rate;
+}
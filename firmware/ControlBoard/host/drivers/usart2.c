@@ -0,0 +1,160 @@
+/// ***************************************************************************
+/// @file    usart2.c
+/// @author  NeoProg
+/// @brief   Host stand-in for USART2 driver with DMA. Line is connected to host side
+/// ***************************************************************************
+#include "usart2.h"
+#include "project-base.h"
+#include "host-hal.h"
+
+#define USART_CHAR_BITS                 (10)   // 8N1
+#define USART_RX_TIMEOUT_BITS           (35)   // 3.5 char timer
+
+
+static uint8_t  tx_buffer[64] = {0};
+static uint8_t  rx_buffer[64] = {0};
+static uint32_t tx_bytes_count = 0;
+static uint32_t rx_bytes_count = 0;
+static bool     is_rx_enabled = false;
+static bool     is_rx_overflow = false;
+static uint32_t usart_baud_rate = 1;
+static usart2_callbacks_t usart_callbacks;
+static host_usart_tx_handler_t host_tx_handler = NULL;
+
+
+static void dma_tx_event_handler(void);
+static void rx_event_handler(void);
+static uint64_t get_transfer_time_us(uint32_t bits);
+
+
+/// ***************************************************************************
+/// @brief  USART initialization
+/// @param  baud_rate: USART baud rate
+/// @param  callbacks: USART callbacks
+/// ***************************************************************************
+void usart2_init(uint32_t baud_rate, usart2_callbacks_t* callbacks) {
+    usart_callbacks = *callbacks;
+    usart_baud_rate = baud_rate;
+    is_rx_enabled = false;
+    NVIC_EnableIRQ(USART2_IRQn);
+    NVIC_SetPriority(USART2_IRQn, USART2_IRQ_PRIORITY);
+    NVIC_EnableIRQ(DMA1_Channel7_IRQn);
+    NVIC_SetPriority(DMA1_Channel7_IRQn, USART2_IRQ_PRIORITY);
+    NVIC_EnableIRQ(DMA1_Channel6_IRQn);
+    NVIC_SetPriority(DMA1_Channel6_IRQn, USART2_IRQ_PRIORITY);
+    host_clock_set_handler(HOST_EVENT_USART2_DMA_TX, dma_tx_event_handler);
+    host_clock_set_handler(HOST_EVENT_USART2_RX, rx_event_handler);
+}
+
+/// ***************************************************************************
+/// @brief  USART start frame transmit
+/// @note   DMA transfer complete interrupt is raised after transfer time
+/// @param  bytes_count: bytes count for transmit
+/// ***************************************************************************
+void usart2_start_tx(uint32_t bytes_count) {
+    tx_bytes_count = (bytes_count < sizeof(tx_buffer)) ? bytes_count : sizeof(tx_buffer);
+    host_clock_start_event(HOST_EVENT_USART2_DMA_TX, get_transfer_time_us(tx_bytes_count * USART_CHAR_BITS));
+}
+
+/// ***************************************************************************
+/// @brief  USART start frame receive
+/// ***************************************************************************
+void usart2_start_rx(void) {
+    host_clock_stop_event(HOST_EVENT_USART2_RX);
+    memset(rx_buffer, 0, sizeof(rx_buffer));
+    rx_bytes_count = 0;
+    is_rx_overflow = false;
+    is_rx_enabled = true;
+}
+
+/// ***************************************************************************
+/// @brief  Get USART TX buffer address
+/// @return TX buffer address
+/// ***************************************************************************
+uint8_t* usart2_get_tx_buffer(void) {
+    return tx_buffer;
+}
+
+/// ***************************************************************************
+/// @brief  Get USART RX buffer address
+/// @return RX buffer address
+/// ***************************************************************************
+uint8_t* usart2_get_rx_buffer(void) {
+    return rx_buffer;
+}
+
+
+
+
+
+/// ***************************************************************************
+/// @brief  Set handler for transmitted data
+/// @param  handler: handler, NULL - data is dropped
+/// ***************************************************************************
+void host_usart2_set_tx_handler(host_usart_tx_handler_t handler) {
+    host_tx_handler = handler;
+}
+
+/// ***************************************************************************
+/// @brief  Send frame to USART
+/// @note   Data is placed to RX buffer by DMA. Receive timeout interrupt is
+///         raised after frame transfer time, DMA transfer complete interrupt
+///         (buffer overflow) - after RX buffer is full
+/// @param  data: frame
+/// @param  bytes_count: frame size
+/// @return true - frame accepted, false - receiver is disabled
+/// ***************************************************************************
+bool host_usart2_receive(const uint8_t* data, uint32_t bytes_count) {
+    if (!is_rx_enabled || rx_bytes_count != 0) {
+        return false;
+    }
+    if (bytes_count >= sizeof(rx_buffer)) {
+        rx_bytes_count = sizeof(rx_buffer);
+        is_rx_overflow = true;
+        host_clock_start_event(HOST_EVENT_USART2_RX, get_transfer_time_us(rx_bytes_count * USART_CHAR_BITS));
+    } else {
+        rx_bytes_count = bytes_count;
+        host_clock_start_event(HOST_EVENT_USART2_RX, get_transfer_time_us(rx_bytes_count * USART_CHAR_BITS + USART_RX_TIMEOUT_BITS));
+    }
+    memcpy(rx_buffer, data, rx_bytes_count);
+    return true;
+}
+
+/// ***************************************************************************
+/// @brief  DMA channel interrupt for transmitter
+/// ***************************************************************************
+static void dma_tx_event_handler(void) {
+    if (!host_nvic_is_irq_enabled(DMA1_Channel7_IRQn)) {
+        return;
+    }
+    if (host_tx_handler) {
+        host_tx_handler(tx_buffer, tx_bytes_count);
+    }
+    usart_callbacks.frame_transmitted_callback();
+}
+
+/// ***************************************************************************
+/// @brief  USART receive timeout or DMA channel interrupt for receiver
+/// ***************************************************************************
+static void rx_event_handler(void) {
+    if (!is_rx_enabled) {
+        return;
+    }
+    is_rx_enabled = false;
+    if (is_rx_overflow) {
+        if (host_nvic_is_irq_enabled(DMA1_Channel6_IRQn)) {
+            usart_callbacks.frame_error_callback();
+        }
+    } else if (host_nvic_is_irq_enabled(USART2_IRQn)) {
+        usart_callbacks.frame_received_callback(rx_bytes_count);
+    }
+}
+
+/// ***************************************************************************
+/// @brief  Calculate transfer time
+/// @param  bits: bits count
+/// @return time [us]
+/// ***************************************************************************
+static uint64_t get_transfer_time_us(uint32_t bits) {
+    return ((uint64_t)bits * 1000000 + usart_baud_rate - 1) / usart_baud_rate;
+}
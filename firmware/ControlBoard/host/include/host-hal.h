@@ -0,0 +1,79 @@
+/// ***************************************************************************
+/// @file    host-hal.h
+/// @author  NeoProg
+/// @brief   Control interface of host stand-ins for drivers and modules
+/// @note    Host stand-ins implement driver interfaces (i2c1.h, usart2.h, etc.)
+///          and are linked instead of drivers from src/drivers
+/// ***************************************************************************
+#ifndef _HOST_HAL_H_
+#define _HOST_HAL_H_
+#include <stdint.h>
+#include <stdbool.h>
+
+#define HOST_CLOCK_DEFAULT_POLL_COST_US     (1)
+
+
+// Simulated clock. Events order is dispatch order for events with equal time
+typedef enum {
+    HOST_EVENT_TIM17,
+    HOST_EVENT_USART2_DMA_TX,
+    HOST_EVENT_USART2_RX,
+    HOST_EVENT_USART1_RX,
+    HOST_EVENT_SYSTICK,
+    HOST_EVENT_MPU6050,
+    HOST_EVENT_SIMULATOR,
+    HOST_EVENT_SIMULATOR_TRACE,
+    HOST_EVENT_SIMULATOR_FEET,
+    HOST_EVENTS_COUNT
+} host_clock_event_t;
+
+typedef void(*host_clock_handler_t)(void);
+
+extern void     host_clock_reset(void);
+extern uint64_t host_clock_get_time_us(void);
+extern void     host_clock_set_poll_cost(uint64_t cost_us);
+extern void     host_clock_poll(void);
+extern void     host_clock_advance_us(uint64_t delta_us);
+extern void     host_clock_set_handler(host_clock_event_t event, host_clock_handler_t handler);
+extern void     host_clock_start_event(host_clock_event_t event, uint64_t delay_us);
+extern void     host_clock_stop_event(host_clock_event_t event);
+extern bool     host_clock_is_event_started(host_clock_event_t event);
+
+// NVIC
+extern bool     host_nvic_is_irq_enabled(int32_t irq);
+
+// ADC
+extern void     host_adc_set_battery_voltage(uint32_t voltage_mv);
+
+// I2C buses. Device handlers return false for NACK
+typedef struct {
+    bool(*read)(uint32_t internal_address, uint8_t* buffer, uint32_t bytes_count);
+    bool(*write)(uint32_t internal_address, const uint8_t* data, uint32_t bytes_count);
+} host_i2c_device_t;
+
+extern void     host_i2c1_attach(uint8_t i2c_address, const host_i2c_device_t* device);
+extern void     host_i2c2_attach(uint8_t i2c_address, const host_i2c_device_t* device);
+
+// USART. TX handler is called when frame transmission is completed
+typedef void(*host_usart_tx_handler_t)(const uint8_t* data, uint32_t bytes_count);
+
+extern void     host_usart1_set_tx_handler(host_usart_tx_handler_t handler);
+extern bool     host_usart1_receive(const uint8_t* data, uint32_t bytes_count);
+extern void     host_usart2_set_tx_handler(host_usart_tx_handler_t handler);
+extern bool     host_usart2_receive(const uint8_t* data, uint32_t bytes_count);
+
+// PWM
+extern void     host_pwm_set_tick_cost(uint64_t cost_us);
+extern uint32_t host_pwm_get_width(uint32_t ch);
+extern uint64_t host_pwm_get_periods_count(void);
+
+// Servo driver stub
+extern float    host_servo_get_logic_angle(uint32_t ch);
+
+// Sensors core stub
+extern void     host_sensors_set_orientation(float x, float z);
+extern void     host_sensors_set_foot_contacts(uint32_t limbs_mask);
+extern void     host_sensors_clear_foot_contacts(void);
+
+
+#endif // _HOST_HAL_H_
@@ -0,0 +1,20 @@
+/// ***************************************************************************
+/// @file    host-nvic.h
+/// @author  NeoProg
+/// @brief   NVIC functions for host build (CMSIS_NVIC_VIRTUAL)
+/// ***************************************************************************
+#ifndef _HOST_NVIC_H_
+#define _HOST_NVIC_H_
+
+extern void host_nvic_enable_irq(int32_t irq);
+extern void host_nvic_disable_irq(int32_t irq);
+extern void host_nvic_set_priority(int32_t irq, uint32_t priority);
+extern void host_nvic_system_reset(void);
+
+#define NVIC_EnableIRQ(irq)                 host_nvic_enable_irq((int32_t)(irq))
+#define NVIC_DisableIRQ(irq)                host_nvic_disable_irq((int32_t)(irq))
+#define NVIC_SetPriority(irq, priority)     host_nvic_set_priority((int32_t)(irq), (priority))
+#define NVIC_SystemReset()                  host_nvic_system_reset()
+
+
+#endif // _HOST_NVIC_H_
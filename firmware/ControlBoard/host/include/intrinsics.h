@@ -0,0 +1,21 @@
+/// ***************************************************************************
+/// @file    intrinsics.h
+/// @author  NeoProg
+/// @brief   Host replacement of IAR intrinsic functions
+/// ***************************************************************************
+#ifndef _HOST_INTRINSICS_H_
+#define _HOST_INTRINSICS_H_
+#include <stdint.h>
+#include <assert.h>
+
+typedef uint32_t __istate_t;
+
+extern __istate_t host_interrupt_state;
+
+static inline void __disable_interrupt(void)              { host_interrupt_state = 1; }
+static inline void __enable_interrupt(void)               { host_interrupt_state = 0; }
+static inline __istate_t __get_interrupt_state(void)      { return host_interrupt_state; }
+static inline void __set_interrupt_state(__istate_t s)    { host_interrupt_state = s; }
+
+
+#endif // _HOST_INTRINSICS_H_
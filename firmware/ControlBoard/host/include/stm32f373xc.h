@@ -0,0 +1,51 @@
+/// ***************************************************************************
+/// @file    stm32f373xc.h
+/// @author  NeoProg
+/// @brief   Host replacement of the device header. Uses original CMSIS types
+///          and bit definitions, but places all peripherals in host RAM
+/// ***************************************************************************
+#ifndef _HOST_STM32F373XC_H_
+#define _HOST_STM32F373XC_H_
+#define CMSIS_NVIC_VIRTUAL
+#define CMSIS_NVIC_VIRTUAL_HEADER_FILE      "host-nvic.h"
+#include "../../CMSIS/STM32F3xx/stm32f373xc.h"
+
+
+typedef struct {
+    GPIO_TypeDef   gpio[6];                 // GPIOA..GPIOF
+    RCC_TypeDef    rcc;
+    FLASH_TypeDef  flash;
+    DBGMCU_TypeDef dbgmcu;
+    TIM_TypeDef    tim17;
+    SysTick_Type   systick;
+} host_mcu_t;
+
+extern host_mcu_t host_mcu;
+
+
+#undef GPIOA
+#undef GPIOB
+#undef GPIOC
+#undef GPIOD
+#undef GPIOE
+#undef GPIOF
+#undef RCC
+#undef FLASH
+#undef DBGMCU
+#undef TIM17
+#undef SysTick
+
+#define GPIOA                               (&host_mcu.gpio[0])
+#define GPIOB                               (&host_mcu.gpio[1])
+#define GPIOC                               (&host_mcu.gpio[2])
+#define GPIOD                               (&host_mcu.gpio[3])
+#define GPIOE                               (&host_mcu.gpio[4])
+#define GPIOF                               (&host_mcu.gpio[5])
+#define RCC                                 (&host_mcu.rcc)
+#define FLASH                               (&host_mcu.flash)
+#define DBGMCU                              (&host_mcu.dbgmcu)
+#define TIM17                               (&host_mcu.tim17)
+#define SysTick                             (&host_mcu.systick)
+
+
+#endif // _HOST_STM32F373XC_H_
@@ -0,0 +1,308 @@
+/// ***************************************************************************
+/// @file    sim-devices.c
+/// @author  NeoProg
+/// @brief   Models of I2C devices for firmware simulator
+/// @note    PCA9555 (I2C1): registers, foot sensors inputs and INT pin.
+///          MPU6050 (I2C2): registers, DMP memory banks with readback, FIFO
+///          with DMP packets (quaternion of hull orientation) and INT pin.
+///          SSD1306 (I2C2): accepts any write
+/// ***************************************************************************
+#include "project-base.h"
+#include "pca9555.h"
+#include "host-hal.h"
+#include "sim-devices.h"
+
+#define PCA9555_I2C_ADDRESS                 (0x40)
+#define PCA9555_INT_PIN                     GPIOB, 5
+#define PCA9555_REG_INPUT_0                 (0x00)
+#define PCA9555_REG_OUTPUT_0                (0x02)
+#define PCA9555_REG_CFG_0                   (0x06)
+#define PCA9555_REGS_COUNT                  (8)
+
+#define MPU6050_I2C_ADDRESS                 (0x68 << 1)
+#define MPU6050_INT_PIN                     GPIOA, 12
+#define MPU6050_REG_INT_ENABLE              (0x38)
+#define MPU6050_REG_USER_CTRL               (0x6A)
+#define MPU6050_REG_PWR_MGMT_1              (0x6B)
+#define MPU6050_REG_BANK_SEL                (0x6D)
+#define MPU6050_REG_MEM_START_ADDR          (0x6E)
+#define MPU6050_REG_MEM_R_W                 (0x6F)
+#define MPU6050_REG_FIFO_COUNTH             (0x72)
+#define MPU6050_REG_FIFO_COUNTL             (0x73)
+#define MPU6050_REG_FIFO_R_W                (0x74)
+#define MPU6050_REG_WHO_AM_I                (0x75)
+#define MPU6050_REGS_COUNT                  (128)
+#define MPU6050_MEMORY_SIZE                 (8 * 256)
+#define MPU6050_FIFO_SIZE                   (1024)
+#define MPU6050_FIFO_PACKET_SIZE            (18)
+#define MPU6050_DMP_PERIOD_US               (5000) // 200Hz
+#define MPU6050_USER_CTRL_DMP_FIFO_EN       (0xC0)
+#define MPU6050_USER_CTRL_FIFO_RESET        (0x04)
+#define MPU6050_INT_ENABLE_DMP              (0x02)
+
+#define SSD1306_I2C_ADDRESS                 (0x3C << 1)
+
+#define DEG_TO_RAD                          (3.14159265f / 180.0f)
+
+
+static bool pca9555_read(uint32_t internal_address, uint8_t* buffer, uint32_t bytes_count);
+static bool pca9555_write(uint32_t internal_address, const uint8_t* data, uint32_t bytes_count);
+static bool mpu6050_read(uint32_t internal_address, uint8_t* buffer, uint32_t bytes_count);
+static bool mpu6050_write(uint32_t internal_address, const uint8_t* data, uint32_t bytes_count);
+static bool ssd1306_write(uint32_t internal_address, const uint8_t* data, uint32_t bytes_count);
+static void mpu6050_dmp_event_handler(void);
+
+static const host_i2c_device_t pca9555_device = { .read = pca9555_read, .write = pca9555_write };
+static const host_i2c_device_t mpu6050_device = { .read = mpu6050_read, .write = mpu6050_write };
+static const host_i2c_device_t ssd1306_device = { .read = NULL,         .write = ssd1306_write };
+
+static uint8_t  pca9555_regs[PCA9555_REGS_COUNT] = {0};
+static uint16_t pca9555_inputs = 0;
+static uint16_t pca9555_last_read_inputs = 0;
+
+static uint8_t  mpu6050_regs[MPU6050_REGS_COUNT] = {0};
+static uint8_t  mpu6050_memory[MPU6050_MEMORY_SIZE] = {0};
+static uint8_t  mpu6050_fifo[MPU6050_FIFO_SIZE] = {0};
+static uint32_t mpu6050_fifo_count = 0;
+static uint32_t mpu6050_packets_count = 0;
+static float    hull_orientation[2] = {0};
+
+
+/// ***************************************************************************
+/// @brief  Attach devices models to I2C buses
+/// @param  is_mpu6050_present: false - MPU6050 is not answer (NACK)
+/// ***************************************************************************
+void sim_devices_init(bool is_mpu6050_present) {
+    // Power on state
+    memset(pca9555_regs, 0, sizeof(pca9555_regs));
+    pca9555_regs[PCA9555_REG_OUTPUT_0 + 0] = 0xFF;
+    pca9555_regs[PCA9555_REG_OUTPUT_0 + 1] = 0xFF;
+    pca9555_regs[PCA9555_REG_CFG_0 + 0] = 0xFF;
+    pca9555_regs[PCA9555_REG_CFG_0 + 1] = 0xFF;
+    memset(mpu6050_regs, 0, sizeof(mpu6050_regs));
+    mpu6050_regs[MPU6050_REG_PWR_MGMT_1] = 0x40;
+    mpu6050_regs[MPU6050_REG_WHO_AM_I] = 0x68;
+    mpu6050_fifo_count = 0;
+
+    // Interrupt pins are pulled up
+    GPIOB->IDR |= (0x01u << 5);
+    GPIOA->IDR |= (0x01u << 12);
+
+    host_i2c1_attach(PCA9555_I2C_ADDRESS, &pca9555_device);
+    host_i2c2_attach(SSD1306_I2C_ADDRESS, &ssd1306_device);
+    host_i2c2_attach(MPU6050_I2C_ADDRESS, is_mpu6050_present ? &mpu6050_device : NULL);
+    host_clock_set_handler(HOST_EVENT_MPU6050, mpu6050_dmp_event_handler);
+}
+
+/// ***************************************************************************
+/// @brief  Set hull orientation for MPU6050 DMP
+/// @param  x: angle around X axis [deg]
+/// @param  z: angle around Z axis [deg]
+/// ***************************************************************************
+void sim_devices_set_hull_orientation(float x, float z) {
+    hull_orientation[0] = x;
+    hull_orientation[1] = z;
+}
+
+/// ***************************************************************************
+/// @brief  Set foot sensors state
+/// @note   PCA9555 INT pin goes LOW while inputs differ from last read
+/// @param  inputs: sensors mask. @ref PCA9555_GPIO_SENSOR_ALL
+/// ***************************************************************************
+void sim_devices_set_foot_sensors(uint16_t inputs) {
+    pca9555_inputs = inputs & PCA9555_GPIO_SENSOR_ALL;
+    if (pca9555_inputs != pca9555_last_read_inputs) {
+        GPIOB->IDR &= ~(0x01u << 5);
+    }
+}
+
+/// ***************************************************************************
+/// @brief  Get LEDs state (PCA9555 outputs)
+/// @return LEDs mask. @ref PCA9555_GPIO_LED_ALL
+/// ***************************************************************************
+uint16_t sim_devices_get_leds(void) {
+    uint16_t outputs = make16(pca9555_regs[PCA9555_REG_OUTPUT_0 + 1], pca9555_regs[PCA9555_REG_OUTPUT_0 + 0]);
+    return outputs & PCA9555_GPIO_LED_ALL;
+}
+
+/// ***************************************************************************
+/// @brief  Get count of DMP packets placed to FIFO
+/// @return packets count
+/// ***************************************************************************
+uint32_t sim_devices_get_mpu6050_packets_count(void) {
+    return mpu6050_packets_count;
+}
+
+
+
+
+
+/// ***************************************************************************
+/// @brief  PCA9555 read. Register pointer toggles inside registers pair
+/// ***************************************************************************
+static bool pca9555_read(uint32_t internal_address, uint8_t* buffer, uint32_t bytes_count) {
+    if (internal_address >= PCA9555_REGS_COUNT) {
+        return false;
+    }
+    pca9555_regs[PCA9555_REG_INPUT_0 + 0] = (uint8_t)(pca9555_inputs >> 0);
+    pca9555_regs[PCA9555_REG_INPUT_0 + 1] = (uint8_t)(pca9555_inputs >> 8);
+    for (uint32_t i = 0; i < bytes_count; ++i) {
+        uint32_t reg = (internal_address & ~0x01u) | ((internal_address + i) & 0x01u);
+        buffer[i] = pca9555_regs[reg];
+        if (reg == PCA9555_REG_INPUT_0 || reg == PCA9555_REG_INPUT_0 + 1) {
+            pca9555_last_read_inputs = pca9555_inputs;
+            GPIOB->IDR |= (0x01u << 5);
+        }
+    }
+    return true;
+}
+
+/// ***************************************************************************
+/// @brief  PCA9555 write. Input registers are read only
+/// ***************************************************************************
+static bool pca9555_write(uint32_t internal_address, const uint8_t* data, uint32_t bytes_count) {
+    if (internal_address >= PCA9555_REGS_COUNT) {
+        return false;
+    }
+    for (uint32_t i = 0; i < bytes_count; ++i) {
+        uint32_t reg = (internal_address & ~0x01u) | ((internal_address + i) & 0x01u);
+        if (reg > PCA9555_REG_INPUT_0 + 1) {
+            pca9555_regs[reg] = data[i];
+        }
+    }
+    return true;
+}
+
+/// ***************************************************************************
+/// @brief  MPU6050 read. Any read clears INT pin (INT_RD_CLEAR)
+/// ***************************************************************************
+static bool mpu6050_read(uint32_t internal_address, uint8_t* buffer, uint32_t bytes_count) {
+    GPIOA->IDR |= (0x01u << 12);
+
+    uint32_t reg = internal_address;
+    for (uint32_t i = 0; i < bytes_count; ++i) {
+        if (reg >= MPU6050_REGS_COUNT) {
+            return false;
+        }
+        switch (reg) {
+            case MPU6050_REG_MEM_R_W: {
+                uint32_t address = mpu6050_regs[MPU6050_REG_BANK_SEL] * 256u + mpu6050_regs[MPU6050_REG_MEM_START_ADDR];
+                buffer[i] = mpu6050_memory[address % MPU6050_MEMORY_SIZE];
+                if (++mpu6050_regs[MPU6050_REG_MEM_START_ADDR] == 0) {
+                    ++mpu6050_regs[MPU6050_REG_BANK_SEL];
+                }
+                continue; // Register pointer is not changed
+            }
+            case MPU6050_REG_FIFO_R_W:
+                buffer[i] = 0;
+                if (mpu6050_fifo_count) {
+                    buffer[i] = mpu6050_fifo[0];
+                    memmove(mpu6050_fifo, mpu6050_fifo + 1, --mpu6050_fifo_count);
+                }
+                continue; // Register pointer is not changed
+            case MPU6050_REG_FIFO_COUNTH:
+                buffer[i] = (uint8_t)(mpu6050_fifo_count >> 8);
+                break;
+            case MPU6050_REG_FIFO_COUNTL:
+                buffer[i] = (uint8_t)(mpu6050_fifo_count >> 0);
+                break;
+            default:
+                buffer[i] = mpu6050_regs[reg];
+                break;
+        }
+        ++reg;
+    }
+    return true;
+}
+
+/// ***************************************************************************
+/// @brief  MPU6050 write
+/// ***************************************************************************
+static bool mpu6050_write(uint32_t internal_address, const uint8_t* data, uint32_t bytes_count) {
+    uint32_t reg = internal_address;
+    for (uint32_t i = 0; i < bytes_count; ++i) {
+        if (reg >= MPU6050_REGS_COUNT || reg == MPU6050_REG_WHO_AM_I) {
+            return false;
+        }
+        switch (reg) {
+            case MPU6050_REG_MEM_R_W: {
+                uint32_t address = mpu6050_regs[MPU6050_REG_BANK_SEL] * 256u + mpu6050_regs[MPU6050_REG_MEM_START_ADDR];
+                mpu6050_memory[address % MPU6050_MEMORY_SIZE] = data[i];
+                if (++mpu6050_regs[MPU6050_REG_MEM_START_ADDR] == 0) {
+                    ++mpu6050_regs[MPU6050_REG_BANK_SEL];
+                }
+                continue; // Register pointer is not changed
+            }
+            case MPU6050_REG_PWR_MGMT_1:
+                mpu6050_regs[reg] = data[i] & ~0x80u; // Device reset bit is self clearing
+                break;
+            case MPU6050_REG_USER_CTRL:
+                if (data[i] & MPU6050_USER_CTRL_FIFO_RESET) {
+                    mpu6050_fifo_count = 0;
+                }
+                mpu6050_regs[reg] = data[i] & MPU6050_USER_CTRL_DMP_FIFO_EN;
+                if ((mpu6050_regs[reg] & MPU6050_USER_CTRL_DMP_FIFO_EN) == MPU6050_USER_CTRL_DMP_FIFO_EN) {
+                    if (!host_clock_is_event_started(HOST_EVENT_MPU6050)) {
+                        host_clock_start_event(HOST_EVENT_MPU6050, MPU6050_DMP_PERIOD_US);
+                    }
+                } else {
+                    host_clock_stop_event(HOST_EVENT_MPU6050);
+                }
+                break;
+            default:
+                mpu6050_regs[reg] = data[i];
+                break;
+        }
+        ++reg;
+    }
+    return true;
+}
+
+/// ***************************************************************************
+/// @brief  SSD1306 write. Display content is not modeled
+/// ***************************************************************************
+static bool ssd1306_write(uint32_t internal_address, const uint8_t* data, uint32_t bytes_count) {
+    (void)internal_address;
+    (void)data;
+    (void)bytes_count;
+    return true;
+}
+
+/// ***************************************************************************
+/// @brief  MPU6050 DMP output. Place quaternion packet to FIFO
+/// @note   FIFO overflow breaks packets alignment as on hardware
+/// ***************************************************************************
+static void mpu6050_dmp_event_handler(void) {
+    host_clock_start_event(HOST_EVENT_MPU6050, MPU6050_DMP_PERIOD_US);
+
+    // Quaternion for roll (X) and pitch (Z), yaw is zero
+    float half_x = hull_orientation[0] * DEG_TO_RAD / 2.0f;
+    float half_z = hull_orientation[1] * DEG_TO_RAD / 2.0f;
+    float q[4] = {
+         cosf(half_x) * cosf(half_z),
+         sinf(half_x) * cosf(half_z),
+         cosf(half_x) * sinf(half_z),
+        -sinf(half_x) * sinf(half_z)
+    };
+
+    uint8_t packet[MPU6050_FIFO_PACKET_SIZE] = {0};
+    for (uint32_t i = 0; i < 4; ++i) {
+        int32_t raw = (int32_t)lroundf(q[i] * 16384.0f) * 65536;
+        packet[i * 4 + 0] = (uint8_t)(raw >> 24);
+        packet[i * 4 + 1] = (uint8_t)(raw >> 16);
+        packet[i * 4 + 2] = (uint8_t)(raw >> 8);
+        packet[i * 4 + 3] = (uint8_t)(raw >> 0);
+    }
+
+    uint32_t bytes_count = MPU6050_FIFO_PACKET_SIZE;
+    if (mpu6050_fifo_count + bytes_count > MPU6050_FIFO_SIZE) {
+        bytes_count = MPU6050_FIFO_SIZE - mpu6050_fifo_count;
+    }
+    memcpy(mpu6050_fifo + mpu6050_fifo_count, packet, bytes_count);
+    mpu6050_fifo_count += bytes_count;
+    ++mpu6050_packets_count;
+
+    if (mpu6050_regs[MPU6050_REG_INT_ENABLE] & MPU6050_INT_ENABLE_DMP) {
+        GPIOA->IDR &= ~(0x01u << 12);
+    }
+}
@@ -0,0 +1,19 @@
+/// ***************************************************************************
+/// @file    sim-devices.h
+/// @author  NeoProg
+/// @brief   Models of I2C devices for firmware simulator
+/// ***************************************************************************
+#ifndef _SIM_DEVICES_H_
+#define _SIM_DEVICES_H_
+#include <stdint.h>
+#include <stdbool.h>
+
+
+extern void     sim_devices_init(bool is_mpu6050_present);
+extern void     sim_devices_set_hull_orientation(float x, float z);
+extern void     sim_devices_set_foot_sensors(uint16_t inputs);
+extern uint16_t sim_devices_get_leds(void);
+extern uint32_t sim_devices_get_mpu6050_packets_count(void);
+
+
+#endif // _SIM_DEVICES_H_
@@ -0,0 +1,393 @@
+/// ***************************************************************************
+/// @file    simulator.c
+/// @author  NeoProg
+/// @brief   Firmware simulator. Runs firmware main() on host
+/// @note    All drivers are replaced by host stand-ins, interrupts (TIM17,
+///          SysTick, USART and DMA) are dispatched by simulated clock. Simulator
+///          is SWLP master: sends requests from cyclic gait scenario and checks
+///          responses. Simulation time is not bound to host time.
+///          Usage: simulator [-t seconds] [--swlp-period ms] [--tick-cost us]
+///                           [--poll-cost us] [--swlp-stop seconds]
+///                           [--cli "command"]... [--cli-delay ms] [--echo-cli]
+///                           [--no-mpu] [--trace file.csv] [--cli-out file]
+///          Trace is CSV of surface point and rotation sampled each PWM
+///          period between motion ticks, plot it by gnuplot:
+///          plot for [i=2:7] 'file.csv' using 1:i with lines title columnhead
+///          Foot sensors are activated by limbs positions on uneven ground.
+///          Raw CLI output (binary dumps too) is saved to --cli-out file
+/// ***************************************************************************
+#define _POSIX_C_SOURCE 200809L
+#include "project-base.h"
+#include "swlp-protocol.h"
+#include "motion-core.h"
+#include "pca9555.h"
+#include "pwm.h"
+#include "system-monitor.h"
+#include "host-hal.h"
+#include "sim-devices.h"
+#include <time.h>
+
+#define DEFAULT_DURATION_S              (60)
+#define DEFAULT_SWLP_PERIOD_MS          (50)
+#define DEFAULT_TICK_COST_US            (250)
+#define MAX_CLI_COMMANDS_COUNT          (32)
+#define FOOT_SENSORS_PERIOD_US          (1000)
+#define TRACE_PERIOD_US                 (5000)
+
+
+typedef struct {
+    uint32_t duration_ms;
+    ext_motion_t motion;
+    float hull_x;
+    float hull_z;
+} scenario_step_t;
+
+
+// Cyclic scenario: stand up, walk forward by tripod gait with terrain adaptation by
+// foot sensors, turn by ripple gait, walk back by wave gait with stabilization on
+// tilted hull, surface rotation and sit down
+static const scenario_step_t scenario[] = {
+    {  4000, { {  50,     0,    0, 30 }, MOTION_CTRL_NO,                                {  0,  -85,   0 }, { 0,  0,  0 } }, 0,  0 },
+    { 10000, { { 100,     1,  110, 30 }, MOTION_CTRL_EN_TERRAIN,                        {  0,  -85,   0 }, { 0,  0,  0 } }, 0,  0 },
+    {  6000, { {  50,  1000,   90, 60 }, MOTION_CTRL_GAIT_RIPPLE,                       {  0,  -85,   0 }, { 0,  0,  0 } }, 0,  0 },
+    {  8000, { {  75,  -500, -110, 15 }, MOTION_CTRL_EN_STAB | MOTION_CTRL_GAIT_WAVE,   {  0, -100,   0 }, { 0,  0,  0 } }, 4, -3 },
+    {  5000, { { 100,     0,    0, 30 }, MOTION_CTRL_NO,                                { 20, -110, -20 }, { 5, 15, -5 } }, 0,  0 },
+    {  7000, { {  50,     0,    0, 30 }, MOTION_CTRL_NO,                                {  0,  -15,   0 }, { 0,  0,  0 } }, 0,  0 },
+};
+
+// Ground height under limbs relatively flat surface for foot sensors model, [mm]
+static const float ground_height[SUPPORT_LIMBS_COUNT] = { 0, 10, 0, -10, 0, 5 };
+static const uint16_t foot_sensors[SUPPORT_LIMBS_COUNT] = {
+    PCA9555_GPIO_SENSOR_LEFT_1,  PCA9555_GPIO_SENSOR_LEFT_2,  PCA9555_GPIO_SENSOR_LEFT_3,
+    PCA9555_GPIO_SENSOR_RIGHT_1, PCA9555_GPIO_SENSOR_RIGHT_2, PCA9555_GPIO_SENSOR_RIGHT_3
+};
+
+static uint64_t duration_us = DEFAULT_DURATION_S * 1000000ull;
+static uint64_t swlp_period_us = DEFAULT_SWLP_PERIOD_MS * 1000ull;
+static uint64_t swlp_stop_us = UINT64_MAX;
+static const char* cli_commands[MAX_CLI_COMMANDS_COUNT];
+static uint32_t cli_commands_count = 0;
+static uint32_t cli_commands_sent = 0;
+static uint64_t cli_delay_us = 0;
+static bool is_cli_echo = false;
+static FILE* trace_file = NULL;
+static FILE* cli_out_file = NULL;
+
+static uint64_t host_start_time_ns = 0;
+static uint64_t scenario_time_us = 0;
+static uint64_t request_time_us = 0;
+static bool is_response_wait = false;
+
+static struct {
+    uint64_t requests;
+    uint64_t rejected;
+    uint64_t responses;
+    uint64_t bad_responses;
+    uint64_t lost;
+    uint64_t max_latency_us;
+    uint64_t cli_bytes;
+} stats;
+
+
+extern void firmware_main(void);
+static void simulator_event_handler(void);
+static void trace_event_handler(void);
+static void foot_sensors_event_handler(void);
+static void send_swlp_request(const scenario_step_t* step);
+static void swlp_tx_handler(const uint8_t* data, uint32_t bytes_count);
+static void cli_tx_handler(const uint8_t* data, uint32_t bytes_count);
+static void finish(void);
+static uint16_t calculate_checksum(const uint8_t* frame, uint32_t size);
+static uint64_t get_time_ns(void);
+
+
+/// ***************************************************************************
+/// @brief  Program entry point
+/// ***************************************************************************
+int main(int argc, char* argv[]) {
+    uint64_t tick_cost_us = DEFAULT_TICK_COST_US;
+    uint64_t poll_cost_us = HOST_CLOCK_DEFAULT_POLL_COST_US;
+    bool is_mpu6050_present = true;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            duration_us = (uint64_t)(atof(argv[++i]) * 1000000.0);
+        } else if (strcmp(argv[i], "--swlp-period") == 0 && i + 1 < argc) {
+            swlp_period_us = (uint64_t)atoi(argv[++i]) * 1000;
+        } else if (strcmp(argv[i], "--swlp-stop") == 0 && i + 1 < argc) {
+            swlp_stop_us = (uint64_t)(atof(argv[++i]) * 1000000.0);
+        } else if (strcmp(argv[i], "--tick-cost") == 0 && i + 1 < argc) {
+            tick_cost_us = (uint64_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--poll-cost") == 0 && i + 1 < argc) {
+            poll_cost_us = (uint64_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--cli") == 0 && i + 1 < argc && cli_commands_count < MAX_CLI_COMMANDS_COUNT) {
+            cli_commands[cli_commands_count++] = argv[++i];
+        } else if (strcmp(argv[i], "--cli-delay") == 0 && i + 1 < argc) {
+            cli_delay_us = (uint64_t)atoi(argv[++i]) * 1000ull;
+        } else if (strcmp(argv[i], "--echo-cli") == 0) {
+            is_cli_echo = true;
+        } else if (strcmp(argv[i], "--no-mpu") == 0) {
+            is_mpu6050_present = false;
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_file = fopen(argv[++i], "w");
+            if (!trace_file) {
+                fprintf(stderr, "Failed to open trace file %s\n", argv[i]);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--cli-out") == 0 && i + 1 < argc) {
+            cli_out_file = fopen(argv[++i], "wb");
+            if (!cli_out_file) {
+                fprintf(stderr, "Failed to open CLI output file %s\n", argv[i]);
+                return EXIT_FAILURE;
+            }
+        } else {
+            fprintf(stderr, "Usage: %s [-t seconds] [--swlp-period ms] [--tick-cost us] [--poll-cost us] [--swlp-stop seconds] "
+                            "[--cli \"command\"]... [--cli-delay ms] [--echo-cli] [--no-mpu] [--trace file.csv] [--cli-out file]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (swlp_period_us == 0 || poll_cost_us == 0) {
+        fprintf(stderr, "SWLP period and poll cost should be greater than zero\n");
+        return EXIT_FAILURE;
+    }
+
+    host_clock_reset();
+    host_clock_set_poll_cost(poll_cost_us);
+    host_pwm_set_tick_cost(tick_cost_us);
+    host_usart1_set_tx_handler(cli_tx_handler);
+    host_usart2_set_tx_handler(swlp_tx_handler);
+    sim_devices_init(is_mpu6050_present);
+
+    host_clock_set_handler(HOST_EVENT_SIMULATOR, simulator_event_handler);
+    host_clock_start_event(HOST_EVENT_SIMULATOR, swlp_period_us);
+    host_clock_set_handler(HOST_EVENT_SIMULATOR_FEET, foot_sensors_event_handler);
+    host_clock_start_event(HOST_EVENT_SIMULATOR_FEET, FOOT_SENSORS_PERIOD_US);
+    if (trace_file) {
+        fprintf(trace_file, "time_ms,point_x,point_y,point_z,rotate_x,rotate_y,rotate_z\n");
+        host_clock_set_handler(HOST_EVENT_SIMULATOR_TRACE, trace_event_handler);
+        host_clock_start_event(HOST_EVENT_SIMULATOR_TRACE, TRACE_PERIOD_US / 2); // Between motion ticks
+    }
+
+    // Firmware never returns, simulation is finished from event handler
+    host_start_time_ns = get_time_ns();
+    firmware_main();
+    return EXIT_FAILURE;
+}
+
+
+
+
+
+/// ***************************************************************************
+/// @brief  Simulator event: SWLP master, hull orientation and CLI commands
+/// ***************************************************************************
+static void simulator_event_handler(void) {
+    uint64_t time_us = host_clock_get_time_us();
+    if (time_us >= duration_us) {
+        finish();
+    }
+    host_clock_start_event(HOST_EVENT_SIMULATOR, swlp_period_us);
+
+    // Select scenario step
+    uint64_t scenario_duration_us = 0;
+    for (uint32_t i = 0; i < sizeof(scenario) / sizeof(scenario[0]); ++i) {
+        scenario_duration_us += scenario[i].duration_ms * 1000ull;
+    }
+    uint64_t step_time_us = scenario_time_us % scenario_duration_us;
+    const scenario_step_t* step = scenario;
+    while (step_time_us >= step->duration_ms * 1000ull) {
+        step_time_us -= step->duration_ms * 1000ull;
+        ++step;
+    }
+
+    // Hull orientation with small oscillation
+    float phase = (float)(time_us % 2000000) / 2000000.0f * 6.2831853f;
+    sim_devices_set_hull_orientation(step->hull_x + sinf(phase), step->hull_z + cosf(phase));
+
+    // Firmware does not process requests while calibration
+    if (sysmon_is_error_set(SYSMON_CALIBRATION)) {
+        return;
+    }
+    scenario_time_us += swlp_period_us;
+    if (time_us < swlp_stop_us) { // Connection lost simulation
+        send_swlp_request(step);
+    }
+
+    // CLI commands are sent one by one after calibration and delay
+    if (cli_commands_sent < cli_commands_count && scenario_time_us > cli_delay_us) {
+        char cmd[512] = {0};
+        snprintf(cmd, sizeof(cmd), "%s", cli_commands[cli_commands_sent]);
+        if (host_usart1_receive((const uint8_t*)cmd, (uint32_t)strlen(cmd))) {
+            if (is_cli_echo) {
+                printf("> %s\n", cmd);
+            }
+            ++cli_commands_sent;
+        }
+    }
+}
+
+/// ***************************************************************************
+/// @brief  Simulator event: surface trace record
+/// ***************************************************************************
+static void trace_event_handler(void) {
+    host_clock_start_event(HOST_EVENT_SIMULATOR_TRACE, TRACE_PERIOD_US);
+
+    ext_motion_t motion = motion_core_get_motion();
+    fprintf(trace_file, "%.3f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f\n", (double)host_clock_get_time_us() / 1000.0,
+            motion.surface_point.x, motion.surface_point.y, motion.surface_point.z,
+            motion.surface_rotate.x, motion.surface_rotate.y, motion.surface_rotate.z);
+}
+
+/// ***************************************************************************
+/// @brief  Simulator event: foot sensors
+/// @note   Foot touches ground if foot height is not above ground height
+///         under limb. Foot height is limb position with ground height
+///         selected by firmware
+/// ***************************************************************************
+static void foot_sensors_event_handler(void) {
+    host_clock_start_event(HOST_EVENT_SIMULATOR_FEET, FOOT_SENSORS_PERIOD_US);
+
+    const limb_t* limbs = motion_core_get_limbs();
+    uint16_t inputs = 0;
+    for (int32_t i = 0; i < SUPPORT_LIMBS_COUNT; ++i) {
+        if (limbs[i].pos.y + limbs[i].ground_height <= ground_height[i]) {
+            inputs |= foot_sensors[i];
+        }
+    }
+    sim_devices_set_foot_sensors(inputs);
+}
+
+/// ***************************************************************************
+/// @brief  Send SWLP request
+/// @param  step: scenario step
+/// ***************************************************************************
+static void send_swlp_request(const scenario_step_t* step) {
+    if (is_response_wait) {
+        ++stats.lost;
+    }
+
+    swlp_frame_t frame = {0};
+    swlp_request_t* request = (swlp_request_t*)frame.payload;
+    request->speed = (uint8_t)step->motion.cfg.speed;
+    request->curvature = step->motion.cfg.curvature;
+    request->distance = (int8_t)step->motion.cfg.distance;
+    request->step_height = (uint8_t)step->motion.cfg.step_height;
+    request->motion_ctrl = step->motion.ctrl;
+    request->surface_point_x = (int16_t)step->motion.surface_point.x;
+    request->surface_point_y = (int16_t)step->motion.surface_point.y;
+    request->surface_point_z = (int16_t)step->motion.surface_point.z;
+    request->surface_rotate_x = (int16_t)step->motion.surface_rotate.x;
+    request->surface_rotate_y = (int16_t)step->motion.surface_rotate.y;
+    request->surface_rotate_z = (int16_t)step->motion.surface_rotate.z;
+    frame.start_mark = SWLP_START_MARK_VALUE;
+    frame.version = SWLP_CURRENT_VERSION;
+    frame.checksum = calculate_checksum((const uint8_t*)&frame, sizeof(frame) - sizeof(frame.checksum));
+
+    ++stats.requests;
+    if (host_usart2_receive((const uint8_t*)&frame, sizeof(frame))) {
+        request_time_us = host_clock_get_time_us();
+        is_response_wait = true;
+    } else {
+        ++stats.rejected;
+        is_response_wait = false;
+    }
+}
+
+/// ***************************************************************************
+/// @brief  SWLP response handler
+/// @param  data: frame
+/// @param  bytes_count: frame size
+/// ***************************************************************************
+static void swlp_tx_handler(const uint8_t* data, uint32_t bytes_count) {
+    swlp_frame_t frame;
+    if (bytes_count != sizeof(frame)) {
+        ++stats.bad_responses;
+        return;
+    }
+    memcpy(&frame, data, sizeof(frame));
+    if (frame.start_mark != SWLP_START_MARK_VALUE || frame.version != SWLP_CURRENT_VERSION ||
+        frame.checksum != calculate_checksum(data, sizeof(frame) - sizeof(frame.checksum))) {
+        ++stats.bad_responses;
+        return;
+    }
+
+    if (is_response_wait) {
+        uint64_t latency_us = host_clock_get_time_us() - request_time_us;
+        if (latency_us > stats.max_latency_us) {
+            stats.max_latency_us = latency_us;
+        }
+        is_response_wait = false;
+    }
+    ++stats.responses;
+}
+
+/// ***************************************************************************
+/// @brief  CLI output handler
+/// @param  data: data
+/// @param  bytes_count: data size
+/// ***************************************************************************
+static void cli_tx_handler(const uint8_t* data, uint32_t bytes_count) {
+    stats.cli_bytes += bytes_count;
+    if (is_cli_echo) {
+        fwrite(data, 1, bytes_count, stdout);
+    }
+    if (cli_out_file) {
+        fwrite(data, 1, bytes_count, cli_out_file);
+    }
+}
+
+/// ***************************************************************************
+/// @brief  Print report and exit
+/// @note   Exit code is failure for fatal error, PWM overruns,
+///         broken responses or no responses
+/// ***************************************************************************
+static void finish(void) {
+    double sim_time_s = (double)host_clock_get_time_us() / 1000000.0;
+    double host_time_s = (double)(get_time_ns() - host_start_time_ns) / 1000000000.0;
+    printf("simulated time:      %.3f s\n", sim_time_s);
+    printf("host time:           %.3f s (x%.1f)\n", host_time_s, (host_time_s > 0) ? sim_time_s / host_time_s : 0.0);
+    printf("pwm periods:         %llu\n", (unsigned long long)host_pwm_get_periods_count());
+    printf("pwm overruns:        %u\n", pwm_get_overruns_count());
+    printf("swlp requests:       %llu (rejected %llu)\n", (unsigned long long)stats.requests, (unsigned long long)stats.rejected);
+    printf("swlp responses:      %llu (bad %llu, lost %llu)\n", (unsigned long long)stats.responses,
+           (unsigned long long)stats.bad_responses, (unsigned long long)stats.lost);
+    printf("swlp max latency:    %.3f ms\n", (double)stats.max_latency_us / 1000.0);
+    printf("mpu6050 packets:     %u\n", sim_devices_get_mpu6050_packets_count());
+    printf("cli output:          %llu bytes, %u/%u commands\n", (unsigned long long)stats.cli_bytes, cli_commands_sent, cli_commands_count);
+    printf("system status:       0x%02X\n", sysmon_system_status);
+    printf("module status:       0x%02X\n", sysmon_module_status);
+    fflush(stdout);
+    if (trace_file) {
+        fclose(trace_file);
+    }
+    if (cli_out_file) {
+        fclose(cli_out_file);
+    }
+
+    bool is_failed = sysmon_is_error_set(SYSMON_FATAL_ERROR) || pwm_get_overruns_count() != 0 ||
+                     stats.bad_responses != 0 || stats.responses == 0;
+    exit(is_failed ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+/// ***************************************************************************
+/// @brief  Calculate SWLP frame checksum
+/// @param  frame: frame
+/// @param  size: frame size
+/// @return checksum value
+/// ***************************************************************************
+static uint16_t calculate_checksum(const uint8_t* frame, uint32_t size) {
+    uint32_t checksum = 0;
+    for (uint32_t i = 0; i < size; ++i) {
+        checksum += frame[i];
+    }
+    return checksum & 0xFFFF;
+}
+
+/// ***************************************************************************
+/// @brief  Get host monotonic time
+/// @return time [ns]
+/// ***************************************************************************
+static uint64_t get_time_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
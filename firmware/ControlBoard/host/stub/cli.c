@@ -0,0 +1,26 @@
+/// ***************************************************************************
+/// @file    cli.c
+/// @author  NeoProg
+/// @brief   Host stub for CLI. Output is dropped
+/// ***************************************************************************
+#include "project-base.h"
+#include "cli.h"
+
+
+static char tx_buffer[USART1_TX_BUFFER_SIZE] = {0};
+
+
+void cli_init(void) {
+}
+void cli_process(void) {
+}
+void* cli_get_tx_buffer(void) {
+    return tx_buffer;
+}
+void cli_send_data(const char* data) {
+    (void)data;
+}
+void cli_send_binary(const void* data, uint32_t size) {
+    (void)data;
+    (void)size;
+}
@@ -0,0 +1,47 @@
+/// ***************************************************************************
+/// @file    sensors-core.c
+/// @author  NeoProg
+/// @brief   Host stub for sensors core. Orientation and foot contacts are set by host side
+/// ***************************************************************************
+#include "project-base.h"
+#include "sensors-core.h"
+#include "host-hal.h"
+
+uint16_t sensors_inputs = 0;
+static float orientation_xz[2] = {0};
+static bool is_foot_contacts_valid = false;
+static uint32_t foot_contacts = 0;
+
+
+void sensors_core_init(void) {
+}
+bool sensors_core_calibration_process(void) {
+    return false;
+}
+void sensors_core_get_orientation(float* xz) {
+    xz[0] = orientation_xz[0];
+    xz[1] = orientation_xz[1];
+}
+bool sensors_core_get_foot_contacts(uint32_t* limbs_mask) {
+    *limbs_mask = foot_contacts;
+    return is_foot_contacts_valid;
+}
+void sensors_core_process(void) {
+}
+
+
+
+
+
+void host_sensors_set_orientation(float x, float z) {
+    orientation_xz[0] = x;
+    orientation_xz[1] = z;
+}
+void host_sensors_set_foot_contacts(uint32_t limbs_mask) {
+    foot_contacts = limbs_mask;
+    is_foot_contacts_valid = true;
+}
+void host_sensors_clear_foot_contacts(void) {
+    foot_contacts = 0;
+    is_foot_contacts_valid = false;
+}
@@ -0,0 +1,35 @@
+/// ***************************************************************************
+/// @file    servo-driver.c
+/// @author  NeoProg
+/// @brief   Host stub for servo driver. Keeps last logic angles only
+/// ***************************************************************************
+#include "project-base.h"
+#include "servo-driver.h"
+#include "host-hal.h"
+
+
+static float servo_logic_angles[SUPPORT_SERVO_COUNT] = {0};
+
+
+void servo_driver_init(void) {
+    memset(servo_logic_angles, 0, sizeof(servo_logic_angles));
+}
+void servo_driver_power_on(void) {
+}
+void servo_driver_power_off(void) {
+}
+void servo_driver_move(uint32_t ch, float angle) {
+    if (ch < SUPPORT_SERVO_COUNT) {
+        servo_logic_angles[ch] = angle;
+    }
+}
+void servo_driver_process(void) {
+}
+
+
+
+
+
+float host_servo_get_logic_angle(uint32_t ch) {
+    return (ch < SUPPORT_SERVO_COUNT) ? servo_logic_angles[ch] : 0.0f;
+}
@@ -0,0 +1,210 @@
+/// ***************************************************************************
+/// @file    fast-math-bench.c
+/// @author  NeoProg
+/// @brief   Error report and benchmark of fast math against libm
+/// @note    Errors are measured against double precision libm on uniform
+///          grid over function domain.
+///          Usage: fast-math-bench [-n points] [--csv]
+/// ***************************************************************************
+#define _POSIX_C_SOURCE 199309L
+#include "project-base.h"
+#include "fast-math.h"
+#include <time.h>
+
+#define DEFAULT_POINTS_COUNT            (1000000)
+#define BENCH_INPUTS_COUNT              (4096)
+#define BENCH_PASSES_COUNT              (200)
+#define M_PI_D                          (3.14159265358979323846)
+
+
+typedef enum {
+    FUNCTION_SIN,
+    FUNCTION_COS,
+    FUNCTION_ATAN2,
+    FUNCTION_ACOS,
+    FUNCTION_ASIN,
+    FUNCTION_SQRT,
+    FUNCTIONS_COUNT
+} function_t;
+
+typedef struct {
+    const char* name;
+    double min_arg;
+    double max_arg;
+} function_info_t;
+
+
+static const function_info_t functions[FUNCTIONS_COUNT] = {
+    { "sin",   -4.0 * M_PI_D, 4.0 * M_PI_D },
+    { "cos",   -4.0 * M_PI_D, 4.0 * M_PI_D },
+    { "atan2", -M_PI_D,       M_PI_D       }, // Argument is vector angle on unit circle
+    { "acos",  -1.0,          1.0          },
+    { "asin",  -1.0,          1.0          },
+    { "sqrt",   0.0,          300000.0     },
+};
+
+static float inputs[BENCH_INPUTS_COUNT][2];
+static volatile float sink = 0;
+
+
+static void make_args(function_t f, double a, float* args);
+static float call_fast(function_t f, const float* args);
+static float call_libm(function_t f, const float* args);
+static double call_reference(function_t f, const float* args);
+static double bench(function_t f, bool is_fast);
+static uint64_t get_time_ns(void);
+
+
+/// ***************************************************************************
+/// @brief  Program entry point
+/// ***************************************************************************
+int main(int argc, char* argv[]) {
+    uint32_t points_count = DEFAULT_POINTS_COUNT;
+    bool is_csv = false;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            points_count = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--csv") == 0) {
+            is_csv = true;
+        } else {
+            fprintf(stderr, "Usage: %s [-n points] [--csv]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (points_count < 2) {
+        points_count = DEFAULT_POINTS_COUNT;
+    }
+
+    if (is_csv) {
+        printf("function,max_abs_error,max_error_arg,fast_ns,libm_ns,speedup\n");
+    } else {
+        printf("%-8s %14s %14s %10s %10s %8s\n", "function", "max abs error", "at argument", "fast ns", "libm ns", "speedup");
+    }
+    for (int32_t f = 0; f < FUNCTIONS_COUNT; ++f) {
+        const function_info_t* info = &functions[f];
+
+        // Error report
+        double max_error = 0;
+        double max_error_arg = 0;
+        for (uint32_t i = 0; i < points_count; ++i) {
+            double a = info->min_arg + (info->max_arg - info->min_arg) * i / (points_count - 1);
+            float args[2];
+            make_args((function_t)f, a, args);
+            double error = fabs((double)call_fast((function_t)f, args) - call_reference((function_t)f, args));
+            if (error > max_error) {
+                max_error = error;
+                max_error_arg = a;
+            }
+        }
+
+        // Benchmark
+        for (uint32_t i = 0; i < BENCH_INPUTS_COUNT; ++i) {
+            make_args((function_t)f, info->min_arg + (info->max_arg - info->min_arg) * rand() / RAND_MAX, inputs[i]);
+        }
+        double fast_ns = bench((function_t)f, true);
+        double libm_ns = bench((function_t)f, false);
+
+        const char* fmt = is_csv ? "%s,%.3g,%.9g,%.2f,%.2f,%.2f\n" : "%-8s %14.3g %14.9g %10.2f %10.2f %8.2f\n";
+        printf(fmt, info->name, max_error, max_error_arg, fast_ns, libm_ns, libm_ns / fast_ns);
+    }
+    return EXIT_SUCCESS;
+}
+
+
+
+
+
+/// ***************************************************************************
+/// @brief  Make function arguments
+/// @note   atan2 argument is vector angle, vector length is 100
+/// @param  f: function
+/// @param  a: argument from function domain
+/// @param  args: arguments
+/// ***************************************************************************
+static void make_args(function_t f, double a, float* args) {
+    if (f == FUNCTION_ATAN2) {
+        args[0] = (float)(100.0 * sin(a));
+        args[1] = (float)(100.0 * cos(a));
+    } else {
+        args[0] = (float)a;
+        args[1] = 0;
+    }
+}
+
+/// ***************************************************************************
+/// @brief  Call fast function
+/// ***************************************************************************
+static float call_fast(function_t f, const float* args) {
+    switch (f) {
+        case FUNCTION_SIN:   return mm_fast_sin(args[0]);
+        case FUNCTION_COS:   return mm_fast_cos(args[0]);
+        case FUNCTION_ATAN2: return mm_fast_atan2(args[0], args[1]);
+        case FUNCTION_ACOS:  return mm_fast_acos(args[0]);
+        case FUNCTION_ASIN:  return mm_fast_asin(args[0]);
+        case FUNCTION_SQRT:  return mm_fast_sqrt(args[0]);
+        default:             return 0;
+    }
+}
+
+/// ***************************************************************************
+/// @brief  Call single precision libm function
+/// ***************************************************************************
+static float call_libm(function_t f, const float* args) {
+    switch (f) {
+        case FUNCTION_SIN:   return sinf(args[0]);
+        case FUNCTION_COS:   return cosf(args[0]);
+        case FUNCTION_ATAN2: return atan2f(args[0], args[1]);
+        case FUNCTION_ACOS:  return acosf(args[0]);
+        case FUNCTION_ASIN:  return asinf(args[0]);
+        case FUNCTION_SQRT:  return sqrtf(args[0]);
+        default:             return 0;
+    }
+}
+
+/// ***************************************************************************
+/// @brief  Call double precision libm function with same float arguments
+/// ***************************************************************************
+static double call_reference(function_t f, const float* args) {
+    switch (f) {
+        case FUNCTION_SIN:   return sin(args[0]);
+        case FUNCTION_COS:   return cos(args[0]);
+        case FUNCTION_ATAN2: return atan2(args[0], args[1]);
+        case FUNCTION_ACOS:  return acos(args[0]);
+        case FUNCTION_ASIN:  return asin(args[0]);
+        case FUNCTION_SQRT:  return sqrt(args[0]);
+        default:             return 0;
+    }
+}
+
+/// ***************************************************************************
+/// @brief  Measure function cost
+/// @param  f: function
+/// @param  is_fast: true - fast function, false - libm function
+/// @return ns per call (best pass)
+/// ***************************************************************************
+static double bench(function_t f, bool is_fast) {
+    uint64_t best_ns = UINT64_MAX;
+    for (uint32_t pass = 0; pass < BENCH_PASSES_COUNT; ++pass) {
+        float acc = 0;
+        uint64_t start = get_time_ns();
+        for (uint32_t i = 0; i < BENCH_INPUTS_COUNT; ++i) {
+            acc += is_fast ? call_fast(f, inputs[i]) : call_libm(f, inputs[i]);
+        }
+        uint64_t elapsed = get_time_ns() - start;
+        sink = acc;
+        if (elapsed < best_ns) {
+            best_ns = elapsed;
+        }
+    }
+    return (double)best_ns / BENCH_INPUTS_COUNT;
+}
+
+/// ***************************************************************************
+/// @brief  Get host monotonic time
+/// @return time [ns]
+/// ***************************************************************************
+static uint64_t get_time_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
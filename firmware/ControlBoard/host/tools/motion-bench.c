@@ -0,0 +1,270 @@
+/// ***************************************************************************
+/// @file    motion-bench.c
+/// @author  NeoProg
+/// @brief   Host microbenchmark for motion math hot path. S-curve move is
+///          checked before benchmark: it should complete with long ticks and
+///          keep velocity limit
+/// @note    Usage: motion-bench [-n iterations] [--csv]
+/// ***************************************************************************
+#define _POSIX_C_SOURCE 199309L
+#include "project-base.h"
+#include "motion-core.h"
+#include "motion-math.h"
+#include "pwm.h"
+#include <time.h>
+
+#define DEFAULT_ITERATIONS              (20000)
+#define TRAJ_SAMPLES_COUNT              (100)
+#define TRAJ_TIME_STEP                  (20)
+#define BENCH_SURFACE_HEIGHT            (-100.0f)
+#define SCURVE_CHECK_MAX_MOVE_TIME      (2.0f)      // [s]
+
+
+typedef enum {
+    BENCH_TRAJ,
+    BENCH_SURFACE,
+    BENCH_KINEMATIC,
+    BENCH_MOVE_SURFACE,
+    BENCH_SCURVE_SURFACE,
+    BENCH_FUNCTIONS_COUNT
+} bench_function_t;
+
+typedef struct {
+    double min_ns;
+    double max_ns;
+    double sum_ns;
+    uint32_t count;
+} bench_summary_t;
+
+
+static const char* const function_names[BENCH_FUNCTIONS_COUNT] = {
+    "mm_traj_process_plan",
+    "mm_surface_calculate_offsets",
+    "mm_kinematic_calculate_angles",
+    "mm_move_surface",
+    "mm_scurve_move_surface"
+};
+
+static const int16_t  curvature_sweep[]   = { -1000, -500, -100, 0, 100, 500, 1000 };
+static const int16_t  distance_sweep[]    = { -110, -50, 50, 110 };
+static const uint16_t step_height_sweep[] = { 15, 30, 60 };
+
+static limb_t base_limbs[SUPPORT_LIMBS_COUNT];
+static v3d_t base_pos[SUPPORT_LIMBS_COUNT];
+static gait_table_t gait_table;
+static limb_t samples[TRAJ_SAMPLES_COUNT][SUPPORT_LIMBS_COUNT];
+static bench_summary_t summary[BENCH_FUNCTIONS_COUNT];
+static volatile uint32_t sink = 0;
+
+// S-curve check tick patterns [s]: ticks are alternated
+static const float scurve_check_ticks[][2] = { { 0.005f, 0.005f }, { 0.020f, 0.020f }, { 0.050f, 0.050f }, { 0.050f, 0.001f } };
+static const float scurve_check_moves[] = { -85.0f, 100.0f, 3.0f, 0.0f };
+static const scurve_limits_t scurve_check_limits = { 300.0f, 1500.0f, 15000.0f };
+
+
+static double bench_call(bench_function_t function, const motion_cfg_t* cfg, uint32_t iterations);
+static void prepare_samples(const motion_cfg_t* cfg);
+static bool check_scurve(void);
+static uint64_t get_time_ns(void);
+
+
+/// ***************************************************************************
+/// @brief  Program entry point
+/// ***************************************************************************
+int main(int argc, char* argv[]) {
+    uint32_t iterations = DEFAULT_ITERATIONS;
+    bool is_csv = false;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            iterations = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--csv") == 0) {
+            is_csv = true;
+        } else {
+            fprintf(stderr, "Usage: %s [-n iterations] [--csv]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (iterations == 0) {
+        iterations = DEFAULT_ITERATIONS;
+    }
+    if (!check_scurve()) {
+        return EXIT_FAILURE;
+    }
+
+    // Take limbs configuration from motion core. Limbs stay in base position after init
+    motion_core_init();
+    memcpy(base_limbs, motion_core_get_limbs(), sizeof(base_limbs));
+    for (int32_t i = 0; i < SUPPORT_LIMBS_COUNT; ++i) {
+        base_pos[i] = base_limbs[i].pos;
+    }
+    mm_gait_build_table(&gait_table, GAIT_TRIPOD);
+    for (int32_t f = 0; f < BENCH_FUNCTIONS_COUNT; ++f) {
+        summary[f].min_ns = 1e30;
+    }
+
+    if (is_csv) {
+        printf("function,curvature,distance,step_height,ns_per_call,calls_per_sec\n");
+    } else {
+        printf("%-30s %9s %8s %11s %12s %14s\n", "function", "curvature", "distance", "step_height", "ns/call", "calls/s");
+    }
+    for (uint32_t c = 0; c < sizeof(curvature_sweep) / sizeof(curvature_sweep[0]); ++c) {
+        for (uint32_t d = 0; d < sizeof(distance_sweep) / sizeof(distance_sweep[0]); ++d) {
+            for (uint32_t h = 0; h < sizeof(step_height_sweep) / sizeof(step_height_sweep[0]); ++h) {
+                motion_cfg_t cfg = {0};
+                cfg.curvature = curvature_sweep[c];
+                cfg.distance = distance_sweep[d];
+                cfg.step_height = step_height_sweep[h];
+                prepare_samples(&cfg);
+
+                for (int32_t f = 0; f < BENCH_FUNCTIONS_COUNT; ++f) {
+                    double ns = bench_call((bench_function_t)f, &cfg, iterations);
+                    if (ns < summary[f].min_ns) summary[f].min_ns = ns;
+                    if (ns > summary[f].max_ns) summary[f].max_ns = ns;
+                    summary[f].sum_ns += ns;
+                    ++summary[f].count;
+
+                    const char* fmt = is_csv ? "%s,%d,%d,%u,%.1f,%.0f\n" : "%-30s %9d %8d %11u %12.1f %14.0f\n";
+                    printf(fmt, function_names[f], cfg.curvature, cfg.distance, cfg.step_height, ns, 1e9 / ns);
+                }
+            }
+        }
+    }
+    if (is_csv) {
+        return EXIT_SUCCESS;
+    }
+
+    // Summary. One motion tick calls each function once except mm_move_surface
+    // replaced by mm_scurve_move_surface
+    double tick_ns = 0;
+    printf("\n%-30s %12s %12s %12s %14s\n", "summary", "min ns", "mean ns", "max ns", "mean calls/s");
+    for (int32_t f = 0; f < BENCH_FUNCTIONS_COUNT; ++f) {
+        double mean_ns = summary[f].sum_ns / summary[f].count;
+        if (f != BENCH_MOVE_SURFACE) {
+            tick_ns += mean_ns;
+        }
+        printf("%-30s %12.1f %12.1f %12.1f %14.0f\n", function_names[f], summary[f].min_ns, mean_ns, summary[f].max_ns, 1e9 / mean_ns);
+    }
+    printf("\nmath per motion tick: %.1f ns (%.4f%% of %u Hz PWM period on host)\n",
+           tick_ns, tick_ns / (1e9 / PWM_MAX_FREQUENCY_HZ) * 100.0, PWM_MAX_FREQUENCY_HZ);
+    return sink == 0xFFFFFFFF ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+
+
+
+
+/// ***************************************************************************
+/// @brief  Measure one function for motion configuration
+/// @param  function: function for measure
+/// @param  cfg: motion configuration
+/// @param  iterations: calls count
+/// @return average call time [ns]
+/// ***************************************************************************
+static double bench_call(bench_function_t function, const motion_cfg_t* cfg, uint32_t iterations) {
+    limb_t limbs[SUPPORT_LIMBS_COUNT];
+    memcpy(limbs, base_limbs, sizeof(limbs));
+
+    p3d_t surface_point = { 0, BENCH_SURFACE_HEIGHT, 0 };
+    r3d_t surface_rotate = { 0, 0, 0 };
+    p3d_t src_p = surface_point;
+    r3d_t src_r = surface_rotate;
+    const p3d_t dst_p[2] = { { 0, BENCH_SURFACE_HEIGHT, 0 }, { 30, BENCH_SURFACE_HEIGHT - 20, -30 } };
+    const r3d_t dst_r[2] = { { 0, 0, 0 }, { 5, 15, -5 } };
+    surface_scurve_t scurve = {0};
+    const scurve_limits_t limits = { 300.0f, 1500.0f, 15000.0f };
+    uint32_t result = 0;
+
+    // Trajectory plan is built on motion configuration change only
+    traj_plan_t plan;
+    mm_traj_build_plan(&plan, base_pos, cfg->curvature, cfg->distance, cfg->step_height);
+
+    uint64_t start = get_time_ns();
+    for (uint32_t i = 0; i < iterations; ++i) {
+        uint32_t sample = i % TRAJ_SAMPLES_COUNT;
+        switch (function) {
+            case BENCH_TRAJ:
+                mm_traj_process_plan(limbs, &plan, &gait_table, (float)(sample * TRAJ_TIME_STEP % 1000), sample * TRAJ_TIME_STEP / 1000);
+                break;
+            case BENCH_SURFACE:
+                surface_rotate.x = (float)((int32_t)sample % 13 - 6);
+                surface_rotate.z = (float)((int32_t)sample % 11 - 5);
+                result += mm_surface_calculate_offsets(samples[sample], &surface_point, &surface_rotate);
+                break;
+            case BENCH_KINEMATIC:
+                result += mm_kinematic_calculate_angles(samples[sample]);
+                break;
+            case BENCH_MOVE_SURFACE:
+                if (mm_move_surface(&src_p, &dst_p[(i / 64) & 0x01], &src_r, &dst_r[(i / 64) & 0x01], 1.5f)) {
+                    ++result;
+                }
+                break;
+            case BENCH_SCURVE_SURFACE:
+                // Destination is changed mid-move
+                if (mm_scurve_move_surface(&scurve, &src_p, &dst_p[(i / 64) & 0x01], &src_r, &dst_r[(i / 64) & 0x01], &limits, 0.005f)) {
+                    ++result;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    uint64_t elapsed = get_time_ns() - start;
+
+    sink += result + (uint32_t)(int32_t)limbs[0].pos.x + (uint32_t)(int32_t)src_p.x;
+    return (double)elapsed / iterations;
+}
+
+/// ***************************************************************************
+/// @brief  Prepare limbs samples over gait cycle with surface offsets
+/// @param  cfg: motion configuration
+/// ***************************************************************************
+static void prepare_samples(const motion_cfg_t* cfg) {
+    const p3d_t surface_point = { 0, BENCH_SURFACE_HEIGHT, 0 };
+    const r3d_t surface_rotate = { 0, 0, 0 };
+    for (uint32_t i = 0; i < TRAJ_SAMPLES_COUNT; ++i) {
+        memcpy(samples[i], base_limbs, sizeof(base_limbs));
+        mm_process_advanced_traj(samples[i], base_pos, &gait_table, (float)(i * TRAJ_TIME_STEP % 1000), i * TRAJ_TIME_STEP / 1000,
+                                 cfg->curvature, cfg->distance, cfg->step_height);
+        mm_surface_calculate_offsets(samples[i], &surface_point, &surface_rotate);
+    }
+}
+
+/// ***************************************************************************
+/// @brief  Check S-curve move completion and velocity limit for tick patterns
+/// @return true - success, false - move isn't completed or velocity is exceeded
+/// ***************************************************************************
+static bool check_scurve(void) {
+    bool is_success = true;
+    for (uint32_t t = 0; t < sizeof(scurve_check_ticks) / sizeof(scurve_check_ticks[0]); ++t) {
+        float pos = 0;
+        scurve_axis_t axis = {0};
+        for (uint32_t m = 0; m < sizeof(scurve_check_moves) / sizeof(scurve_check_moves[0]); ++m) {
+            float time = 0;
+            float max_velocity = 0;
+            bool is_completed = false;
+            for (uint32_t i = 0; !is_completed && time < SCURVE_CHECK_MAX_MOVE_TIME; ++i) {
+                float dt = scurve_check_ticks[t][i & 0x01];
+                is_completed = mm_scurve_move(&pos, &axis, scurve_check_moves[m], &scurve_check_limits, dt);
+                max_velocity = fmaxf(max_velocity, fabsf(axis.velocity));
+                time += dt;
+            }
+            if (!is_completed || max_velocity > scurve_check_limits.velocity) {
+                fprintf(stderr, "scurve check: ticks %.3f/%.3f s, move to %.1f: %s, time %.3f s, max velocity %.2f\n",
+                        scurve_check_ticks[t][0], scurve_check_ticks[t][1], scurve_check_moves[m],
+                        is_completed ? "completed" : "not completed", time, max_velocity);
+                is_success = false;
+            }
+        }
+    }
+    return is_success;
+}
+
+/// ***************************************************************************
+/// @brief  Get monotonic time
+/// @return time [ns]
+/// ***************************************************************************
+static uint64_t get_time_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
@@ -0,0 +1,447 @@
+/// ***************************************************************************
+/// @file    motion-corpus.c
+/// @author  NeoProg
+/// @brief   Golden trajectory corpus for motion math
+/// @note    Records per tick limbs state (position, surface offsets and
+///          coxa/femur/tibia angles) for matrix of motion configurations and
+///          compares current build with recorded corpus.
+///          Usage: motion-corpus record <file>
+///                 motion-corpus compare <file> [--tol-pos mm] [--tol-offsets mm]
+///                                              [--tol-coxa deg] [--tol-femur deg]
+///                                              [--tol-tibia deg] [-v]
+///          Zero tolerance (default) is bit-for-bit compare. Fixed point
+///          build (motion-corpus-fixed) should match float corpus with
+///          0.01 tolerance of each group
+/// @note    Corpus format (host byte order, float - IEEE754 binary32):
+///          corpus_header_t, cases_count * corpus_case_t, then for each case
+///          ticks_count * SUPPORT_LIMBS_COUNT * SAMPLE_FIELDS_COUNT floats.
+///          Cases are replayed from corpus, so corpus stays valid when
+///          built-in matrix is changed
+/// ***************************************************************************
+#define _POSIX_C_SOURCE 200809L
+#include "project-base.h"
+#include "motion-core.h"
+#include "motion-math.h"
+#include "system-monitor.h"
+#include "systimer.h"
+#include "host-hal.h"
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define CORPUS_MAGIC                    (0x4D435250) // "MCRP"
+#define CORPUS_VERSION                  (1)
+#define CASE_TICKS_COUNT                (480)
+#define STAND_UP_TICKS_COUNT            (50)
+#define TICK_PERIOD_US                  (5000)
+#define MAX_CASES_COUNT                 (1024)
+#define MAX_REPORTED_CASES              (20)
+
+
+typedef enum {
+    FIELD_POS_X, FIELD_POS_Y, FIELD_POS_Z,
+    FIELD_OFFSET_X, FIELD_OFFSET_Y, FIELD_OFFSET_Z,
+    FIELD_COXA, FIELD_FEMUR, FIELD_TIBIA,
+    SAMPLE_FIELDS_COUNT
+} sample_field_t;
+
+typedef enum {
+    GROUP_POS,
+    GROUP_OFFSETS,
+    GROUP_COXA,
+    GROUP_FEMUR,
+    GROUP_TIBIA,
+    GROUPS_COUNT
+} field_group_t;
+
+#pragma pack(push, 1)
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t limbs_count;
+    uint16_t fields_count;
+    uint16_t reserved;
+    uint32_t cases_count;
+    uint32_t ticks_count;
+} corpus_header_t;
+
+typedef struct {
+    uint16_t speed;
+    int16_t  curvature;
+    int16_t  distance;
+    uint16_t step_height;
+    uint16_t ctrl;
+    uint16_t reserved;
+    float    surface_point[3];
+    float    surface_rotate[3];
+    float    hull[2];
+} corpus_case_t;
+#pragma pack(pop)
+
+typedef struct {
+    double   max_diff;
+    uint64_t failed_count;
+} group_stats_t;
+
+
+static const char* const group_names[GROUPS_COUNT] = { "position", "offsets", "coxa", "femur", "tibia" };
+static const field_group_t field_groups[SAMPLE_FIELDS_COUNT] = {
+    GROUP_POS, GROUP_POS, GROUP_POS, GROUP_OFFSETS, GROUP_OFFSETS, GROUP_OFFSETS, GROUP_COXA, GROUP_FEMUR, GROUP_TIBIA
+};
+static const char* const field_names[SAMPLE_FIELDS_COUNT] = {
+    "pos.x", "pos.y", "pos.z", "offsets.x", "offsets.y", "offsets.z", "coxa", "femur", "tibia"
+};
+
+static const int16_t  curvature_sweep[]   = { -1000, -500, -100, 0, 100, 500, 1000 };
+static const int16_t  distance_sweep[]    = { -110, -50, 50, 110 };
+static const uint16_t step_height_sweep[] = { 15, 30, 60 };
+
+// Surface cases: offsets, rotations and stabilization on tilted hull
+static const corpus_case_t surface_cases[] = {
+    { 100,    0,    0, 30, MOTION_CTRL_NO,      0, {  20, -110, -20 }, {  5, 15, -5 }, {  0,  0 } },
+    { 100,    0,    0, 30, MOTION_CTRL_NO,      0, { -30, -140,  30 }, { -6,  0,  6 }, {  0,  0 } },
+    { 100,    0,    0, 30, MOTION_CTRL_EN_STAB, 0, {   0,  -85,   0 }, {  0,  0,  0 }, {  4, -3 } },
+    {  50,    1,  110, 30, MOTION_CTRL_EN_STAB, 0, {   0, -100,   0 }, {  0,  0,  0 }, { -5,  5 } },
+    {  50, -500,  -90, 45, MOTION_CTRL_NO,      0, {  10, -120,  10 }, {  3, 10,  3 }, {  0,  0 } },
+};
+
+// Gait cases: ripple and wave gaits
+static const corpus_case_t gait_cases[] = {
+    { 100,    1,  110, 30, MOTION_CTRL_GAIT_RIPPLE, 0, { 0,  -85, 0 }, { 0, 0, 0 }, { 0, 0 } },
+    {  50, -500,  -90, 45, MOTION_CTRL_GAIT_RIPPLE, 0, { 0, -100, 0 }, { 0, 0, 0 }, { 0, 0 } },
+    { 100,    1,  110, 30, MOTION_CTRL_GAIT_WAVE,   0, { 0,  -85, 0 }, { 0, 0, 0 }, { 0, 0 } },
+    {  75,  500,   50, 60, MOTION_CTRL_GAIT_WAVE,   0, { 0, -100, 0 }, { 0, 0, 0 }, { 0, 0 } },
+};
+
+static corpus_case_t cases[MAX_CASES_COUNT];
+static uint32_t cases_count = 0;
+static double tolerances[GROUPS_COUNT] = {0};
+
+
+static void make_matrix(void);
+static bool record(const char* path);
+static bool compare(const char* path, bool is_verbose);
+static void run_case(const corpus_case_t* c, float* samples);
+static bool run_case_isolated(const corpus_case_t* c, float* samples);
+static bool is_equal(float expected, float actual, double tolerance);
+
+
+/// ***************************************************************************
+/// @brief  Program entry point
+/// ***************************************************************************
+int main(int argc, char* argv[]) {
+    if (argc < 3 || (strcmp(argv[1], "record") != 0 && strcmp(argv[1], "compare") != 0)) {
+        fprintf(stderr, "Usage: %s record <file>\n"
+                        "       %s compare <file> [--tol-pos mm] [--tol-offsets mm] [--tol-coxa deg] [--tol-femur deg] [--tol-tibia deg] [-v]\n",
+                argv[0], argv[0]);
+        return EXIT_FAILURE;
+    }
+    bool is_record = strcmp(argv[1], "record") == 0;
+    const char* path = argv[2];
+
+    bool is_verbose = false;
+    for (int i = 3; i < argc; ++i) {
+        if (strcmp(argv[i], "--tol-pos") == 0 && i + 1 < argc) {
+            tolerances[GROUP_POS] = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--tol-offsets") == 0 && i + 1 < argc) {
+            tolerances[GROUP_OFFSETS] = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--tol-coxa") == 0 && i + 1 < argc) {
+            tolerances[GROUP_COXA] = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--tol-femur") == 0 && i + 1 < argc) {
+            tolerances[GROUP_FEMUR] = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--tol-tibia") == 0 && i + 1 < argc) {
+            tolerances[GROUP_TIBIA] = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-v") == 0) {
+            is_verbose = true;
+        } else {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (is_record) {
+        make_matrix();
+        return record(path) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    return compare(path, is_verbose) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+
+
+
+/// ***************************************************************************
+/// @brief  Make built-in cases matrix
+/// ***************************************************************************
+static void make_matrix(void) {
+    for (uint32_t c = 0; c < sizeof(curvature_sweep) / sizeof(curvature_sweep[0]); ++c) {
+        for (uint32_t d = 0; d < sizeof(distance_sweep) / sizeof(distance_sweep[0]); ++d) {
+            for (uint32_t h = 0; h < sizeof(step_height_sweep) / sizeof(step_height_sweep[0]); ++h) {
+                corpus_case_t* item = &cases[cases_count++];
+                memset(item, 0, sizeof(*item));
+                item->speed = 100;
+                item->curvature = curvature_sweep[c];
+                item->distance = distance_sweep[d];
+                item->step_height = step_height_sweep[h];
+                item->ctrl = MOTION_CTRL_NO;
+                item->surface_point[1] = -85;
+            }
+        }
+    }
+    memcpy(&cases[cases_count], surface_cases, sizeof(surface_cases));
+    cases_count += sizeof(surface_cases) / sizeof(surface_cases[0]);
+    memcpy(&cases[cases_count], gait_cases, sizeof(gait_cases));
+    cases_count += sizeof(gait_cases) / sizeof(gait_cases[0]);
+}
+
+/// ***************************************************************************
+/// @brief  Record corpus
+/// @param  path: corpus file path
+/// @return true - success, false - error
+/// ***************************************************************************
+static bool record(const char* path) {
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        fprintf(stderr, "Can't create corpus file %s\n", path);
+        return false;
+    }
+
+    corpus_header_t header = {0};
+    header.magic = CORPUS_MAGIC;
+    header.version = CORPUS_VERSION;
+    header.limbs_count = SUPPORT_LIMBS_COUNT;
+    header.fields_count = SAMPLE_FIELDS_COUNT;
+    header.cases_count = cases_count;
+    header.ticks_count = CASE_TICKS_COUNT;
+    bool is_ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                 fwrite(cases, sizeof(corpus_case_t), cases_count, file) == cases_count;
+
+    size_t samples_count = CASE_TICKS_COUNT * SUPPORT_LIMBS_COUNT * SAMPLE_FIELDS_COUNT;
+    float* samples = calloc(samples_count, sizeof(float));
+    for (uint32_t i = 0; is_ok && i < cases_count; ++i) {
+        is_ok = samples && run_case_isolated(&cases[i], samples) &&
+                fwrite(samples, sizeof(float), samples_count, file) == samples_count;
+    }
+    free(samples);
+    if (fclose(file) != 0 || !is_ok) {
+        fprintf(stderr, "Corpus recording failed\n");
+        return false;
+    }
+    printf("recorded %u cases x %u ticks to %s\n", cases_count, CASE_TICKS_COUNT, path);
+    return true;
+}
+
+/// ***************************************************************************
+/// @brief  Compare current build with corpus
+/// @param  path: corpus file path
+/// @param  is_verbose: true - print each mismatch
+/// @return true - all samples in tolerances, false - mismatch or error
+/// ***************************************************************************
+static bool compare(const char* path, bool is_verbose) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "Can't open corpus file %s\n", path);
+        return false;
+    }
+
+    corpus_header_t header = {0};
+    if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != CORPUS_MAGIC || header.version != CORPUS_VERSION ||
+        header.limbs_count != SUPPORT_LIMBS_COUNT || header.fields_count != SAMPLE_FIELDS_COUNT ||
+        header.cases_count > MAX_CASES_COUNT || header.ticks_count == 0) {
+        fprintf(stderr, "Wrong corpus file format\n");
+        fclose(file);
+        return false;
+    }
+    cases_count = header.cases_count;
+    if (fread(cases, sizeof(corpus_case_t), cases_count, file) != cases_count) {
+        fprintf(stderr, "Corpus file is truncated\n");
+        fclose(file);
+        return false;
+    }
+
+    size_t samples_count = (size_t)header.ticks_count * SUPPORT_LIMBS_COUNT * SAMPLE_FIELDS_COUNT;
+    float* expected = calloc(samples_count, sizeof(float));
+    float* actual = calloc(samples_count, sizeof(float));
+    if (!expected || !actual) {
+        fprintf(stderr, "Out of memory\n");
+        fclose(file);
+        return false;
+    }
+
+    group_stats_t stats[GROUPS_COUNT] = {0};
+    uint32_t failed_cases = 0;
+    bool is_ok = true;
+    for (uint32_t i = 0; i < cases_count; ++i) {
+        if (fread(expected, sizeof(float), samples_count, file) != samples_count) {
+            fprintf(stderr, "Corpus file is truncated\n");
+            is_ok = false;
+            break;
+        }
+        if (header.ticks_count != CASE_TICKS_COUNT || !run_case_isolated(&cases[i], actual)) {
+            fprintf(stderr, "Case %u replay failed\n", i);
+            is_ok = false;
+            break;
+        }
+
+        // Compare samples, first mismatch of case is reported
+        bool is_case_failed = false;
+        for (size_t s = 0; s < samples_count; ++s) {
+            uint32_t field = s % SAMPLE_FIELDS_COUNT;
+            field_group_t group = field_groups[field];
+            double diff = fabs((double)expected[s] - (double)actual[s]);
+            if (diff > stats[group].max_diff || isnan(diff)) {
+                stats[group].max_diff = isnan(diff) ? INFINITY : diff;
+            }
+            if (is_equal(expected[s], actual[s], tolerances[group])) {
+                continue;
+            }
+            ++stats[group].failed_count;
+            if (is_verbose || (!is_case_failed && failed_cases < MAX_REPORTED_CASES)) {
+                const corpus_case_t* c = &cases[i];
+                printf("case %3u (curvature %5d, distance %4d, step height %2u): tick %3u limb %u %-9s expected %.9g, actual %.9g\n",
+                       i, c->curvature, c->distance, c->step_height, (uint32_t)(s / (SUPPORT_LIMBS_COUNT * SAMPLE_FIELDS_COUNT)),
+                       (uint32_t)(s / SAMPLE_FIELDS_COUNT % SUPPORT_LIMBS_COUNT), field_names[field], expected[s], actual[s]);
+            }
+            if (!is_case_failed) {
+                is_case_failed = true;
+                ++failed_cases;
+            }
+        }
+    }
+    fclose(file);
+    free(expected);
+    free(actual);
+    if (!is_ok) {
+        return false;
+    }
+
+    if (!is_verbose && failed_cases > MAX_REPORTED_CASES) {
+        printf("... and %u more failed cases\n", failed_cases - MAX_REPORTED_CASES);
+    }
+    printf("\n%-10s %12s %14s %10s\n", "group", "tolerance", "max diff", "failed");
+    for (uint32_t g = 0; g < GROUPS_COUNT; ++g) {
+        printf("%-10s %12.6f %14.9f %10llu\n", group_names[g], tolerances[g], stats[g].max_diff, (unsigned long long)stats[g].failed_count);
+    }
+    printf("\ncases: %u, failed: %u\n", cases_count, failed_cases);
+    return failed_cases == 0;
+}
+
+/// ***************************************************************************
+/// @brief  Run case from power on state, main loop order as in firmware
+/// @param  c: case
+/// @param  samples: samples buffer
+/// ***************************************************************************
+static void run_case(const corpus_case_t* c, float* samples) {
+    host_clock_reset();
+    systimer_init();
+    sysmon_init();
+    motion_core_init();
+    host_sensors_set_orientation(c->hull[0], c->hull[1]);
+
+    ext_motion_t stand_up = {0};
+    stand_up.cfg.speed = 100;
+    stand_up.surface_point.y = -85;
+
+    ext_motion_t motion = {0};
+    motion.cfg.speed = c->speed;
+    motion.cfg.curvature = c->curvature;
+    motion.cfg.distance = c->distance;
+    motion.cfg.step_height = c->step_height;
+    motion.ctrl = c->ctrl;
+    motion.surface_point.x = c->surface_point[0];
+    motion.surface_point.y = c->surface_point[1];
+    motion.surface_point.z = c->surface_point[2];
+    motion.surface_rotate.x = c->surface_rotate[0];
+    motion.surface_rotate.y = c->surface_rotate[1];
+    motion.surface_rotate.z = c->surface_rotate[2];
+
+    for (uint32_t tick = 0; tick < CASE_TICKS_COUNT; ++tick) {
+        motion_core_move((tick < STAND_UP_TICKS_COUNT) ? &stand_up : &motion);
+        motion_core_process();
+
+        const limb_t* limbs = motion_core_get_limbs();
+        for (uint32_t i = 0; i < SUPPORT_LIMBS_COUNT; ++i) {
+            float* sample = &samples[(tick * SUPPORT_LIMBS_COUNT + i) * SAMPLE_FIELDS_COUNT];
+            sample[FIELD_POS_X]    = limbs[i].pos.x;
+            sample[FIELD_POS_Y]    = limbs[i].pos.y;
+            sample[FIELD_POS_Z]    = limbs[i].pos.z;
+            sample[FIELD_OFFSET_X] = limbs[i].surface_offsets.x;
+            sample[FIELD_OFFSET_Y] = limbs[i].surface_offsets.y;
+            sample[FIELD_OFFSET_Z] = limbs[i].surface_offsets.z;
+            sample[FIELD_COXA]     = limbs[i].coxa.angle;
+            sample[FIELD_FEMUR]    = limbs[i].femur.angle;
+            sample[FIELD_TIBIA]    = limbs[i].tibia.angle;
+        }
+        host_clock_advance_us(TICK_PERIOD_US);
+    }
+}
+
+/// ***************************************************************************
+/// @brief  Run case in child process
+/// @note   Motion core state can't be reset, so each case starts from clean
+///         process image
+/// @param  c: case
+/// @param  samples: samples buffer
+/// @return true - success, false - error
+/// ***************************************************************************
+static bool run_case_isolated(const corpus_case_t* c, float* samples) {
+    int fd[2];
+    if (pipe(fd) != 0) {
+        return false;
+    }
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fd[0]);
+        close(fd[1]);
+        return false;
+    }
+    size_t size = CASE_TICKS_COUNT * SUPPORT_LIMBS_COUNT * SAMPLE_FIELDS_COUNT * sizeof(float);
+    if (pid == 0) {
+        close(fd[0]);
+        run_case(c, samples);
+        const uint8_t* data = (const uint8_t*)samples;
+        bool is_ok = true;
+        while (size != 0) {
+            ssize_t n = write(fd[1], data, size);
+            if (n <= 0) {
+                is_ok = false;
+                break;
+            }
+            data += n;
+            size -= (size_t)n;
+        }
+        close(fd[1]);
+        _exit(is_ok ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    close(fd[1]);
+    uint8_t* data = (uint8_t*)samples;
+    while (size != 0) {
+        ssize_t n = read(fd[0], data, size);
+        if (n <= 0) {
+            break;
+        }
+        data += n;
+        size -= (size_t)n;
+    }
+    close(fd[0]);
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return size == 0 && WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS;
+}
+
+/// ***************************************************************************
+/// @brief  Compare samples
+/// @note   Zero tolerance compares bit patterns (NaN is equal to same NaN)
+/// @param  expected: corpus value
+/// @param  actual: current value
+/// @param  tolerance: max absolute difference
+/// @return true - values are equal, false - otherwise
+/// ***************************************************************************
+static bool is_equal(float expected, float actual, double tolerance) {
+    if (memcmp(&expected, &actual, sizeof(float)) == 0) {
+        return true;
+    }
+    return isfinite(expected) && isfinite(actual) && fabs((double)expected - (double)actual) <= tolerance;
+}
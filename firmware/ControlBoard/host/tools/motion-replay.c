@@ -0,0 +1,202 @@
+/// ***************************************************************************
+/// @file    motion-replay.c
+/// @author  NeoProg
+/// @brief   Motion record replay
+/// @note    Replays motion record dump (CLI "record dump") tick-exact:
+///          motion core is initialized, state is loaded from record snapshot
+///          and recorded external motions and tick inputs are passed to
+///          motion core. Limbs angles are checked on each tick by angles
+///          hash of record.
+///          Usage: motion-replay <file> [-v]
+///          File can be raw CLI output, dump is searched by header
+/// ***************************************************************************
+#define _POSIX_C_SOURCE 200809L
+#include "project-base.h"
+#include "motion-core.h"
+#include "motion-record.h"
+#include "system-monitor.h"
+#include "systimer.h"
+#include "host-hal.h"
+
+#define MAX_FILE_SIZE                   (1024 * 1024)
+#define MAX_REPORTED_MISMATCHES         (20)
+
+
+static const motion_record_header_t* find_dump(const uint8_t* data, uint32_t size);
+static void print_angles(void);
+
+
+/// ***************************************************************************
+/// @brief  Program entry point
+/// ***************************************************************************
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <file> [-v]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    bool is_verbose = (argc >= 3 && strcmp(argv[2], "-v") == 0);
+
+    // Load dump
+    static uint8_t data[MAX_FILE_SIZE];
+    FILE* file = fopen(argv[1], "rb");
+    if (!file) {
+        fprintf(stderr, "Failed to open %s\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+    uint32_t size = (uint32_t)fread(data, 1, sizeof(data), file);
+    fclose(file);
+
+    const motion_record_header_t* header = find_dump(data, size);
+    if (!header) {
+        fprintf(stderr, "Motion record dump is not found\n");
+        return EXIT_FAILURE;
+    }
+#ifdef MOTION_MATH_FIXED_POINT
+    bool is_fixed_point = true;
+#else
+    bool is_fixed_point = false;
+#endif
+    if (((header->flags & MOTION_RECORD_FLAG_FIXED_POINT) != 0) != is_fixed_point) {
+        fprintf(stderr, "Record is made by %s point motion math, replay by same build\n", is_fixed_point ? "float" : "fixed");
+        return EXIT_FAILURE;
+    }
+
+    // Initialize motion core as firmware and load state
+    host_clock_reset();
+    systimer_init();
+    sysmon_init();
+    motion_core_init();
+    const uint8_t* state = (const uint8_t*)(header + 1);
+    if (!motion_core_load_state(state, header->state_size)) {
+        fprintf(stderr, "Motion core state size %u is not match, record is made by other firmware version\n", header->state_size);
+        return EXIT_FAILURE;
+    }
+
+    // Replay records
+    const uint8_t* cursor = state + header->state_size;
+    const uint8_t* end = cursor + header->records_size;
+    uint64_t time_us = 0;
+    bool is_time_valid = false;
+    uint32_t ticks = 0;
+    uint32_t moves = 0;
+    uint32_t resets = 0;
+    uint32_t times = 0;
+    uint32_t mismatches = 0;
+    uint32_t math_errors = 0;
+    while (cursor < end) {
+        uint8_t type = *cursor;
+        if (type == MOTION_RECORD_MOVE && end - cursor >= (int32_t)sizeof(motion_record_move_t)) {
+            motion_record_move_t record;
+            memcpy(&record, cursor, sizeof(record));
+            ext_motion_t motion = {0};
+            motion.cfg.speed        = record.speed;
+            motion.cfg.curvature    = record.curvature;
+            motion.cfg.distance     = record.distance;
+            motion.cfg.step_height  = record.step_height;
+            motion.ctrl             = record.ctrl;
+            motion.surface_point.x  = record.surface_point_x;
+            motion.surface_point.y  = record.surface_point_y;
+            motion.surface_point.z  = record.surface_point_z;
+            motion.surface_rotate.x = record.surface_rotate_x;
+            motion.surface_rotate.y = record.surface_rotate_y;
+            motion.surface_rotate.z = record.surface_rotate_z;
+            motion_core_move(&motion);
+            cursor += sizeof(record);
+            ++moves;
+        }
+        else if (type == MOTION_RECORD_RESET) {
+            motion_core_move(NULL);
+            cursor += 1;
+            ++resets;
+        }
+        else if (type == MOTION_RECORD_TIME && end - cursor >= (int32_t)sizeof(motion_record_time_t)) {
+            motion_record_time_t record;
+            memcpy(&record, cursor, sizeof(record));
+            cursor += sizeof(record);
+            if (record.time_us < get_time_us()) {
+                fprintf(stderr, "Tick %u: time goes back\n", ticks);
+                return EXIT_FAILURE;
+            }
+            time_us = record.time_us;
+            is_time_valid = true;
+            ++times;
+        }
+        else if (type == MOTION_RECORD_TICK && end - cursor >= (int32_t)sizeof(motion_record_tick_t)) {
+            motion_record_tick_t record;
+            memcpy(&record, cursor, sizeof(record));
+            cursor += sizeof(record);
+            if (!is_time_valid) {
+                fprintf(stderr, "Tick %u: time record is missed\n", ticks);
+                return EXIT_FAILURE;
+            }
+            time_us += record.dt_us;
+
+            // Angles on tick start are result of previous tick
+            uint32_t hash = motion_record_hash_angles(motion_core_get_limbs());
+            if (hash != record.angles_hash) {
+                if (is_verbose && mismatches < MAX_REPORTED_MISMATCHES) {
+                    printf("tick %u (%.3f ms): angles hash 0x%08X, recorded 0x%08X\n",
+                           ticks, (double)time_us / 1000.0, hash, record.angles_hash);
+                }
+                ++mismatches;
+            }
+
+            host_clock_advance_us(time_us - get_time_us());
+            host_sensors_set_orientation(record.orientation_x, record.orientation_z);
+            if (record.foot_contacts & MOTION_RECORD_CONTACTS_VALID) {
+                host_sensors_set_foot_contacts(record.foot_contacts & ~MOTION_RECORD_CONTACTS_VALID);
+            } else {
+                host_sensors_clear_foot_contacts();
+            }
+            motion_core_process();
+            if (sysmon_is_error_set(SYSMON_MATH_ERROR)) {
+                if (is_verbose) {
+                    printf("tick %u (%.3f ms): math error\n", ticks, (double)time_us / 1000.0);
+                }
+                ++math_errors;
+            }
+            ++ticks;
+        }
+        else {
+            fprintf(stderr, "Bad record type 0x%02X at offset %ld\n", type, (long)(cursor - data));
+            return EXIT_FAILURE;
+        }
+    }
+
+    bool is_final_match = motion_record_hash_angles(motion_core_get_limbs()) == header->angles_hash;
+    printf("records:             %u ticks, %u moves, %u resets, %u times\n", ticks, moves, resets, times);
+    printf("time:                %.3f ms\n", (double)get_time_us() / 1000.0);
+    printf("angles mismatches:   %u\n", mismatches);
+    printf("final angles:        %s\n", is_final_match ? "match" : "mismatch");
+    printf("math errors:         %u\n", math_errors);
+    print_angles();
+    return (mismatches == 0 && is_final_match) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/// ***************************************************************************
+/// @brief  Find dump in data
+/// @param  data: file data
+/// @param  size: file size
+/// @return dump header or NULL
+/// ***************************************************************************
+static const motion_record_header_t* find_dump(const uint8_t* data, uint32_t size) {
+    for (uint32_t offset = 0; offset + sizeof(motion_record_header_t) <= size; ++offset) {
+        const motion_record_header_t* header = (const motion_record_header_t*)&data[offset];
+        if (header->magic == MOTION_RECORD_MAGIC && header->version == MOTION_RECORD_VERSION &&
+            offset + sizeof(*header) + header->state_size + header->records_size <= size) {
+            return header;
+        }
+    }
+    return NULL;
+}
+
+/// ***************************************************************************
+/// @brief  Print limbs angles
+/// ***************************************************************************
+static void print_angles(void) {
+    const limb_t* limbs = motion_core_get_limbs();
+    printf("\nlimb      coxa     femur     tibia\n");
+    for (uint32_t i = 0; i < SUPPORT_LIMBS_COUNT; ++i) {
+        printf("%4u %9.4f %9.4f %9.4f\n", i, limbs[i].coxa.angle, limbs[i].femur.angle, limbs[i].tibia.angle);
+    }
+}
@@ -0,0 +1,445 @@
+/// ***************************************************************************
+/// @file    pwm-budget.c
+/// @author  NeoProg
+/// @brief   PWM period budget analyzer
+/// @note    Replays full main loop tick on host: motion_core_process(),
+///          servo_driver_process() and pwm_swap_buffers() with real servo
+///          and PWM drivers.
+///          Usage: pwm-budget [-s script] [-r repeats] [-k cycles_per_ns] [--csv]
+/// @note    Script format, one segment per line ('#' - comment):
+///          ticks speed curvature distance step_height ctrl px py pz rx ry rz [hull_x hull_z]
+/// ***************************************************************************
+#define _POSIX_C_SOURCE 200809L
+#include "project-base.h"
+#include "motion-core.h"
+#include "servo-driver.h"
+#include "pwm.h"
+#include "system-monitor.h"
+#include "systimer.h"
+#include "host-hal.h"
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define DEFAULT_REPEATS                 (5)
+#define MAX_SEGMENTS_COUNT              (256)
+#define MAX_TICKS_COUNT                 (1000000)
+
+// TIM17_IRQHandler replays waveform by compare interrupts, so main loop loses
+// short ISR time for each channel pulse end only
+#define ISR_EDGE_COST_US                (1)
+#define ISR_PULSE_WINDOW_US             (SUPPORT_PWM_CHANNELS_COUNT * ISR_EDGE_COST_US)
+
+// Calibration kernel cost on Cortex-M4F: 4 dependent VMUL/VADD (1 cycle each),
+// VDIV (14 cycles), VSQRT (14 cycles) and loop overhead (3 cycles)
+#define CALIBRATION_M4_CYCLES           (35.0)
+#define CALIBRATION_ITERATIONS          (2000000)
+
+
+typedef struct {
+    uint32_t ticks;
+    ext_motion_t motion;
+    float hull_x;
+    float hull_z;
+} segment_t;
+
+typedef struct {
+    uint32_t cost_ns;
+    uint32_t frequency;
+    uint32_t speed;
+} tick_t;
+
+
+// Synthetic gait sequence: stand up, walk with all speeds, turn, arc with
+// stabilization on tilted hull, surface rotation and stop
+static const segment_t synthetic_segments[] = {
+    { 100, { {  0,     0,    0, 30 }, MOTION_CTRL_NO,      { 0, -85,  0 }, { 0, 0,  0 } }, 0, 0 },
+    { 300, { {  0,     1,  110, 30 }, MOTION_CTRL_NO,      { 0, -85,  0 }, { 0, 0,  0 } }, 0, 0 },
+    { 300, { { 25,     1,  110, 30 }, MOTION_CTRL_NO,      { 0, -85,  0 }, { 0, 0,  0 } }, 0, 0 },
+    { 300, { { 50,     1,  110, 30 }, MOTION_CTRL_NO,      { 0, -85,  0 }, { 0, 0,  0 } }, 0, 0 },
+    { 300, { { 75,     1,  110, 30 }, MOTION_CTRL_NO,      { 0, -85,  0 }, { 0, 0,  0 } }, 0, 0 },
+    { 300, { { 100,    1,  110, 30 }, MOTION_CTRL_NO,      { 0, -85,  0 }, { 0, 0,  0 } }, 0, 0 },
+    { 300, { { 100, 1000,   90, 60 }, MOTION_CTRL_NO,      { 0, -85,  0 }, { 0, 0,  0 } }, 0, 0 },
+    { 300, { { 50,  -500,  -90, 15 }, MOTION_CTRL_EN_STAB, { 0, -100, 0 }, { 0, 0,  0 } }, 4, -3 },
+    { 200, { { 100,    0,    0, 30 }, MOTION_CTRL_NO,      { 20, -110, -20 }, { 5, 15, -5 } }, 0, 0 },
+    { 200, { { 100,    0,    0, 30 }, MOTION_CTRL_NO,      { 0, -85,  0 }, { 0, 0,  0 } }, 0, 0 },
+};
+
+static segment_t segments[MAX_SEGMENTS_COUNT];
+static uint32_t segments_count = 0;
+static uint32_t ticks_count = 0;
+
+
+static bool load_script(const char* path);
+static void warm_up(void);
+static bool run_sequence(tick_t* ticks);
+static bool run_sequence_isolated(tick_t* ticks);
+static double calibrate_cycles_per_ns(void);
+static int compare_u32(const void* a, const void* b);
+static void print_stats(const char* name, uint32_t* cost_ns, uint32_t count, uint32_t frequency, double cycles_per_ns, bool is_csv);
+static uint64_t get_time_ns(void);
+
+
+/// ***************************************************************************
+/// @brief  Program entry point
+/// ***************************************************************************
+int main(int argc, char* argv[]) {
+    const char* script_path = NULL;
+    uint32_t repeats = DEFAULT_REPEATS;
+    double cycles_per_ns = 0;
+    bool is_csv = false;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            script_path = argv[++i];
+        } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            repeats = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-k") == 0 && i + 1 < argc) {
+            cycles_per_ns = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--csv") == 0) {
+            is_csv = true;
+        } else {
+            fprintf(stderr, "Usage: %s [-s script] [-r repeats] [-k cycles_per_ns] [--csv]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (repeats == 0) {
+        repeats = DEFAULT_REPEATS;
+    }
+
+    // Load gait sequence
+    if (script_path) {
+        if (!load_script(script_path)) {
+            return EXIT_FAILURE;
+        }
+    } else {
+        segments_count = sizeof(synthetic_segments) / sizeof(synthetic_segments[0]);
+        memcpy(segments, synthetic_segments, sizeof(synthetic_segments));
+    }
+    for (uint32_t i = 0; i < segments_count; ++i) {
+        ticks_count += segments[i].ticks;
+    }
+    if (ticks_count == 0 || ticks_count > MAX_TICKS_COUNT) {
+        fprintf(stderr, "Wrong ticks count in sequence: %u\n", ticks_count);
+        return EXIT_FAILURE;
+    }
+
+    // Each repeat starts from power on state. Per tick minimum over repeats
+    // removes host scheduler noise but keeps data dependent cost
+    tick_t* ticks  = calloc(ticks_count, sizeof(tick_t));
+    tick_t* result = calloc(ticks_count, sizeof(tick_t));
+    if (!ticks || !result) {
+        fprintf(stderr, "Out of memory\n");
+        return EXIT_FAILURE;
+    }
+    for (uint32_t r = 0; r < repeats; ++r) {
+        if (!run_sequence_isolated(ticks)) {
+            fprintf(stderr, "Sequence run failed\n");
+            return EXIT_FAILURE;
+        }
+        for (uint32_t i = 0; i < ticks_count; ++i) {
+            if (r == 0 || ticks[i].cost_ns < result[i].cost_ns) {
+                result[i] = ticks[i];
+            }
+        }
+    }
+    bool is_calibrated = isless(cycles_per_ns, 0.000001);
+    if (is_calibrated) {
+        cycles_per_ns = calibrate_cycles_per_ns();
+    }
+
+    // Statistics: all ticks and ticks by speed setting. PWM frequency does
+    // not depend on speed, speed is time scale of motion clock
+    uint32_t* cost_ns = calloc(ticks_count, sizeof(uint32_t));
+    if (!cost_ns) {
+        fprintf(stderr, "Out of memory\n");
+        return EXIT_FAILURE;
+    }
+    if (is_csv) {
+        printf("group,frequency_hz,ticks,mean_ns,p99_ns,worst_ns,worst_m4_cycles,worst_m4_us,budget_us,worst_of_budget_pct,worst_of_5ms_pct,worst_of_16.6ms_pct\n");
+    } else {
+        printf("ticks: %u, repeats: %u, M4F estimate: %.3f cycles/ns (%s)\n\n", ticks_count, repeats, cycles_per_ns, is_calibrated ? "calibrated" : "user");
+        printf("%-8s %6s %7s %10s %10s %10s %12s %10s %10s %8s %8s %8s\n", "group", "freq", "ticks", "mean ns", "p99 ns", "worst ns",
+               "worst cyc", "worst us", "budget us", "%budget", "%5ms", "%16.6ms");
+    }
+    for (uint32_t i = 0; i < ticks_count; ++i) {
+        cost_ns[i] = result[i].cost_ns;
+    }
+    print_stats("all", cost_ns, ticks_count, PWM_MAX_FREQUENCY_HZ, cycles_per_ns, is_csv);
+    for (uint32_t speed = 0; speed <= 100; ++speed) {
+        uint32_t count = 0;
+        uint32_t frequency = PWM_MAX_FREQUENCY_HZ;
+        for (uint32_t i = 0; i < ticks_count; ++i) {
+            if (result[i].speed == speed) {
+                cost_ns[count++] = result[i].cost_ns;
+                frequency = result[i].frequency;
+            }
+        }
+        if (count != 0) {
+            char name[16];
+            snprintf(name, sizeof(name), "speed%u", speed);
+            print_stats(name, cost_ns, count, frequency, cycles_per_ns, is_csv);
+        }
+    }
+
+    free(cost_ns);
+    free(result);
+    free(ticks);
+    return EXIT_SUCCESS;
+}
+
+
+
+
+
+/// ***************************************************************************
+/// @brief  Load gait sequence script
+/// @param  path: script file path
+/// @return true - success, false - error
+/// ***************************************************************************
+static bool load_script(const char* path) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "Can't open script file %s\n", path);
+        return false;
+    }
+
+    char line[256];
+    uint32_t line_number = 0;
+    while (fgets(line, sizeof(line), file)) {
+        ++line_number;
+        char* comment = strchr(line, '#');
+        if (comment) {
+            *comment = '\0';
+        }
+
+        segment_t s = {0};
+        int speed = 0, curvature = 0, distance = 0, step_height = 0, ctrl = 0;
+        int fields = sscanf(line, "%u %d %d %d %d %i %f %f %f %f %f %f %f %f", &s.ticks, &speed, &curvature, &distance, &step_height, &ctrl,
+                            &s.motion.surface_point.x, &s.motion.surface_point.y, &s.motion.surface_point.z,
+                            &s.motion.surface_rotate.x, &s.motion.surface_rotate.y, &s.motion.surface_rotate.z,
+                            &s.hull_x, &s.hull_z);
+        if (fields <= 0) {
+            continue; // Empty line
+        }
+        if (fields != 12 && fields != 14) {
+            fprintf(stderr, "%s:%u: wrong segment format\n", path, line_number);
+            fclose(file);
+            return false;
+        }
+        if (segments_count >= MAX_SEGMENTS_COUNT) {
+            fprintf(stderr, "%s:%u: too many segments\n", path, line_number);
+            fclose(file);
+            return false;
+        }
+        s.motion.cfg.speed = (uint16_t)speed;
+        s.motion.cfg.curvature = (int16_t)curvature;
+        s.motion.cfg.distance = (int16_t)distance;
+        s.motion.cfg.step_height = (uint16_t)step_height;
+        s.motion.ctrl = (uint16_t)ctrl;
+        segments[segments_count++] = s;
+    }
+    fclose(file);
+    return true;
+}
+
+/// ***************************************************************************
+/// @brief  Warm up child process
+/// @note   Child process gets copy-on-write pages and cold caches. Run math
+///         and PWM paths before measurements. Motion core state isn't changed
+///         and channels widths are reloaded by first servo_driver_process()
+/// ***************************************************************************
+static void warm_up(void) {
+    limb_t limbs[SUPPORT_LIMBS_COUNT];
+    v3d_t base_pos[SUPPORT_LIMBS_COUNT];
+    memcpy(limbs, motion_core_get_limbs(), sizeof(limbs));
+    for (int32_t i = 0; i < SUPPORT_LIMBS_COUNT; ++i) {
+        base_pos[i] = limbs[i].pos;
+    }
+
+    gait_table_t gait_table;
+    mm_gait_build_table(&gait_table, GAIT_TRIPOD);
+
+    const p3d_t surface_point = { 0, -85, 0 };
+    const r3d_t surface_rotate = { 0, 0, 0 };
+    for (int32_t i = 0; i < 100; ++i) {
+        mm_process_advanced_traj(limbs, base_pos, &gait_table, (float)(i * 20 % 1000), i * 20 / 1000, 1, 110, 30);
+        mm_surface_calculate_offsets(limbs, &surface_point, &surface_rotate);
+        mm_kinematic_calculate_angles(limbs);
+    }
+    for (int32_t i = 0; i < 100; ++i) {
+        pwm_swap_buffers();
+    }
+}
+
+/// ***************************************************************************
+/// @brief  Replay gait sequence, main loop order as in firmware
+/// @param  ticks: ticks result buffer
+/// @return true - success, false - firmware error while replay
+/// ***************************************************************************
+static bool run_sequence(tick_t* ticks) {
+    host_clock_reset();
+    systimer_init();
+    sysmon_init();
+    servo_driver_init();
+    motion_core_init();
+    warm_up();
+
+    uint32_t tick = 0;
+    for (uint32_t s = 0; s < segments_count; ++s) {
+        host_sensors_set_orientation(segments[s].hull_x, segments[s].hull_z);
+        for (uint32_t i = 0; i < segments[s].ticks; ++i, ++tick) {
+            motion_core_move(&segments[s].motion);
+
+            uint64_t start = get_time_ns();
+            motion_core_process();
+            servo_driver_process();
+            pwm_swap_buffers();
+            uint64_t elapsed = get_time_ns() - start;
+
+            ticks[tick].cost_ns = (uint32_t)elapsed;
+            ticks[tick].frequency = pwm_get_frequency();
+            ticks[tick].speed = (segments[s].motion.cfg.speed > 100) ? 100 : segments[s].motion.cfg.speed;
+            host_clock_advance_us(1000000 / ticks[tick].frequency);
+
+            if (sysmon_is_module_disable(SYSMON_MODULE_SERVO_DRIVER) || sysmon_is_module_disable(SYSMON_MODULE_MOTION_CORE)) {
+                fprintf(stderr, "Module disabled at tick %u, system status 0x%02X\n", tick, sysmon_system_status);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/// ***************************************************************************
+/// @brief  Replay gait sequence in child process
+/// @note   Firmware modules state can't be reset, so each run starts from
+///         clean process image
+/// @param  ticks: ticks result buffer
+/// @return true - success, false - error
+/// ***************************************************************************
+static bool run_sequence_isolated(tick_t* ticks) {
+    int fd[2];
+    if (pipe(fd) != 0) {
+        return false;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fd[0]);
+        close(fd[1]);
+        return false;
+    }
+    if (pid == 0) {
+        close(fd[0]);
+        bool is_ok = run_sequence(ticks);
+        const uint8_t* data = (const uint8_t*)ticks;
+        size_t size = ticks_count * sizeof(tick_t);
+        while (is_ok && size != 0) {
+            ssize_t n = write(fd[1], data, size);
+            if (n <= 0) {
+                is_ok = false;
+                break;
+            }
+            data += n;
+            size -= (size_t)n;
+        }
+        close(fd[1]);
+        _exit(is_ok ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    close(fd[1]);
+    uint8_t* data = (uint8_t*)ticks;
+    size_t size = ticks_count * sizeof(tick_t);
+    while (size != 0) {
+        ssize_t n = read(fd[0], data, size);
+        if (n <= 0) {
+            break;
+        }
+        data += n;
+        size -= (size_t)n;
+    }
+    close(fd[0]);
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return size == 0 && WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS;
+}
+
+/// ***************************************************************************
+/// @brief  Estimate Cortex-M4F cycles per host nanosecond
+/// @note   Rough estimate by kernel with known cycles count on Cortex-M4F
+/// @return cycles per ns
+/// ***************************************************************************
+static double calibrate_cycles_per_ns(void) {
+    volatile float seed = 1.0001f;
+    float x = seed;
+    float acc = 0;
+
+    uint64_t best_ns = UINT64_MAX;
+    for (int32_t pass = 0; pass < 3; ++pass) {
+        uint64_t start = get_time_ns();
+        for (uint32_t i = 0; i < CALIBRATION_ITERATIONS; ++i) {
+            x = x * 0.9999f + 0.0001f;
+            x = x * 1.0001f - 0.0001f;
+            acc += sqrtf(x) / (x + 1.0f);
+        }
+        uint64_t elapsed = get_time_ns() - start;
+        if (elapsed < best_ns) {
+            best_ns = elapsed;
+        }
+    }
+    seed = acc;
+
+    double ns_per_iteration = (double)best_ns / CALIBRATION_ITERATIONS;
+    return CALIBRATION_M4_CYCLES / ns_per_iteration;
+}
+
+/// ***************************************************************************
+/// @brief  Compare function for qsort
+/// ***************************************************************************
+static int compare_u32(const void* a, const void* b) {
+    uint32_t va = *(const uint32_t*)a;
+    uint32_t vb = *(const uint32_t*)b;
+    return (va > vb) - (va < vb);
+}
+
+/// ***************************************************************************
+/// @brief  Print ticks group statistics
+/// @param  name: group name
+/// @param  cost_ns: ticks cost [ns], will be sorted
+/// @param  count: ticks count
+/// @param  frequency: PWM frequency for budget [Hz]
+/// @param  cycles_per_ns: Cortex-M4F cycles per host ns
+/// @param  is_csv: true - CSV output
+/// ***************************************************************************
+static void print_stats(const char* name, uint32_t* cost_ns, uint32_t count, uint32_t frequency, double cycles_per_ns, bool is_csv) {
+    qsort(cost_ns, count, sizeof(uint32_t), compare_u32);
+
+    double sum = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        sum += cost_ns[i];
+    }
+    double mean_ns  = sum / count;
+    double p99_ns   = cost_ns[(count - 1) * 99 / 100];
+    double worst_ns = cost_ns[count - 1];
+
+    double worst_cycles = worst_ns * cycles_per_ns;
+    double worst_us     = worst_cycles / (SYSTEM_CLOCK_FREQUENCY / 1000000);
+    double budget_us    = 1000000.0 / frequency - ISR_PULSE_WINDOW_US;
+    double of_budget    = worst_us / budget_us * 100.0;
+    double of_max_freq  = worst_us / (1000000.0 / PWM_MAX_FREQUENCY_HZ) * 100.0;
+    double of_min_freq  = worst_us / (1000000.0 / PWM_MIN_FREQUENCY_HZ) * 100.0;
+
+    const char* fmt = is_csv ? "%s,%u,%u,%.0f,%.0f,%.0f,%.0f,%.1f,%.0f,%.2f,%.2f,%.2f\n"
+                             : "%-8s %6u %7u %10.0f %10.0f %10.0f %12.0f %10.1f %10.0f %8.2f %8.2f %8.2f\n";
+    printf(fmt, name, frequency, count, mean_ns, p99_ns, worst_ns, worst_cycles, worst_us, budget_us, of_budget, of_max_freq, of_min_freq);
+}
+
+/// ***************************************************************************
+/// @brief  Get monotonic time
+/// @return time [ns]
+/// ***************************************************************************
+static uint64_t get_time_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
@@ -0,0 +1,331 @@
+/// ***************************************************************************
+/// @file    pwm-schedule-bench.c
+/// @author  NeoProg
+/// @brief   Benchmark of PWM edge schedule builder against previous qsort
+///          implementation
+/// @note    Each scenario is sequence of PWM periods, channels order is kept
+///          between periods as in PWM driver. Schedule time includes waveform
+///          table compile. Schedule is checked: it is sorted by widths,
+///          waveform table resets each reachable channel once at its
+///          width, edges are merged by port and tick. Previous implementation
+///          (double qsort with "equals / 3" compensation) is timed only.
+///          Times include clock_gettime() overhead.
+///          Usage: pwm-schedule-bench [-n periods] [--csv]
+/// ***************************************************************************
+#define _POSIX_C_SOURCE 199309L
+#include "project-base.h"
+#include "pwm.h"
+#include "pwm-schedule.h"
+#include <time.h>
+
+#define DEFAULT_PERIODS_COUNT           (20000)
+#define PERIOD_REPEATS_COUNT            (5)
+#define CHANNELS_COUNT                  (SUPPORT_PWM_CHANNELS_COUNT)
+#define WORST_CASE_MOVES                (CHANNELS_COUNT * (CHANNELS_COUNT - 1) / 2)
+
+
+typedef enum {
+    SCENARIO_GAIT,          // Slowly changed widths
+    SCENARIO_RANDOM,        // Random widths each period
+    SCENARIO_GROUPS,        // Random widths from 3 values, big groups of equal channels
+    SCENARIO_EQUAL,         // All channels are equal
+    SCENARIO_INVERSION,     // Order is inverted each period (worst case for insertion sort)
+    SCENARIOS_COUNT
+} scenario_t;
+
+typedef struct {
+    uint32_t ticks;         // Pulse end time with compensation, [us]
+} legacy_channel_t;
+
+typedef struct {
+    double mean_ns;
+    double p99_ns;
+    double max_ns;
+    uint32_t max_moves;
+} result_t;
+
+
+static const char* const scenario_names[SCENARIOS_COUNT] = {
+    "gait", "random", "groups", "equal", "inversion"
+};
+
+static pwm_channel_t channels[CHANNELS_COUNT];
+static pwm_channel_t* schedule[CHANNELS_COUNT];
+static legacy_channel_t legacy_channels[CHANNELS_COUNT];
+static legacy_channel_t* legacy_schedule[CHANNELS_COUNT];
+static pwm_waveform_t waveform;
+static double samples[2][DEFAULT_PERIODS_COUNT * 10];
+
+
+static void make_widths(scenario_t scenario, uint32_t period, uint32_t* widths);
+static void legacy_schedule_build(legacy_channel_t** legacy, uint32_t count);
+static int legacy_compare_channels(const void* a, const void* b);
+static bool check_schedules(void);
+static void make_result(double* ns, uint32_t count, uint32_t max_moves, result_t* result);
+static int compare_doubles(const void* a, const void* b);
+static uint64_t get_time_ns(void);
+
+
+/// ***************************************************************************
+/// @brief  Program entry point
+/// ***************************************************************************
+int main(int argc, char* argv[]) {
+    uint32_t periods_count = DEFAULT_PERIODS_COUNT;
+    bool is_csv = false;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            periods_count = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--csv") == 0) {
+            is_csv = true;
+        } else {
+            fprintf(stderr, "Usage: %s [-n periods] [--csv]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    uint32_t max_periods_count = sizeof(samples[0]) / sizeof(samples[0][0]);
+    if (periods_count == 0 || periods_count > max_periods_count) {
+        periods_count = DEFAULT_PERIODS_COUNT;
+    }
+
+    if (is_csv) {
+        printf("scenario,implementation,mean_ns,p99_ns,max_ns,max_moves\n");
+    } else {
+        printf("%-10s %-8s %10s %10s %10s %10s\n", "scenario", "impl", "mean ns", "p99 ns", "max ns", "max moves");
+    }
+    bool is_success = true;
+    uint32_t total_max_moves = 0;
+    for (int32_t s = 0; s < SCENARIOS_COUNT; ++s) {
+        for (uint32_t i = 0; i < CHANNELS_COUNT; ++i) {
+            channels[i].width = 0;
+            channels[i].gpio_port = (i < 16) ? GPIOA : GPIOB;
+            channels[i].gpio_pin = i % 16;
+            channels[i].index = i;
+            legacy_channels[i].ticks = 0;
+            schedule[i] = &channels[i];
+            legacy_schedule[i] = &legacy_channels[i];
+        }
+        srand(1);
+
+        uint32_t max_moves = 0;
+        for (uint32_t p = 0; p < periods_count; ++p) {
+            uint32_t widths[CHANNELS_COUNT];
+            make_widths((scenario_t)s, p, widths);
+
+            // Each period is repeated from same state, best time is taken for
+            // filter host preemptions. Max time over periods is worst case
+            pwm_channel_t* prev_schedule[CHANNELS_COUNT];
+            legacy_channel_t* prev_legacy_schedule[CHANNELS_COUNT];
+            memcpy(prev_schedule, schedule, sizeof(schedule));
+            memcpy(prev_legacy_schedule, legacy_schedule, sizeof(legacy_schedule));
+            uint32_t moves = 0;
+            samples[0][p] = samples[1][p] = 1e30;
+            for (uint32_t r = 0; r < PERIOD_REPEATS_COUNT; ++r) {
+                memcpy(schedule, prev_schedule, sizeof(schedule));
+                memcpy(legacy_schedule, prev_legacy_schedule, sizeof(legacy_schedule));
+                for (uint32_t i = 0; i < CHANNELS_COUNT; ++i) {
+                    channels[i].width = widths[i];
+                    legacy_channels[i].ticks = widths[i];
+                }
+
+                uint64_t start = get_time_ns();
+                moves = pwm_schedule_build(schedule, CHANNELS_COUNT);
+                pwm_schedule_compile(&waveform, schedule, CHANNELS_COUNT);
+                uint64_t middle = get_time_ns();
+                legacy_schedule_build(legacy_schedule, CHANNELS_COUNT);
+                uint64_t end = get_time_ns();
+                samples[0][p] = fmin(samples[0][p], (double)(middle - start));
+                samples[1][p] = fmin(samples[1][p], (double)(end - middle));
+            }
+
+            if (moves > max_moves) {
+                max_moves = moves;
+            }
+            if (!check_schedules()) {
+                fprintf(stderr, "%s: schedules mismatch at period %u\n", scenario_names[s], p);
+                is_success = false;
+                break;
+            }
+        }
+        if (max_moves > total_max_moves) {
+            total_max_moves = max_moves;
+        }
+
+        result_t results[2];
+        make_result(samples[0], periods_count, max_moves, &results[0]);
+        make_result(samples[1], periods_count, 0, &results[1]);
+        for (int32_t r = 0; r < 2; ++r) {
+            const char* name = (r == 0) ? "schedule" : "qsort";
+            if (is_csv) {
+                printf("%s,%s,%.1f,%.1f,%.1f,%u\n", scenario_names[s], name, results[r].mean_ns, results[r].p99_ns, results[r].max_ns, results[r].max_moves);
+            } else if (r == 0) {
+                printf("%-10s %-8s %10.1f %10.1f %10.1f %10u\n", scenario_names[s], name, results[r].mean_ns, results[r].p99_ns, results[r].max_ns, results[r].max_moves);
+            } else {
+                printf("%-10s %-8s %10.1f %10.1f %10.1f %10s\n", "", name, results[r].mean_ns, results[r].p99_ns, results[r].max_ns, "-");
+            }
+        }
+    }
+    if (!is_csv) {
+        printf("\nmax moves: %u, worst case bound: %u\n", total_max_moves, WORST_CASE_MOVES);
+    }
+    if (total_max_moves > WORST_CASE_MOVES) {
+        is_success = false;
+    }
+    return is_success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+
+
+
+/// ***************************************************************************
+/// @brief  Make channels widths for period
+/// @param  scenario: scenario
+/// @param  period: period index
+/// @param  widths: widths [us]
+/// ***************************************************************************
+static void make_widths(scenario_t scenario, uint32_t period, uint32_t* widths) {
+    for (uint32_t i = 0; i < CHANNELS_COUNT; ++i) {
+        switch (scenario) {
+            case SCENARIO_GAIT:
+                widths[i] = (uint32_t)(1500.0 + 400.0 * sin(period * 0.02 + i * 0.7));
+                break;
+            case SCENARIO_RANDOM:
+                widths[i] = 500 + (uint32_t)(rand() % 2000);
+                break;
+            case SCENARIO_GROUPS:
+                widths[i] = 1000 + (uint32_t)(rand() % 3) * 500;
+                break;
+            case SCENARIO_EQUAL:
+                widths[i] = 1500;
+                break;
+            case SCENARIO_INVERSION:
+                widths[i] = (period & 0x01) ? 1000 + i * 50 : 2000 - i * 50;
+                break;
+            default:
+                widths[i] = 1500;
+                break;
+        }
+    }
+}
+
+/// ***************************************************************************
+/// @brief  Previous implementation from PWM driver
+/// ***************************************************************************
+static void legacy_schedule_build(legacy_channel_t** legacy, uint32_t count) {
+    // Sorting PWM channels
+    qsort(legacy, count, sizeof(legacy[0]), legacy_compare_channels);
+
+    // Apply ticks compensation (-1us by each 3 equals channels)
+    for (uint32_t i = 0, equals = 0, prev_value = 0; i < count; ++i) {
+        if (prev_value == legacy[i]->ticks) {
+            ++equals;
+        } else {
+            prev_value = legacy[i]->ticks;
+            equals = 0;
+        }
+        legacy[i]->ticks -= equals / 3;
+    }
+
+    // Sorting PWM channels
+    qsort(legacy, count, sizeof(legacy[0]), legacy_compare_channels);
+}
+
+/// ***************************************************************************
+/// @brief  qsort compare function
+/// ***************************************************************************
+static int legacy_compare_channels(const void* a, const void* b) {
+    legacy_channel_t* ch1 = *(legacy_channel_t**)a;
+    legacy_channel_t* ch2 = *(legacy_channel_t**)b;
+    if (ch1->ticks > ch2->ticks) return  1;
+    if (ch1->ticks < ch2->ticks) return -1;
+    return 0;
+}
+
+/// ***************************************************************************
+/// @brief  Check schedule and waveform table
+/// @return true - success, false - mismatch
+/// ***************************************************************************
+static bool check_schedules(void) {
+    for (uint32_t i = 0; i < CHANNELS_COUNT; ++i) {
+        if (i > 0 && schedule[i - 1]->width > schedule[i]->width) {
+            return false;
+        }
+    }
+
+    // Replay waveform table: each reachable channel should be reset once at
+    // its width, port and tick pair should have one edge only
+    uint32_t reset_ticks[CHANNELS_COUNT];
+    for (uint32_t i = 0; i < CHANNELS_COUNT; ++i) {
+        reset_ticks[i] = UINT32_MAX;
+    }
+    for (uint32_t e = 0; e < waveform.count; ++e) {
+        const pwm_edge_t* edge = &waveform.edges[e];
+        if (e > 0 && waveform.edges[e - 1].ticks > edge->ticks) {
+            return false;
+        }
+        for (uint32_t p = 0; p < e; ++p) {
+            if (waveform.edges[p].ticks == edge->ticks && waveform.edges[p].gpio_port == edge->gpio_port) {
+                return false;
+            }
+        }
+        uint32_t mask = 0;
+        for (uint32_t i = 0; i < CHANNELS_COUNT; ++i) {
+            if ((edge->channels & (0x01u << i)) == 0) {
+                continue;
+            }
+            if (reset_ticks[i] != UINT32_MAX || channels[i].gpio_port != edge->gpio_port) {
+                return false;
+            }
+            reset_ticks[i] = edge->ticks;
+            mask |= 0x01u << channels[i].gpio_pin;
+        }
+        if (mask != edge->mask) {
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < CHANNELS_COUNT; ++i) {
+        uint32_t expected = (channels[i].width <= PWM_SCHEDULE_MAX_TICKS) ? channels[i].width : UINT32_MAX;
+        if (reset_ticks[i] != expected) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// ***************************************************************************
+/// @brief  Calculate statistics
+/// @param  ns: call times, sorted on exit
+/// @param  count: samples count
+/// @param  max_moves: max moves count
+/// @param  result: statistics
+/// ***************************************************************************
+static void make_result(double* ns, uint32_t count, uint32_t max_moves, result_t* result) {
+    double sum = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        sum += ns[i];
+    }
+    qsort(ns, count, sizeof(ns[0]), compare_doubles);
+    result->mean_ns = sum / count;
+    result->p99_ns = ns[(uint32_t)((count - 1) * 0.99)];
+    result->max_ns = ns[count - 1];
+    result->max_moves = max_moves;
+}
+
+/// ***************************************************************************
+/// @brief  qsort compare function for doubles
+/// ***************************************************************************
+static int compare_doubles(const void* a, const void* b) {
+    double v1 = *(const double*)a;
+    double v2 = *(const double*)b;
+    return (v1 > v2) - (v1 < v2);
+}
+
+/// ***************************************************************************
+/// @brief  Get host monotonic time
+/// @return time [ns]
+/// ***************************************************************************
+static uint64_t get_time_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
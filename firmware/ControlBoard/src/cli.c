@@ -8,6 +8,8 @@
 #include "system-monitor.h"
 #include "servo-driver.h"
 #include "motion-core.h"
+#include "motion-script.h"
+#include "motion-record.h"
 #include "indication.h"
 #include "version.h"
 #define COMMUNICATION_BAUD_RATE                     (1000000)
@@ -101,6 +103,24 @@ void cli_send_data(const char* data) {
     usart1_start_sync_tx(strlen(tx_buffer));
 }
 
+/// ***************************************************************************
+/// @brief  CLI send binary data
+/// @note   Data is sent by TX buffer size parts, TX buffer content is lost
+/// @param  data: data for send
+/// @param  size: data size
+/// ***************************************************************************
+void cli_send_binary(const void* data, uint32_t size) {
+    uint8_t* tx_buffer = usart1_get_tx_buffer();
+    const uint8_t* cursor = (const uint8_t*)data;
+    while (size > 0) {
+        uint32_t bytes_count = (size > USART1_TX_BUFFER_SIZE) ? USART1_TX_BUFFER_SIZE : size;
+        memcpy(tx_buffer, cursor, bytes_count);
+        usart1_start_sync_tx(bytes_count);
+        cursor += bytes_count;
+        size -= bytes_count;
+    }
+}
+
 
 
 
@@ -149,7 +169,21 @@ static bool process_command(const char* module, const char* cmd, char (*argv)[CL
                 return cmd_list[i].handler(argv, argc, response);
             }
         }
-    }*/ else if (strcmp(module, "indication") == 0) {
+    }*/ else if (strcmp(module, "script") == 0) {
+        const cli_cmd_t* cmd_list = motion_script_get_cmd_list(&cmd_list_size);
+        for (uint32_t i = 0; i < cmd_list_size; ++i) {
+            if (strcmp(cmd, cmd_list[i].cmd) == 0) {
+                return cmd_list[i].handler(argv, argc, response);
+            }
+        }
+    } else if (strcmp(module, "record") == 0) {
+        const cli_cmd_t* cmd_list = motion_record_get_cmd_list(&cmd_list_size);
+        for (uint32_t i = 0; i < cmd_list_size; ++i) {
+            if (strcmp(cmd, cmd_list[i].cmd) == 0) {
+                return cmd_list[i].handler(argv, argc, response);
+            }
+        }
+    } else if (strcmp(module, "indication") == 0) {
         const cli_cmd_t* cmd_list = indication_get_cmd_list(&cmd_list_size);
         for (uint32_t i = 0; i < cmd_list_size; ++i) {
             if (strcmp(cmd, cmd_list[i].cmd) == 0) {
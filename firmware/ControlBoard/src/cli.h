@@ -37,6 +37,7 @@ extern void cli_init(void);
 extern void cli_process(void);
 extern void* cli_get_tx_buffer(void);
 extern void cli_send_data(const char* data);
+extern void cli_send_binary(const void* data, uint32_t size);
 
 
 #endif // _CLI_H_
@@ -7,6 +7,7 @@
 #include "mpu6050.h"
 #include "i2c2.h"
 #include "systimer.h"
+#include "fast-math.h"
 #define MPU6050_I2C_ADDRESS                 (0x68 << 1)
 #define INTERRUPT_PIN                       GPIOA, 12
 #define CHIP_ID                             (0x34)
@@ -418,8 +419,8 @@ bool mpu6050_read_data(float* xy_angles) {
     Q[3] = raw_q[3] / 16384.0f;
 
     // Euler angles
-    xy_angles[0] = atan2(2.0f * (Q[0] * Q[1] + Q[2] * Q[3]), 1.0f - 2.0f * (Q[1] * Q[1] + Q[2] * Q[2]));
-    xy_angles[1] = asin(2.0f * (Q[0] * Q[2] - Q[3] * Q[1]));
+    xy_angles[0] = mm_fast_atan2(2.0f * (Q[0] * Q[1] + Q[2] * Q[3]), 1.0f - 2.0f * (Q[1] * Q[1] + Q[2] * Q[2]));
+    xy_angles[1] = mm_fast_asin(2.0f * (Q[0] * Q[2] - Q[3] * Q[1]));
     xy_angles[0] *= 180.0f / M_PI;
     xy_angles[1] *= 180.0f / M_PI;
     
@@ -0,0 +1,93 @@
+/// ***************************************************************************
+/// @file    pwm-schedule.c
+/// @author  NeoProg
+/// ***************************************************************************
+#include "project-base.h"
+#include "pwm-schedule.h"
+
+
+static uint32_t insertion_sort(pwm_channel_t** schedule, uint32_t count);
+
+
+/// ***************************************************************************
+/// @brief  Build edge schedule
+/// @note   Insertion sort uses channels order of previous period, so for
+///         slowly changed widths cost is O(n). Worst case (order inversion)
+///         is n * (n - 1) / 2 moves
+/// @param  schedule: channels, sorted by pwm_channel_t::width on exit
+/// @param  count: channels count
+/// @return moved channels count
+/// ***************************************************************************
+uint32_t pwm_schedule_build(pwm_channel_t** schedule, uint32_t count) {
+    return insertion_sort(schedule, count);
+}
+
+
+/// ***************************************************************************
+/// @brief  Compile edge schedule to waveform table
+/// @note   Table is replayed by TIM17 compare ISR: edges with ticks less or
+///         equal TIM17->CNT are written to BRR registers. Channels of same
+///         port with equal ticks are merged to one edge, so they are reset by
+///         single store. Channels with ticks more than longest PWM period are
+///         disabled and not compiled
+/// @param  waveform: waveform table
+/// @param  schedule: channels sorted by pwm_schedule_build()
+/// @param  count: channels count
+/// ***************************************************************************
+void pwm_schedule_compile(pwm_waveform_t* waveform, pwm_channel_t* const* schedule, uint32_t count) {
+    uint32_t edges_count = 0;
+    uint32_t group_begin = 0; // First edge with current ticks
+    for (uint32_t i = 0; i < count; ++i) {
+        const pwm_channel_t* channel = schedule[i];
+        if (channel->width > PWM_SCHEDULE_MAX_TICKS) {
+            break; // Schedule is sorted, other channels are disabled too
+        }
+        if (edges_count == 0 || waveform->edges[group_begin].ticks != channel->width) {
+            group_begin = edges_count;
+        }
+        
+        // Find edge of channel port in current ticks group
+        uint32_t e = group_begin;
+        while (e < edges_count && waveform->edges[e].gpio_port != channel->gpio_port) {
+            ++e;
+        }
+        pwm_edge_t* edge = &waveform->edges[e];
+        if (e == edges_count) {
+            edge->ticks = (uint16_t)channel->width;
+            edge->mask = 0;
+            edge->gpio_port = channel->gpio_port;
+            edge->channels = 0;
+            ++edges_count;
+        }
+        edge->mask |= (uint16_t)(0x01u << channel->gpio_pin);
+        edge->channels |= 0x01u << channel->index;
+    }
+    waveform->count = edges_count;
+}
+
+
+
+
+
+/// ***************************************************************************
+/// @brief  Sort channels by width
+/// @param  schedule: channels
+/// @param  count: channels count
+/// @return moved channels count
+/// ***************************************************************************
+static uint32_t insertion_sort(pwm_channel_t** schedule, uint32_t count) {
+    uint32_t moves = 0;
+    for (uint32_t i = 1; i < count; ++i) {
+        pwm_channel_t* channel = schedule[i];
+        uint32_t j = i;
+        while (j > 0 && schedule[j - 1]->width > channel->width) {
+            schedule[j] = schedule[j - 1];
+            --j;
+        }
+        if (j != i) {
+            schedule[j] = channel;
+            moves += i - j;
+        }
+    }
+    return moves;
+}
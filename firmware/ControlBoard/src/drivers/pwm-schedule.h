@@ -0,0 +1,37 @@
+/// ***************************************************************************
+/// @file    pwm-schedule.h
+/// @author  NeoProg
+/// @brief   Edge schedule builder for PWM driver
+/// ***************************************************************************
+#ifndef _PWM_SCHEDULE_H_
+#define _PWM_SCHEDULE_H_
+#include "pwm.h"
+
+#define PWM_SCHEDULE_MAX_TICKS                      (1000000 / PWM_MIN_FREQUENCY_HZ)
+
+
+typedef struct {
+    uint32_t width;          // Pulse width from pwm_set_width(), pulse end time [us]
+    GPIO_TypeDef* gpio_port;
+    uint32_t gpio_pin;
+    uint32_t index;          // Channel index for pwm_set_width()
+} pwm_channel_t;
+
+typedef struct {
+    uint16_t ticks;          // Edge time from period start, [us]
+    uint16_t mask;           // GPIOx->BRR value, all port channels with this ticks
+    GPIO_TypeDef* gpio_port;
+    uint32_t channels;       // Channel indexes bitmask
+} pwm_edge_t;
+
+typedef struct {
+    uint32_t count;
+    pwm_edge_t edges[SUPPORT_PWM_CHANNELS_COUNT];
+} pwm_waveform_t;
+
+
+extern uint32_t pwm_schedule_build(pwm_channel_t** schedule, uint32_t count);
+extern void pwm_schedule_compile(pwm_waveform_t* waveform, pwm_channel_t* const* schedule, uint32_t count);
+
+
+#endif // _PWM_SCHEDULE_H_
@@ -4,50 +4,54 @@
 /// ***************************************************************************
 #include "project-base.h"
 #include "pwm.h"
+#include "pwm-schedule.h"
 #include "system-monitor.h"
 
 static_assert(1000000 / PWM_MIN_FREQUENCY_HZ <= 65535, "PWM period should be less 65535 ticks (1 tick = 1us), check PWM_MIN_FREQUENCY_HZ value");
 static_assert(1000000 / PWM_MAX_FREQUENCY_HZ >= 3000, "PWM period should be more 3000 ticks (1 tick = 1us), check PWM_MAX_FREQUENCY_HZ value");
 
 #define PWM_CHANNEL_DISABLE_VALUE           (0xFFFF)
+#define PWM_SYNC_ERROR_HOLD_TICKS           (200)       // 1s at 200 Hz
 
 
-typedef struct {
-    uint32_t ticks;
-    GPIO_TypeDef* gpio_port;
-    uint32_t gpio_pin;
-} pwm_channel_t;
-
-static int compare_channels(const void* a, const void* b);
-
-// Active array of pointers to channels (sorted)
-// To this buffer can access from IRQ handler
+// Array of pointers to channels (sorted) and waveform tables compiled from it.
+// IRQ handler replays active table, main loop fills other (back) table and
+// publishes it by single pointer write. Published table is started by next
+// PWM period
 static pwm_channel_t* pwm_channels_ptr[SUPPORT_PWM_CHANNELS_COUNT]; 
+static pwm_waveform_t pwm_waveforms[2] = {0};
+static pwm_waveform_t* volatile pwm_active_waveform = &pwm_waveforms[0];
+static pwm_waveform_t* volatile pwm_pending_waveform = NULL;
+static uint32_t pwm_edge_cursor = 0;
 static pwm_channel_t pwm_channels[SUPPORT_PWM_CHANNELS_COUNT] = {
-    { .gpio_port = GPIOD, .gpio_pin =  8, .ticks = PWM_CHANNEL_DISABLE_VALUE },
-    { .gpio_port = GPIOB, .gpio_pin = 15, .ticks = PWM_CHANNEL_DISABLE_VALUE },
-    { .gpio_port = GPIOB, .gpio_pin = 14, .ticks = PWM_CHANNEL_DISABLE_VALUE },
-    { .gpio_port = GPIOE, .gpio_pin =  9, .ticks = PWM_CHANNEL_DISABLE_VALUE },
-    { .gpio_port = GPIOE, .gpio_pin =  8, .ticks = PWM_CHANNEL_DISABLE_VALUE },
-    { .gpio_port = GPIOB, .gpio_pin =  2, .ticks = PWM_CHANNEL_DISABLE_VALUE },
-    { .gpio_port = GPIOB, .gpio_pin =  1, .ticks = PWM_CHANNEL_DISABLE_VALUE },
-    { .gpio_port = GPIOB, .gpio_pin =  0, .ticks = PWM_CHANNEL_DISABLE_VALUE },
-    { .gpio_port = GPIOC, .gpio_pin =  5, .ticks = PWM_CHANNEL_DISABLE_VALUE },
+    { .gpio_port = GPIOD, .gpio_pin =  8, .width = PWM_CHANNEL_DISABLE_VALUE },
+    { .gpio_port = GPIOB, .gpio_pin = 15, .width = PWM_CHANNEL_DISABLE_VALUE },
+    { .gpio_port = GPIOB, .gpio_pin = 14, .width = PWM_CHANNEL_DISABLE_VALUE },
+    { .gpio_port = GPIOE, .gpio_pin =  9, .width = PWM_CHANNEL_DISABLE_VALUE },
+    { .gpio_port = GPIOE, .gpio_pin =  8, .width = PWM_CHANNEL_DISABLE_VALUE },
+    { .gpio_port = GPIOB, .gpio_pin =  2, .width = PWM_CHANNEL_DISABLE_VALUE },
+    { .gpio_port = GPIOB, .gpio_pin =  1, .width = PWM_CHANNEL_DISABLE_VALUE },
+    { .gpio_port = GPIOB, .gpio_pin =  0, .width = PWM_CHANNEL_DISABLE_VALUE },
+    { .gpio_port = GPIOC, .gpio_pin =  5, .width = PWM_CHANNEL_DISABLE_VALUE },
     
-    { .gpio_port = GPIOA, .gpio_pin =  0, .ticks = PWM_CHANNEL_DISABLE_VALUE },
-    { .gpio_port = GPIOA, .gpio_pin =  1, .ticks = PWM_CHANNEL_DISABLE_VALUE },
-    { .gpio_port = GPIOA, .gpio_pin =  2, .ticks = PWM_CHANNEL_DISABLE_VALUE },
-    { .gpio_port = GPIOA, .gpio_pin =  3, .ticks = PWM_CHANNEL_DISABLE_VALUE },
-    { .gpio_port = GPIOA, .gpio_pin =  4, .ticks = PWM_CHANNEL_DISABLE_VALUE },
-    { .gpio_port = GPIOA, .gpio_pin =  5, .ticks = PWM_CHANNEL_DISABLE_VALUE },
-    { .gpio_port = GPIOA, .gpio_pin =  6, .ticks = PWM_CHANNEL_DISABLE_VALUE },
-    { .gpio_port = GPIOA, .gpio_pin =  7, .ticks = PWM_CHANNEL_DISABLE_VALUE },
-    { .gpio_port = GPIOC, .gpio_pin =  4, .ticks = PWM_CHANNEL_DISABLE_VALUE },
+    { .gpio_port = GPIOA, .gpio_pin =  0, .width = PWM_CHANNEL_DISABLE_VALUE },
+    { .gpio_port = GPIOA, .gpio_pin =  1, .width = PWM_CHANNEL_DISABLE_VALUE },
+    { .gpio_port = GPIOA, .gpio_pin =  2, .width = PWM_CHANNEL_DISABLE_VALUE },
+    { .gpio_port = GPIOA, .gpio_pin =  3, .width = PWM_CHANNEL_DISABLE_VALUE },
+    { .gpio_port = GPIOA, .gpio_pin =  4, .width = PWM_CHANNEL_DISABLE_VALUE },
+    { .gpio_port = GPIOA, .gpio_pin =  5, .width = PWM_CHANNEL_DISABLE_VALUE },
+    { .gpio_port = GPIOA, .gpio_pin =  6, .width = PWM_CHANNEL_DISABLE_VALUE },
+    { .gpio_port = GPIOA, .gpio_pin =  7, .width = PWM_CHANNEL_DISABLE_VALUE },
+    { .gpio_port = GPIOC, .gpio_pin =  4, .width = PWM_CHANNEL_DISABLE_VALUE },
 };
 static uint32_t pwm_frequency = PWM_START_FREQUENCY_HZ;
-static bool pwm_locked = false;
 static bool pwm_ready = false;
-static bool pwm_sync_enabled = false;
+static uint32_t pwm_overruns_count = 0;
+static uint32_t pwm_last_overruns_count = 0;
+static uint32_t pwm_sync_error_hold_ticks = 0;
+#ifndef NDEBUG
+static pwm_stats_t pwm_stats = {0};
+#endif
 
 // Pre-calculated GPIOx BSR register values
 static uint16_t pwm_gpio_a_bsr = 0;
@@ -57,6 +61,12 @@ static uint16_t pwm_gpio_d_bsr = 0;
 static uint16_t pwm_gpio_e_bsr = 0;
 
 
+static void process_edges(void);
+#ifndef NDEBUG
+static void timing_add(pwm_timing_t* timing, int32_t error);
+#endif
+
+
 /// ***************************************************************************
 /// @brief  PWM driver initialization
 /// @param  frequency: frequency [Hz]
@@ -64,10 +74,13 @@ static uint16_t pwm_gpio_e_bsr = 0;
 void pwm_init(uint32_t frequency) {
     pwm_frequency = frequency;
     
-    // Initialization active buffer
+    // Initialization channels order and waveform tables (all channels disabled)
     for (uint32_t i = 0; i < SUPPORT_PWM_CHANNELS_COUNT; ++i) {
+        pwm_channels[i].index = i;
         pwm_channels_ptr[i] = &pwm_channels[i];
     }
+    pwm_active_waveform = &pwm_waveforms[1];
+    pwm_pending_waveform = &pwm_waveforms[0];
 
     // Setup GPIO
     for (uint32_t i = 0; i < SUPPORT_PWM_CHANNELS_COUNT; ++i) {
@@ -109,55 +122,83 @@ void pwm_set_state(bool is_enable) {
 }
 
 /// ***************************************************************************
-/// @brief  Set PWM frequency
-/// @param  frequency: frequency [Hz]
+/// @brief  Get PWM frequency
+/// @return frequency [Hz]
 /// ***************************************************************************
-void pwm_set_frequency(uint32_t frequency) {
-    if (frequency < PWM_MIN_FREQUENCY_HZ) {
-        frequency = PWM_MIN_FREQUENCY_HZ;
-    }
-    if (frequency > PWM_MAX_FREQUENCY_HZ) {
-        frequency = PWM_MAX_FREQUENCY_HZ;
-    }
-    pwm_frequency = frequency;
+uint32_t pwm_get_frequency(void) {
+    return pwm_frequency;
 }
 
 /// ***************************************************************************
-/// @brief  Lock channels
-/// @param  is_locked: true - buffer is lock, false - buffer is unlock
+/// @brief  Publish channels pulse widths
+/// @note   Schedule is compiled to back waveform table, table is published by
+///         single pointer write and started by next PWM period. Call from
+///         main loop each motion tick
 /// ***************************************************************************
-void pwm_set_lock_state(bool is_locked) {
-    if (!is_locked) {
-        // Sorting PWM channels
-        qsort(pwm_channels_ptr, SUPPORT_PWM_CHANNELS_COUNT, sizeof(pwm_channels_ptr[0]), compare_channels);
-        
-        // Apply ticks compensation (-1us by each 3 equals channels)
-        for (uint32_t i = 0, equals = 0, prev_value = 0; i < SUPPORT_PWM_CHANNELS_COUNT; ++i) {
-            if (prev_value == pwm_channels_ptr[i]->ticks) {
-                ++equals;
-            } else {
-                prev_value = pwm_channels_ptr[i]->ticks;
-                equals = 0;
-            }
-            pwm_channels_ptr[i]->ticks -= equals / 3;
-        }
-        
-        // Sorting PWM channels
-        qsort(pwm_channels_ptr, SUPPORT_PWM_CHANNELS_COUNT, sizeof(pwm_channels_ptr[0]), compare_channels);
+void pwm_swap_buffers(void) {
+    pwm_waveform_t* back = (pwm_active_waveform == &pwm_waveforms[0]) ? &pwm_waveforms[1] : &pwm_waveforms[0];
+    pwm_schedule_build(pwm_channels_ptr, SUPPORT_PWM_CHANNELS_COUNT);
+    pwm_schedule_compile(back, pwm_channels_ptr, SUPPORT_PWM_CHANNELS_COUNT);
+    pwm_pending_waveform = back;
+
+    // Report overruns by SYSMON_SYNC_ERROR. Error is cleared after
+    // PWM_SYNC_ERROR_HOLD_TICKS ticks without overruns
+    uint32_t overruns_count = pwm_overruns_count;
+    if (overruns_count != pwm_last_overruns_count) {
+        pwm_last_overruns_count = overruns_count;
+        pwm_sync_error_hold_ticks = PWM_SYNC_ERROR_HOLD_TICKS;
+        sysmon_set_error(SYSMON_SYNC_ERROR);
+    } else if (pwm_sync_error_hold_ticks != 0 && --pwm_sync_error_hold_ticks == 0) {
+        sysmon_clear_error(SYSMON_SYNC_ERROR);
     }
-    pwm_locked = is_locked;
 }
 
 /// ***************************************************************************
 /// @brief  Check PWM ready for load pulse width
-/// @note   Setting each PWM period
+/// @note   Setting each PWM period. PWM is not ready while published table
+///         is not started, because back table is not free
 /// ***************************************************************************
 bool pwm_is_ready(void) {
+    if (pwm_pending_waveform != NULL) {
+        return false;
+    }
     bool f = pwm_ready;
     pwm_ready = false;
     return f;
 }
 
+/// ***************************************************************************
+/// @brief  Get overruns count
+/// @note   Overrun is PWM period without new published table. Previous table
+///         is repeated for this period
+/// @return overruns count
+/// ***************************************************************************
+uint32_t pwm_get_overruns_count(void) {
+    return pwm_overruns_count;
+}
+
+#ifndef NDEBUG
+/// ***************************************************************************
+/// @brief  Get edge timing statistics
+/// @note   Period start is not measured: TIM17 stops on update event in one
+///         pulse mode, so ISR latency is measured for compare events only
+/// @return statistics, NULL - statistics is not available
+/// ***************************************************************************
+const pwm_stats_t* pwm_get_stats(void) {
+    return &pwm_stats;
+}
+
+/// ***************************************************************************
+/// @brief  Reset edge timing statistics
+/// ***************************************************************************
+void pwm_reset_stats(void) {
+    uint32_t irq_state = __get_interrupt_state();
+    __disable_interrupt();
+    memset(&pwm_stats, 0, sizeof(pwm_stats));
+    __set_interrupt_state(irq_state);
+}
+#endif
+
 /// ***************************************************************************
 /// @brief  Set PWM channel pulse width
 /// @param  channel: PWM channel index
@@ -169,7 +210,7 @@ void pwm_set_width(uint32_t channel, uint32_t width) {
     if (ticks < 0) {
         ticks = 0;
     }
-    pwm_channels[channel].ticks = ticks;
+    pwm_channels[channel].width = ticks;
 }
 
 
@@ -178,17 +219,22 @@ void pwm_set_width(uint32_t channel, uint32_t width) {
 
 /// ***************************************************************************
 /// @brief  PWM timer ISR
+/// @note   Update event starts PWM period, compare events end pulses by
+///         waveform table. Interrupts are enabled between edges
 /// ***************************************************************************
 #pragma call_graph_root="interrupt"
 void TIM17_IRQHandler(void) {
     if (TIM17->SR & TIM_SR_UIF) {  // Start next PWM period
-        if (pwm_locked || pwm_ready) {
-            sysmon_set_error(SYSMON_SYNC_ERROR);
+        // Start latest published table or repeat previous one
+        if (pwm_pending_waveform != NULL) {
+            pwm_active_waveform = pwm_pending_waveform;
+            pwm_pending_waveform = NULL;
+        } else {
+            ++pwm_overruns_count;
         }
         
-        // Reset state and update PWM frequency
-        uint8_t ch_cursor = 0;
-        TIM17->ARR = 1000000 / pwm_frequency;
+        // Reset state
+        pwm_edge_cursor = 0;
         
         // Disable all interrupts
         uint32_t irq_state = __get_interrupt_state();
@@ -205,31 +251,76 @@ void TIM17_IRQHandler(void) {
         GPIOD->BSRR = pwm_gpio_d_bsr;
         GPIOE->BSRR = pwm_gpio_e_bsr;
         
-        // Create pulse (HIGH)
-        while (ch_cursor < SUPPORT_PWM_CHANNELS_COUNT) {
-            if (pwm_channels_ptr[ch_cursor]->ticks > TIM17->ARR) {
-                break; // Don't process unreachable channels
-            }
-            while (TIM17->CNT < pwm_channels_ptr[ch_cursor]->ticks);
-            gpio_reset(pwm_channels_ptr[ch_cursor]->gpio_port, pwm_channels_ptr[ch_cursor]->gpio_pin);
-            ++ch_cursor;  
-        }
-        
         // Restore interrupts
         __set_interrupt_state(irq_state);
         
+        // Create pulse (HIGH)
+        process_edges();
         pwm_ready = true;
     }
-    TIM17->SR = 0;
+    if (TIM17->SR & TIM_SR_CC1IF) { // Pulse end
+#ifndef NDEBUG
+        timing_add(&pwm_stats.isr_latency, (int32_t)TIM17->CNT - (int32_t)TIM17->CCR1);
+#endif
+        TIM17->SR = (uint32_t)~TIM_SR_CC1IF;
+        process_edges();
+    }
 }
 
 /// ***************************************************************************
-/// @brief  qsort compare function
+/// @brief  Write reached edges and set compare for next edge
 /// ***************************************************************************
-static int compare_channels(const void* a, const void* b) {
-    pwm_channel_t* ch1 = *(pwm_channel_t**)a;
-    pwm_channel_t* ch2 = *(pwm_channel_t**)b;
-    if (ch1->ticks > ch2->ticks) return  1;
-    if (ch1->ticks < ch2->ticks) return -1;
-    return 0;
+static void process_edges(void) {
+    const pwm_waveform_t* waveform = pwm_active_waveform;
+    while (pwm_edge_cursor < waveform->count) {
+        const pwm_edge_t* edge = &waveform->edges[pwm_edge_cursor];
+        if (edge->ticks > TIM17->ARR) {
+            break; // Don't process unreachable channels
+        }
+        if (TIM17->CNT < edge->ticks) {
+            TIM17->SR = (uint32_t)~TIM_SR_CC1IF;
+            TIM17->CCR1 = edge->ticks;
+            if (TIM17->CNT < edge->ticks) {
+                TIM17->DIER |= TIM_DIER_CC1IE;
+                return; // Wait edge
+            }
+            continue; // Edge is reached while compare is loaded
+        }
+#ifndef NDEBUG
+        int32_t ticks = (int32_t)TIM17->CNT;
+        edge->gpio_port->BRR = edge->mask;
+        for (uint32_t i = 0; i < SUPPORT_PWM_CHANNELS_COUNT; ++i) {
+            if (edge->channels & (0x01u << i)) {
+                timing_add(&pwm_stats.edge_error[i], ticks - (int32_t)edge->ticks);
+            }
+        }
+#else
+        edge->gpio_port->BRR = edge->mask;
+#endif
+        ++pwm_edge_cursor;
+    }
+    TIM17->DIER &= ~TIM_DIER_CC1IE;
+}
+
+#ifndef NDEBUG
+/// ***************************************************************************
+/// @brief  Add sample to timing statistics
+/// @param  timing: statistics
+/// @param  error: sample [us]
+/// ***************************************************************************
+static void timing_add(pwm_timing_t* timing, int32_t error) {
+    if (timing->count == 0 || error < timing->min) timing->min = error;
+    if (timing->count == 0 || error > timing->max) timing->max = error;
+    timing->sum += error;
+    ++timing->count;
+    
+    uint32_t bin = 0;
+    if      (error <   0) bin = 0;
+    else if (error <=  2) bin = (uint32_t)error + 1;
+    else if (error <=  4) bin = 4;
+    else if (error <=  8) bin = 5;
+    else if (error <= 16) bin = 6;
+    else                  bin = 7;
+    ++timing->bins[bin];
 }
+#endif
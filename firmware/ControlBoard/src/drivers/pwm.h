@@ -13,12 +13,36 @@
 #define PWM_MIN_FREQUENCY_HZ                        (60)
 #define PWM_MAX_FREQUENCY_HZ                        (200)
 
+#define PWM_STATS_BINS_COUNT                        (8)
+
+
+// Edge timing statistics (debug build only). Error is difference between
+// actual and requested pulse end time, histogram bins: <0, 0, 1, 2, 3-4,
+// 5-8, 9-16, >16 us
+typedef struct {
+    int32_t  min;
+    int32_t  max;
+    int64_t  sum;
+    uint32_t count;
+    uint32_t bins[PWM_STATS_BINS_COUNT];
+} pwm_timing_t;
+
+typedef struct {
+    pwm_timing_t edge_error[SUPPORT_PWM_CHANNELS_COUNT];
+    pwm_timing_t isr_latency;
+} pwm_stats_t;
+
 
 extern void pwm_init(uint32_t frequency);
 extern void pwm_set_state(bool is_enabled);
-extern void pwm_set_frequency(uint32_t frequency);
-extern void pwm_set_lock_state(bool is_locked);
+extern uint32_t pwm_get_frequency(void);
+extern void pwm_swap_buffers(void);
 extern bool pwm_is_ready(void);
+extern uint32_t pwm_get_overruns_count(void);
+#ifndef NDEBUG
+extern const pwm_stats_t* pwm_get_stats(void);
+extern void pwm_reset_stats(void);
+#endif
 extern void pwm_set_width(uint32_t channel, uint32_t width);
 
 
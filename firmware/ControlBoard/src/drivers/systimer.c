@@ -38,6 +38,22 @@ uint64_t get_time_ms(void) {
     return systime_ms;
 }
 
+/// ***************************************************************************
+/// @brief  Get current time in microseconds
+/// @note   Milliseconds counter and SysTick counter are read again if SysTick
+///         ISR is called between reads. Don't call with disabled interrupts
+/// @return Microseconds
+/// ***************************************************************************
+uint64_t get_time_us(void) {
+    uint64_t ms = 0;
+    uint32_t ticks = 0;
+    do {
+        ms = systime_ms;
+        ticks = SysTick->LOAD - SysTick->VAL;
+    } while (ms != systime_ms);
+    return ms * 1000 + ticks / (SYSTEM_CLOCK_FREQUENCY / 1000000);
+}
+
 /// ***************************************************************************
 /// @brief  Synchronous delay
 /// @param  ms: time delay [ms]
@@ -11,6 +11,7 @@
 
 extern void systimer_init(void);
 extern uint64_t get_time_ms(void);
+extern uint64_t get_time_us(void);
 extern void delay_ms(uint32_t ms);
 
 
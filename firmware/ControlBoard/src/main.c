@@ -8,6 +8,7 @@
 #include "cli.h"
 #include "servo-driver.h"
 #include "motion-core.h"
+#include "motion-script.h"
 #include "sensors-core.h"
 #include "indication.h"
 #include "display.h"
@@ -61,14 +62,19 @@ void main() {
     servo_driver_init();
     motion_core_init();
     
+    bool is_conn_lost = true; // We are start with SYSMON_CONN_LOST error
     while (true) {
         // Check system failure
         if (sysmon_is_error_set(SYSMON_FATAL_ERROR)) {
             emergency_loop();
         }
         
-        // Override select sequence if need
-        if (sysmon_is_error_set(SYSMON_CONN_LOST)) {
+        // Override select sequence if need. Motion script is not depended on
+        // connection latency, but it is stopped on connection lost. Script
+        // started without connection (by CLI) is played
+        bool is_conn_lost_edge = sysmon_is_error_set(SYSMON_CONN_LOST) && !is_conn_lost;
+        is_conn_lost = sysmon_is_error_set(SYSMON_CONN_LOST);
+        if (is_conn_lost && (!motion_script_is_playing() || is_conn_lost_edge)) {
             motion_core_move(NULL);
         }
         // Disable servo power if low supply voltage
@@ -80,10 +86,9 @@ void main() {
         // Motion process
         // This 2 functions should be call in this sequence
         if (pwm_is_ready()) {
-            pwm_set_lock_state(true);
             motion_core_process();
             servo_driver_process();
-            pwm_set_lock_state(false);
+            pwm_swap_buffers();
         } else { // Here is other operations
             sysmon_process();
             swlp_process();
@@ -0,0 +1,172 @@
+/// ***************************************************************************
+/// @file    fast-math.c
+/// @author  NeoProg
+/// @brief   Fast single precision math for motion core and sensors
+/// ***************************************************************************
+#include "project-base.h"
+#include "fast-math.h"
+#include <float.h>
+#define M_PI                                (3.14159265f)
+#define SIN_TABLE_SIZE                      (256)
+#define SIN_TABLE_MASK                      (SIN_TABLE_SIZE - 1)
+#define SIN_TABLE_STEP                      (2.0f * M_PI / SIN_TABLE_SIZE)
+#define SIN_TABLE_SCALE                     (SIN_TABLE_SIZE / (2.0f * M_PI))
+
+static inline float sqrt_core(float x);
+static inline float atan2_core(float y, float x);
+static inline float acos_core(float x);
+
+
+// sin(2 * pi * i / SIN_TABLE_SIZE)
+static const float sin_table[SIN_TABLE_SIZE] = {
+        0.000000000f,  2.454122852e-2f,  4.906767433e-2f,  7.356456360e-2f,  9.801714033e-2f,  1.224106752e-1f,  1.467304745e-1f,  1.709618888e-1f,
+     1.950903220e-1f,  2.191012402e-1f,  2.429801799e-1f,  2.667127575e-1f,  2.902846773e-1f,  3.136817404e-1f,  3.368898534e-1f,  3.598950365e-1f,
+     3.826834324e-1f,  4.052413140e-1f,  4.275550934e-1f,  4.496113297e-1f,  4.713967368e-1f,  4.928981922e-1f,  5.141027442e-1f,  5.349976199e-1f,
+     5.555702330e-1f,  5.758081914e-1f,  5.956993045e-1f,  6.152315906e-1f,  6.343932842e-1f,  6.531728430e-1f,  6.715589548e-1f,  6.895405447e-1f,
+     7.071067812e-1f,  7.242470830e-1f,  7.409511254e-1f,  7.572088465e-1f,  7.730104534e-1f,  7.883464276e-1f,  8.032075315e-1f,  8.175848132e-1f,
+     8.314696123e-1f,  8.448535652e-1f,  8.577286100e-1f,  8.700869911e-1f,  8.819212643e-1f,  8.932243012e-1f,  9.039892931e-1f,  9.142097557e-1f,
+     9.238795325e-1f,  9.329927988e-1f,  9.415440652e-1f,  9.495281806e-1f,  9.569403357e-1f,  9.637760658e-1f,  9.700312532e-1f,  9.757021300e-1f,
+     9.807852804e-1f,  9.852776424e-1f,  9.891765100e-1f,  9.924795346e-1f,  9.951847267e-1f,  9.972904567e-1f,  9.987954562e-1f,  9.996988187e-1f,
+        1.000000000f,  9.996988187e-1f,  9.987954562e-1f,  9.972904567e-1f,  9.951847267e-1f,  9.924795346e-1f,  9.891765100e-1f,  9.852776424e-1f,
+     9.807852804e-1f,  9.757021300e-1f,  9.700312532e-1f,  9.637760658e-1f,  9.569403357e-1f,  9.495281806e-1f,  9.415440652e-1f,  9.329927988e-1f,
+     9.238795325e-1f,  9.142097557e-1f,  9.039892931e-1f,  8.932243012e-1f,  8.819212643e-1f,  8.700869911e-1f,  8.577286100e-1f,  8.448535652e-1f,
+     8.314696123e-1f,  8.175848132e-1f,  8.032075315e-1f,  7.883464276e-1f,  7.730104534e-1f,  7.572088465e-1f,  7.409511254e-1f,  7.242470830e-1f,
+     7.071067812e-1f,  6.895405447e-1f,  6.715589548e-1f,  6.531728430e-1f,  6.343932842e-1f,  6.152315906e-1f,  5.956993045e-1f,  5.758081914e-1f,
+     5.555702330e-1f,  5.349976199e-1f,  5.141027442e-1f,  4.928981922e-1f,  4.713967368e-1f,  4.496113297e-1f,  4.275550934e-1f,  4.052413140e-1f,
+     3.826834324e-1f,  3.598950365e-1f,  3.368898534e-1f,  3.136817404e-1f,  2.902846773e-1f,  2.667127575e-1f,  2.429801799e-1f,  2.191012402e-1f,
+     1.950903220e-1f,  1.709618888e-1f,  1.467304745e-1f,  1.224106752e-1f,  9.801714033e-2f,  7.356456360e-2f,  4.906767433e-2f,  2.454122852e-2f,
+    1.224646799e-16f, -2.454122852e-2f, -4.906767433e-2f, -7.356456360e-2f, -9.801714033e-2f, -1.224106752e-1f, -1.467304745e-1f, -1.709618888e-1f,
+    -1.950903220e-1f, -2.191012402e-1f, -2.429801799e-1f, -2.667127575e-1f, -2.902846773e-1f, -3.136817404e-1f, -3.368898534e-1f, -3.598950365e-1f,
+    -3.826834324e-1f, -4.052413140e-1f, -4.275550934e-1f, -4.496113297e-1f, -4.713967368e-1f, -4.928981922e-1f, -5.141027442e-1f, -5.349976199e-1f,
+    -5.555702330e-1f, -5.758081914e-1f, -5.956993045e-1f, -6.152315906e-1f, -6.343932842e-1f, -6.531728430e-1f, -6.715589548e-1f, -6.895405447e-1f,
+    -7.071067812e-1f, -7.242470830e-1f, -7.409511254e-1f, -7.572088465e-1f, -7.730104534e-1f, -7.883464276e-1f, -8.032075315e-1f, -8.175848132e-1f,
+    -8.314696123e-1f, -8.448535652e-1f, -8.577286100e-1f, -8.700869911e-1f, -8.819212643e-1f, -8.932243012e-1f, -9.039892931e-1f, -9.142097557e-1f,
+    -9.238795325e-1f, -9.329927988e-1f, -9.415440652e-1f, -9.495281806e-1f, -9.569403357e-1f, -9.637760658e-1f, -9.700312532e-1f, -9.757021300e-1f,
+    -9.807852804e-1f, -9.852776424e-1f, -9.891765100e-1f, -9.924795346e-1f, -9.951847267e-1f, -9.972904567e-1f, -9.987954562e-1f, -9.996988187e-1f,
+       -1.000000000f, -9.996988187e-1f, -9.987954562e-1f, -9.972904567e-1f, -9.951847267e-1f, -9.924795346e-1f, -9.891765100e-1f, -9.852776424e-1f,
+    -9.807852804e-1f, -9.757021300e-1f, -9.700312532e-1f, -9.637760658e-1f, -9.569403357e-1f, -9.495281806e-1f, -9.415440652e-1f, -9.329927988e-1f,
+    -9.238795325e-1f, -9.142097557e-1f, -9.039892931e-1f, -8.932243012e-1f, -8.819212643e-1f, -8.700869911e-1f, -8.577286100e-1f, -8.448535652e-1f,
+    -8.314696123e-1f, -8.175848132e-1f, -8.032075315e-1f, -7.883464276e-1f, -7.730104534e-1f, -7.572088465e-1f, -7.409511254e-1f, -7.242470830e-1f,
+    -7.071067812e-1f, -6.895405447e-1f, -6.715589548e-1f, -6.531728430e-1f, -6.343932842e-1f, -6.152315906e-1f, -5.956993045e-1f, -5.758081914e-1f,
+    -5.555702330e-1f, -5.349976199e-1f, -5.141027442e-1f, -4.928981922e-1f, -4.713967368e-1f, -4.496113297e-1f, -4.275550934e-1f, -4.052413140e-1f,
+    -3.826834324e-1f, -3.598950365e-1f, -3.368898534e-1f, -3.136817404e-1f, -2.902846773e-1f, -2.667127575e-1f, -2.429801799e-1f, -2.191012402e-1f,
+    -1.950903220e-1f, -1.709618888e-1f, -1.467304745e-1f, -1.224106752e-1f, -9.801714033e-2f, -7.356456360e-2f, -4.906767433e-2f, -2.454122852e-2f,
+};
+
+
+
+void mm_fast_sincos(float x, float* sin_value, float* cos_value) {
+    // x = k * step + d, d in [-step/2; step/2]
+    float u = x * SIN_TABLE_SCALE;
+    int32_t k = (int32_t)floorf(u + 0.5f);
+    float d = (u - (float)k) * SIN_TABLE_STEP;
+
+    // sin(a + d) = sin(a) * cos(d) + cos(a) * sin(d)
+    // cos(a + d) = cos(a) * cos(d) - sin(a) * sin(d)
+    float sin_a = sin_table[k & SIN_TABLE_MASK];
+    float cos_a = sin_table[(k + SIN_TABLE_SIZE / 4) & SIN_TABLE_MASK];
+    float d2 = d * d;
+    float sin_d = d * (1.0f - d2 * (1.0f / 6.0f));
+    float cos_d = 1.0f - d2 * 0.5f;
+    *sin_value = sin_a * cos_d + cos_a * sin_d;
+    *cos_value = cos_a * cos_d - sin_a * sin_d;
+}
+
+float mm_fast_sin(float x) {
+    float s, c;
+    mm_fast_sincos(x, &s, &c);
+    return s;
+}
+
+float mm_fast_cos(float x) {
+    float s, c;
+    mm_fast_sincos(x, &s, &c);
+    return c;
+}
+
+float mm_fast_atan2(float y, float x) {
+    return atan2_core(y, x);
+}
+
+float mm_fast_acos(float x) {
+    return acos_core(x);
+}
+
+float mm_fast_asin(float x) {
+    return 0.5f * M_PI - acos_core(x);
+}
+
+float mm_fast_sqrt(float x) {
+    return sqrt_core(x);
+}
+
+void mm_fast_atan2_array(const float* y, const float* x, float* result, int32_t count) {
+    for (int32_t i = 0; i < count; ++i) {
+        result[i] = atan2_core(y[i], x[i]);
+    }
+}
+
+void mm_fast_acos_array(const float* x, float* result, int32_t count) {
+    for (int32_t i = 0; i < count; ++i) {
+        result[i] = acos_core(x[i]);
+    }
+}
+
+void mm_fast_sqrt_array(const float* x, float* result, int32_t count) {
+    for (int32_t i = 0; i < count; ++i) {
+        result[i] = sqrt_core(x[i]);
+    }
+}
+
+
+
+
+
+/// ***************************************************************************
+/// @brief  Square root
+/// ***************************************************************************
+static inline float sqrt_core(float x) {
+#if defined(__ICCARM__) && defined(__ARMVFP__)
+    return __VSQRT_F32(x);
+#else
+    return sqrtf(x);
+#endif
+}
+
+/// ***************************************************************************
+/// @brief  Arc tangent of y/x
+/// @note   Without branches, loops over arrays are vectorized by host compiler
+/// ***************************************************************************
+static inline float atan2_core(float y, float x) {
+    float ax = fabsf(x);
+    float ay = fabsf(y);
+    float max_value = (ax > ay) ? ax : ay;
+    float min_value = (ax > ay) ? ay : ax;
+    max_value = (max_value > FLT_MIN) ? max_value : FLT_MIN; // (0; 0) gives 0
+
+    // atan(t), t in [0; 1]
+    float t = min_value / max_value;
+    float t2 = t * t;
+    float a = t * (0.999977219f + t2 * (-0.332622828f + t2 * (0.193540376f + t2 * (-0.116426482f + t2 * (0.0526473515f + t2 * -0.0117191357f)))));
+
+    // Octant reduction
+    a = (ay > ax)   ? 0.5f * M_PI - a : a;
+    a = (x < 0.0f)  ? M_PI - a : a;
+    return (y < 0.0f) ? -a : a;
+}
+
+/// ***************************************************************************
+/// @brief  Arc cosine
+/// @note   Without branches, loops over arrays are vectorized by host compiler
+/// ***************************************************************************
+static inline float acos_core(float x) {
+    x = (x > 1.0f)  ? 1.0f  : x;
+    x = (x < -1.0f) ? -1.0f : x;
+
+    // acos(x) = sqrt(1 - x) * P(x), x in [0; 1]
+    float ax = fabsf(x);
+    float p = 1.5707963050f + ax * (-0.2145988016f + ax * (0.0889789874f + ax * (-0.0501743046f + ax * (0.0308918810f +
+              ax * (-0.0170881256f + ax * (0.0066700901f + ax * -0.0012624911f))))));
+    float a = sqrt_core(1.0f - ax) * p;
+    return (x < 0.0f) ? M_PI - a : a;
+}
@@ -0,0 +1,98 @@
+/// ***************************************************************************
+/// @file    fast-math.h
+/// @author  NeoProg
+/// @brief   Fast single precision math for motion core and sensors
+/// @note    Max absolute errors vs double libm (host/tools/fast-math-bench):
+///          mm_fast_sin/cos/sincos: 8.8e-7 on [-4pi; 4pi] (float argument
+///          reduction), mm_fast_atan2: 1.9e-6 rad, mm_fast_acos/asin:
+///          4.2e-7 rad, mm_fast_sqrt: correctly rounded
+/// ***************************************************************************
+#ifndef _FAST_MATH_H_
+#define _FAST_MATH_H_
+
+
+/// ***************************************************************************
+/// @brief  Sine and cosine
+/// @note   Table (256 points per turn) and Taylor series for remainder
+/// @param  x: angle [rad]
+/// @param  sin_value: sine
+/// @param  cos_value: cosine
+/// ***************************************************************************
+extern void mm_fast_sincos(float x, float* sin_value, float* cos_value);
+
+/// ***************************************************************************
+/// @brief  Sine
+/// @param  x: angle [rad]
+/// @return sine
+/// ***************************************************************************
+extern float mm_fast_sin(float x);
+
+/// ***************************************************************************
+/// @brief  Cosine
+/// @param  x: angle [rad]
+/// @return cosine
+/// ***************************************************************************
+extern float mm_fast_cos(float x);
+
+/// ***************************************************************************
+/// @brief  Arc tangent of y/x
+/// @note   Minimax polynomial (11 order) on [0; 1] and octant reduction
+/// @param  y: Y coordinate
+/// @param  x: X coordinate
+/// @return angle [rad] in [-pi; pi], 0 for (0; 0)
+/// ***************************************************************************
+extern float mm_fast_atan2(float y, float x);
+
+/// ***************************************************************************
+/// @brief  Arc cosine
+/// @note   Polynomial approximation (A&S 4.4.46). Argument is constrained [-1; 1]
+/// @param  x: value
+/// @return angle [rad] in [0; pi]
+/// ***************************************************************************
+extern float mm_fast_acos(float x);
+
+/// ***************************************************************************
+/// @brief  Arc sine
+/// @note   Argument is constrained [-1; 1]
+/// @param  x: value
+/// @return angle [rad] in [-pi/2; pi/2]
+/// ***************************************************************************
+extern float mm_fast_asin(float x);
+
+/// ***************************************************************************
+/// @brief  Square root
+/// @note   Single VSQRT instruction on Cortex-M4F
+/// @param  x: value
+/// @return square root
+/// ***************************************************************************
+extern float mm_fast_sqrt(float x);
+
+/// ***************************************************************************
+/// @brief  Arc tangent of y/x for arrays
+/// @note   Same result as mm_fast_atan2(). Loop is vectorized by host compiler
+/// @param  y: Y coordinates
+/// @param  x: X coordinates
+/// @param  result: angles [rad]
+/// @param  count: items count
+/// ***************************************************************************
+extern void mm_fast_atan2_array(const float* y, const float* x, float* result, int32_t count);
+
+/// ***************************************************************************
+/// @brief  Arc cosine for arrays
+/// @note   Same result as mm_fast_acos(). Loop is vectorized by host compiler
+/// @param  x: values
+/// @param  result: angles [rad]
+/// @param  count: items count
+/// ***************************************************************************
+extern void mm_fast_acos_array(const float* x, float* result, int32_t count);
+
+/// ***************************************************************************
+/// @brief  Square root for arrays
+/// @param  x: values
+/// @param  result: square roots
+/// @param  count: items count
+/// ***************************************************************************
+extern void mm_fast_sqrt_array(const float* x, float* result, int32_t count);
+
+
+#endif // _FAST_MATH_H_
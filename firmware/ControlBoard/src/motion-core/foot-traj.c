@@ -0,0 +1,38 @@
+/// ***************************************************************************
+/// @file    foot-traj.c
+/// @author  NeoProg
+/// @brief   Foot trajectory profiles
+/// ***************************************************************************
+#include "project-base.h"
+#include "foot-traj.h"
+#define SWING_CONTROL_POINTS_COUNT          (7)
+
+
+// Swing Bezier curve. Vertical lift-off, vertical touch-down with zero
+// speed (two last points are same), max height is 1.0
+static const foot_traj_point_t swing_control_points[SWING_CONTROL_POINTS_COUNT] = {
+    { 0.0f, 0.00f }, { 0.0f, 0.60f }, { 0.2f, 1.26f }, { 0.6f, 1.26f }, { 1.0f, 1.00f }, { 1.0f, 0.00f }, { 1.0f, 0.00f }
+};
+
+
+
+void mm_foot_traj_build_swing(foot_traj_point_t* table) {
+    for (int32_t k = 0; k < FOOT_TRAJ_TABLE_SIZE; ++k) {
+        float u = (float)k / (FOOT_TRAJ_TABLE_SIZE - 1);
+        
+        // De Casteljau algorithm
+        foot_traj_point_t p[SWING_CONTROL_POINTS_COUNT];
+        memcpy(p, swing_control_points, sizeof(p));
+        for (int32_t r = SWING_CONTROL_POINTS_COUNT - 1; r > 0; --r) {
+            for (int32_t j = 0; j < r; ++j) {
+                p[j].progress += (p[j + 1].progress - p[j].progress) * u;
+                p[j].height   += (p[j + 1].height   - p[j].height)   * u;
+            }
+        }
+        table[k] = p[0];
+    }
+    
+    // Curve ends exactly on lift-off and touch-down points
+    table[0] = swing_control_points[0];
+    table[FOOT_TRAJ_TABLE_SIZE - 1] = swing_control_points[SWING_CONTROL_POINTS_COUNT - 1];
+}
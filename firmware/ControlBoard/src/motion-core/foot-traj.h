@@ -0,0 +1,34 @@
+/// ***************************************************************************
+/// @file    foot-traj.h
+/// @author  NeoProg
+/// @brief   Foot trajectory profiles
+/// @note    Swing profile is Bezier curve sampled into normalized table:
+///          progress [0; 1] from lift-off to touch-down point of step and
+///          height [0; 1] of step height. Foot is lifted vertically and
+///          lowered vertically with zero speed at touch-down, so touch-down
+///          is smooth on high speed. Stance
+///          profile is linear: all limbs on ground should move with same
+///          speed relatively surface
+/// ***************************************************************************
+#ifndef _FOOT_TRAJ_H_
+#define _FOOT_TRAJ_H_
+
+#define FOOT_TRAJ_TABLE_SIZE                (17)        // Points of swing profile, 16 segments
+
+
+typedef struct {
+    float progress;
+    float height;
+} foot_traj_point_t;
+
+
+/// ***************************************************************************
+/// @brief  Build normalized swing profile table
+/// @note   Table is sampled with uniform step of swing time. Call on motion
+///         configuration change only
+/// @param  table: profile table (FOOT_TRAJ_TABLE_SIZE points)
+/// ***************************************************************************
+extern void mm_foot_traj_build_swing(foot_traj_point_t* table);
+
+
+#endif // _FOOT_TRAJ_H_
@@ -5,12 +5,16 @@
 #include "project-base.h"
 #include "motion-core.h"
 #include "motion-math.h"
+#include "motion-script.h"
+#include "motion-record.h"
 #include "servo-driver.h"
 #include "sensors-core.h"
 #include "pwm.h"
 #include "system-monitor.h"
 #include "pca9555.h"
-#define CHANGE_SURFACE_POS_MAX_STEP             (1.5f)
+#define SURFACE_MOVE_SPEED                      (300.0f)    // Surface and limb lift speed [mm/s or deg/s]
+#define SURFACE_MOVE_ACCELERATION               (1500.0f)   // Surface acceleration [mm/s^2 or deg/s^2]
+#define SURFACE_MOVE_JERK                       (15000.0f)  // Surface jerk [mm/s^3 or deg/s^3]
 
 #define MOTION_MIN_STEP_HEIGHT                  (15)
 #define MOTION_MAX_STEP_HEIGHT                  (60)
@@ -20,12 +24,28 @@
 #define MOTION_SURFACE_MAX_HEIGHT               (-150)
 #define MOTION_SURFACE_UP_HEIGHT_THRESHOLD      (-85)
 
-#define MOTION_LIMBS_DOWN_TIMEOUT               (100)
+#define MOTION_LIMBS_DOWN_TIMEOUT_US            (100000)
 
 #define MOTION_TIME_MIN_VALUE                   (0)
 #define MOTION_TIME_MID_VALUE                   (500)
 #define MOTION_TIME_MAX_VALUE                   (1000)
-#define MOTION_TIME_STEP                        (20)
+#define MOTION_TIME_SPEED                       (4000.0f)   // Motion time units per second
+
+// Speed is time scale of motion clock. Speed 0 runs motion clock 0.3 times
+// slower than speed 100
+#define MOTION_MIN_TIME_SCALE                   (0.3f)
+#define MOTION_MAX_SPEED                        (100)
+
+// Tick duration is limited, motion doesn't jump after long main loop stall.
+// First tick after initialization has nominal duration (PWM period)
+#define MOTION_MAX_DT_US                        (50000)
+#define MOTION_FIRST_DT_US                      (5000)
+
+// Terrain adaptation by foot sensors. Swing is finished by contact on limb
+// lowering and ground height under limb is changed to contact height. Limb
+// without contact on stance start is lowered until contact
+#define MOTION_GROUND_MIN_HEIGHT                (-40)
+#define MOTION_GROUND_MAX_HEIGHT                (40)
 
 
 typedef enum {
@@ -38,13 +58,79 @@ typedef enum {
 
 typedef struct {
     motion_cfg_t cfg;
+    gait_type_t gait;
     p3d_t surface_point;
     r3d_t surface_rotate;
 } motion_t;
 
+typedef struct {
+    bool     is_contact;            // Foot sensor state on last tick
+    uint64_t contact_time_us;       // Latched time of last contact event (foot touches ground)
+    bool     is_swing;              // Limb is in swing phase on last tick
+    uint64_t swing_start_time_us;
+    bool     is_landed;             // Foot reached ground in current step
+    float    landed_height;         // Foot height at landing relatively ground height, [mm]
+} foot_t;
+
+// Motion core state snapshot for motion record. Fixed size types only, layout is
+// same for firmware and host build. Configuration and gait tables are not changed
+// after initialization and are not saved. Limbs angles are saved too: they are
+// checked by angles hash before first replayed tick
+#pragma pack(push, 1)
+typedef struct {
+    v3d_t    pos;
+    float    ground_height;
+    float    coxa_angle;
+    float    femur_angle;
+    float    tibia_angle;
+} limb_state_t;
+
+typedef struct {
+    uint8_t  is_contact;
+    uint64_t contact_time_us;
+    uint8_t  is_swing;
+    uint64_t swing_start_time_us;
+    uint8_t  is_landed;
+    float    landed_height;
+} foot_state_t;
+
+typedef struct {
+    limb_state_t     limbs[SUPPORT_LIMBS_COUNT];
+    motion_cfg_t     cur_cfg;
+    uint8_t          cur_gait;
+    p3d_t            cur_surface_point;
+    r3d_t            cur_surface_rotate;
+    motion_cfg_t     ext_cfg;
+    uint16_t         ext_ctrl;
+    p3d_t            ext_surface_point;
+    r3d_t            ext_surface_rotate;
+    uint8_t          hexapod_state;
+    uint8_t          is_surface_move_completed;
+    surface_scurve_t surface_scurve;
+    traj_plan_t      traj_plan;
+    float            time_scale;
+    uint8_t          is_time_valid;
+    uint64_t         time_us;
+    uint32_t         dt_us;
+    foot_state_t     feet[SUPPORT_LIMBS_COUNT];
+    uint8_t          is_foot_contacts_valid;
+    float            motion_time;
+    int32_t          motion_loop;
+    uint8_t          is_mid_time;
+    uint64_t         last_exec_time_us;
+} motion_core_state_t;
+#pragma pack(pop)
+
 
 static void load_config(void);
+static void apply_ext_motion(const ext_motion_t* ext_motion);
 static void main_motion_process(void);
+static bool start_motion(void);
+static gait_type_t get_ext_gait(void);
+static void update_foot_contacts(bool is_contacts_valid, uint32_t contacts_mask);
+static void terrain_process(float motion_time, int32_t motion_loop, float max_step);
+static void reset_feet(void);
+static bool is_vector_changed(const v3d_t* a, const v3d_t* b);
 
 
 static const v3d_t g_limbs_base_pos[] = {
@@ -56,6 +142,26 @@ static motion_t g_cur_motion = {0};
 static ext_motion_t g_ext_motion = {0};
 static g_hexapod_state_t g_hexapod_state = HEXAPOD_STATE_DOWN;
 static bool g_is_surface_move_completed = false;
+static surface_scurve_t g_surface_scurve = {0};
+static traj_plan_t g_traj_plan = {0};
+static gait_table_t g_gait_tables[GAITS_COUNT] = {0};
+static float g_time_scale = 1.0f;
+static bool g_is_time_valid = false;
+static uint64_t g_time_us = 0;
+static uint32_t g_dt_us = 0;
+static foot_t g_feet[SUPPORT_LIMBS_COUNT] = {0};
+static bool g_is_foot_contacts_valid = false;
+static float g_motion_time = MOTION_TIME_MIN_VALUE;
+static int32_t g_motion_loop = 0;
+static bool g_is_mid_time = false;
+static uint64_t g_last_exec_time_us = 0;
+
+// Inputs of last successful surface and IK stages. Stages are skipped if inputs are not changed
+static bool  g_is_last_inputs_valid = false;
+static p3d_t g_last_surface_point = {0};
+static r3d_t g_last_surface_rotate = {0};
+static v3d_t g_last_limbs_pos[SUPPORT_LIMBS_COUNT] = {0};
+static float g_last_ground_height[SUPPORT_LIMBS_COUNT] = {0};
 
 
 
@@ -69,10 +175,22 @@ void motion_core_init() {
     for (uint32_t i = 0; i < SUPPORT_LIMBS_COUNT; ++i) {
         g_limbs[i].pos = g_limbs_base_pos[i];
     }
+    
+    // Gait tables are built once, gait is switched by table selection
+    for (uint32_t i = 0; i < GAITS_COUNT; ++i) {
+        if (!mm_gait_build_table(&g_gait_tables[i], (gait_type_t)i)) {
+            sysmon_set_error(SYSMON_MATH_ERROR);
+            sysmon_disable_module(SYSMON_MODULE_MOTION_CORE);
+            return;
+        }
+    }
 
     // Init motion
     g_cur_motion.surface_point.y = g_ext_motion.surface_point.y = MOTION_SURFACE_MIN_HEIGHT;
     g_cur_motion.cfg.step_height = g_ext_motion.cfg.step_height = MOTION_DEFAULT_STEP_HEIGHT;
+    memset(&g_surface_scurve, 0, sizeof(g_surface_scurve));
+    memset(g_feet, 0, sizeof(g_feet));
+    g_is_time_valid = false;
 
     servo_driver_power_on();
 }
@@ -80,21 +198,19 @@ void motion_core_init() {
 /// ***************************************************************************
 /// @brief  Main motion control
 /// @param  ext_motion: user_motion description, may be NULL. @ref ext_motion_t
+/// @note   Motion is ignored while motion script is playing. NULL stops script
 /// ***************************************************************************
 void motion_core_move(const ext_motion_t* ext_motion) {
     if (!ext_motion) { 
+        motion_record_move(NULL);
+        motion_script_stop();
         memset(&g_ext_motion, 0, sizeof(g_ext_motion));
         return;
     }
-    g_ext_motion = *ext_motion;
-    
-    // Inhibit any motions if hexapod is down except change height for stand up
-    if (g_hexapod_state == HEXAPOD_STATE_DOWN) {
-        memset(&g_ext_motion, 0, sizeof(g_ext_motion));
-        if (ext_motion->surface_point.y <= MOTION_SURFACE_UP_HEIGHT_THRESHOLD) {
-            g_ext_motion.surface_point.y = ext_motion->surface_point.y;
-        }
+    if (motion_script_is_playing()) {
+        return;
     }
+    apply_ext_motion(ext_motion);
 }
 
 /// ***************************************************************************
@@ -116,17 +232,52 @@ ext_motion_t motion_core_get_motion(void) {
 /// ***************************************************************************
 extern uint16_t sensors_inputs;
 void motion_core_process(void) {
+    if (sysmon_is_error_set(SYSMON_MATH_ERROR)) {
+        motion_record_stop(); // Keep inputs of failed tick in record
+    }
     if (sysmon_is_module_disable(SYSMON_MODULE_MOTION_CORE)) return;  // Module disabled
     sysmon_clear_error(SYSMON_MATH_ERROR);
+    motion_record_sync();
     
     //
     // Motion section
     //
+    // Update motion clock
+    uint64_t time_us = get_time_us();
+    if (g_is_time_valid) {
+        uint64_t dt_us = time_us - g_time_us;
+        g_dt_us = (dt_us > MOTION_MAX_DT_US) ? MOTION_MAX_DT_US : (uint32_t)dt_us;
+    } else {
+        g_dt_us = MOTION_FIRST_DT_US;
+        g_is_time_valid = true;
+    }
+    g_time_us = time_us;
+    
+    // Motion script is played by motion clock instead of external motion
+    if (motion_script_is_playing()) {
+        ext_motion_t cur_motion = motion_core_get_motion();
+        ext_motion_t script_motion = {0};
+        if (motion_script_process(g_time_us, &cur_motion, &script_motion)) {
+            apply_ext_motion(&script_motion);
+        }
+    }
+    
+    // Read tick inputs. Inputs are recorded for replay
+    float xz[2] = {0};
+    uint32_t contacts_mask = 0;
+    sensors_core_get_orientation(xz);
+    bool is_contacts_valid = sensors_core_get_foot_contacts(&contacts_mask);
+    motion_record_tick(g_time_us, xz, is_contacts_valid, contacts_mask);
+    
     // Constrain step height before motions by hardware limits
     constrain_u16(&g_ext_motion.cfg.step_height, MOTION_MIN_STEP_HEIGHT, MOTION_MAX_STEP_HEIGHT); 
     
     // Change motion speed 
-    servo_driver_set_speed(g_ext_motion.cfg.speed);
+    uint32_t speed = (g_ext_motion.cfg.speed > MOTION_MAX_SPEED) ? MOTION_MAX_SPEED : g_ext_motion.cfg.speed;
+    g_time_scale = MOTION_MIN_TIME_SCALE + (1.0f - MOTION_MIN_TIME_SCALE) * (float)speed / MOTION_MAX_SPEED;
+
+    // Latch foot contact events by motion clock
+    update_foot_contacts(is_contacts_valid, contacts_mask);
 
     // Motion iteration process
     main_motion_process();
@@ -139,8 +290,6 @@ void motion_core_process(void) {
     r3d_t dst_surface_rotate = g_ext_motion.surface_rotate;
     
     // Apply hull rotate surface
-    float xz[2] = {0};
-    sensors_core_get_orientation(xz);
     if (g_ext_motion.ctrl & MOTION_CTRL_EN_STAB && g_hexapod_state != HEXAPOD_STATE_DOWN) {
         dst_surface_rotate.x -= xz[0];
         dst_surface_rotate.z -= xz[1];
@@ -158,7 +307,14 @@ void motion_core_process(void) {
     //
     // Move hexapod surface to destination surface
     //
-    g_is_surface_move_completed = mm_move_surface(&g_cur_motion.surface_point, &dst_surface_point, &g_cur_motion.surface_rotate, &dst_surface_rotate, CHANGE_SURFACE_POS_MAX_STEP);
+    // Motion clock time scale is applied to velocity limit only. Acceleration and
+    // jerk limits are not changed, surface moved faster than new velocity limit is braked smoothly
+    scurve_limits_t limits = {0};
+    limits.velocity     = SURFACE_MOVE_SPEED * g_time_scale;
+    limits.acceleration = SURFACE_MOVE_ACCELERATION;
+    limits.jerk         = SURFACE_MOVE_JERK;
+    g_is_surface_move_completed = mm_scurve_move_surface(&g_surface_scurve, &g_cur_motion.surface_point, &dst_surface_point,
+                                                         &g_cur_motion.surface_rotate, &dst_surface_rotate, &limits, (float)g_dt_us / 1000000.0f);
     
     //
     // Change hexapod state relatively reached MOTION_SURFACE_UP_HEIGHT_THRESHOLD by axis Y
@@ -173,6 +329,23 @@ void motion_core_process(void) {
         }
     }
 
+    //
+    // Select limbs for update. Surface change affects all limbs
+    //
+    bool is_surface_changed = !g_is_last_inputs_valid ||
+                              is_vector_changed(&g_cur_motion.surface_point, &g_last_surface_point) ||
+                              is_vector_changed(&g_cur_motion.surface_rotate, &g_last_surface_rotate);
+    uint32_t changed_limbs_mask = 0;
+    for (int32_t i = 0; i < SUPPORT_LIMBS_COUNT; ++i) {
+        if (is_surface_changed || is_vector_changed(&g_limbs[i].pos, &g_last_limbs_pos[i]) ||
+            g_limbs[i].ground_height != g_last_ground_height[i]) {
+            changed_limbs_mask |= (1 << i);
+        }
+    }
+    if (changed_limbs_mask == 0) {
+        return; // Nothing changed -- surface, angles and servo driver state are actual
+    }
+
     // Calculate limbs offset relatively surface
     if (!mm_surface_calculate_offsets(g_limbs, &g_cur_motion.surface_point, &g_cur_motion.surface_rotate)) {
         sysmon_set_error(SYSMON_MATH_ERROR);
@@ -185,12 +358,19 @@ void motion_core_process(void) {
         return;
     }
 
-    // Load new angles to servo driver
+    // Load new angles of changed limbs to servo driver
     for (int32_t i = 0; i < SUPPORT_LIMBS_COUNT; ++i) {
-        servo_driver_move(i * 3 + 0, g_limbs[i].coxa.angle);
-        servo_driver_move(i * 3 + 1, g_limbs[i].femur.angle);
-        servo_driver_move(i * 3 + 2, g_limbs[i].tibia.angle);
+        if (changed_limbs_mask & (1 << i)) {
+            servo_driver_move(i * 3 + 0, g_limbs[i].coxa.angle);
+            servo_driver_move(i * 3 + 1, g_limbs[i].femur.angle);
+            servo_driver_move(i * 3 + 2, g_limbs[i].tibia.angle);
+            g_last_limbs_pos[i] = g_limbs[i].pos;
+            g_last_ground_height[i] = g_limbs[i].ground_height;
+        }
     }
+    g_last_surface_point  = g_cur_motion.surface_point;
+    g_last_surface_rotate = g_cur_motion.surface_rotate;
+    g_is_last_inputs_valid = true;
     
     /*void* tx_buffer = cli_get_tx_buffer();
     sprintf(tx_buffer, "[MCORE]: %d sensors: %d,%d,%d %d,%d,%d  pos: %d,%d,%d,%d,%d,%d  rotate: %d,%d,%d  mpu: %d,%d\r\n", 
@@ -211,64 +391,225 @@ bool motion_core_is_down(void) {
     return g_hexapod_state == HEXAPOD_STATE_DOWN;
 }
 
+/// ***************************************************************************
+/// @brief  Get current limbs state
+/// @return Pointer to limbs array (SUPPORT_LIMBS_COUNT items)
+/// ***************************************************************************
+const limb_t* motion_core_get_limbs(void) {
+    return g_limbs;
+}
 
+/// ***************************************************************************
+/// @brief  Save motion core state
+/// @note   Call between motion core ticks. State is portable between
+///         firmware and host build with same motion math
+/// @param  buffer: buffer for state
+/// @param  size: buffer size
+/// @return state size, 0 - buffer is small
+/// ***************************************************************************
+uint32_t motion_core_save_state(void* buffer, uint32_t size) {
+    if (size < sizeof(motion_core_state_t)) {
+        return 0;
+    }
+    
+    motion_core_state_t* state = (motion_core_state_t*)buffer;
+    memset(state, 0, sizeof(motion_core_state_t));
+    for (int32_t i = 0; i < SUPPORT_LIMBS_COUNT; ++i) {
+        state->limbs[i].pos           = g_limbs[i].pos;
+        state->limbs[i].ground_height = g_limbs[i].ground_height;
+        state->limbs[i].coxa_angle    = g_limbs[i].coxa.angle;
+        state->limbs[i].femur_angle   = g_limbs[i].femur.angle;
+        state->limbs[i].tibia_angle   = g_limbs[i].tibia.angle;
+        state->feet[i].is_contact          = g_feet[i].is_contact;
+        state->feet[i].contact_time_us     = g_feet[i].contact_time_us;
+        state->feet[i].is_swing            = g_feet[i].is_swing;
+        state->feet[i].swing_start_time_us = g_feet[i].swing_start_time_us;
+        state->feet[i].is_landed           = g_feet[i].is_landed;
+        state->feet[i].landed_height       = g_feet[i].landed_height;
+    }
+    state->cur_cfg                   = g_cur_motion.cfg;
+    state->cur_gait                  = (uint8_t)g_cur_motion.gait;
+    state->cur_surface_point         = g_cur_motion.surface_point;
+    state->cur_surface_rotate        = g_cur_motion.surface_rotate;
+    state->ext_cfg                   = g_ext_motion.cfg;
+    state->ext_ctrl                  = g_ext_motion.ctrl;
+    state->ext_surface_point         = g_ext_motion.surface_point;
+    state->ext_surface_rotate        = g_ext_motion.surface_rotate;
+    state->hexapod_state             = (uint8_t)g_hexapod_state;
+    state->is_surface_move_completed = g_is_surface_move_completed;
+    state->surface_scurve            = g_surface_scurve;
+    state->traj_plan                 = g_traj_plan;
+    state->time_scale                = g_time_scale;
+    state->is_time_valid             = g_is_time_valid;
+    state->time_us                   = g_time_us;
+    state->dt_us                     = g_dt_us;
+    state->is_foot_contacts_valid    = g_is_foot_contacts_valid;
+    state->motion_time               = g_motion_time;
+    state->motion_loop               = g_motion_loop;
+    state->is_mid_time               = g_is_mid_time;
+    state->last_exec_time_us         = g_last_exec_time_us;
+    return sizeof(motion_core_state_t);
+}
+
+/// ***************************************************************************
+/// @brief  Load motion core state
+/// @note   Call after motion core initialization. Surface and IK stages
+///         are processed for all limbs on next tick
+/// @param  buffer: state, @ref motion_core_save_state
+/// @param  size: state size
+/// @return true - success, false - state size is not match
+/// ***************************************************************************
+bool motion_core_load_state(const void* buffer, uint32_t size) {
+    if (size != sizeof(motion_core_state_t)) {
+        return false;
+    }
+    
+    const motion_core_state_t* state = (const motion_core_state_t*)buffer;
+    for (int32_t i = 0; i < SUPPORT_LIMBS_COUNT; ++i) {
+        g_limbs[i].pos                = state->limbs[i].pos;
+        g_limbs[i].ground_height      = state->limbs[i].ground_height;
+        g_limbs[i].coxa.angle         = state->limbs[i].coxa_angle;
+        g_limbs[i].femur.angle        = state->limbs[i].femur_angle;
+        g_limbs[i].tibia.angle        = state->limbs[i].tibia_angle;
+        g_feet[i].is_contact          = state->feet[i].is_contact;
+        g_feet[i].contact_time_us     = state->feet[i].contact_time_us;
+        g_feet[i].is_swing            = state->feet[i].is_swing;
+        g_feet[i].swing_start_time_us = state->feet[i].swing_start_time_us;
+        g_feet[i].is_landed           = state->feet[i].is_landed;
+        g_feet[i].landed_height       = state->feet[i].landed_height;
+    }
+    g_cur_motion.cfg            = state->cur_cfg;
+    g_cur_motion.gait           = (gait_type_t)state->cur_gait;
+    g_cur_motion.surface_point  = state->cur_surface_point;
+    g_cur_motion.surface_rotate = state->cur_surface_rotate;
+    g_ext_motion.cfg            = state->ext_cfg;
+    g_ext_motion.ctrl           = state->ext_ctrl;
+    g_ext_motion.surface_point  = state->ext_surface_point;
+    g_ext_motion.surface_rotate = state->ext_surface_rotate;
+    g_hexapod_state             = (g_hexapod_state_t)state->hexapod_state;
+    g_is_surface_move_completed = state->is_surface_move_completed;
+    g_surface_scurve            = state->surface_scurve;
+    g_traj_plan                 = state->traj_plan;
+    g_time_scale                = state->time_scale;
+    g_is_time_valid             = state->is_time_valid;
+    g_time_us                   = state->time_us;
+    g_dt_us                     = state->dt_us;
+    g_is_foot_contacts_valid    = state->is_foot_contacts_valid;
+    g_motion_time               = state->motion_time;
+    g_motion_loop               = state->motion_loop;
+    g_is_mid_time               = state->is_mid_time;
+    g_last_exec_time_us         = state->last_exec_time_us;
+    g_is_last_inputs_valid      = false;
+    return true;
+}
+
+
+
+/// ***************************************************************************
+/// @brief  Load external motion
+/// @note   Any motions are inhibited if hexapod is down except change height
+///         for stand up. Motion is recorded if it changes external motion only
+/// @param  ext_motion: user_motion description. @ref ext_motion_t
+/// ***************************************************************************
+static void apply_ext_motion(const ext_motion_t* ext_motion) {
+    ext_motion_t new_ext_motion = *ext_motion;
+    if (g_hexapod_state == HEXAPOD_STATE_DOWN) {
+        memset(&new_ext_motion, 0, sizeof(new_ext_motion));
+        if (ext_motion->surface_point.y <= MOTION_SURFACE_UP_HEIGHT_THRESHOLD) {
+            new_ext_motion.surface_point.y = ext_motion->surface_point.y;
+        }
+    }
+    if (memcmp(&new_ext_motion, &g_ext_motion, sizeof(g_ext_motion)) != 0) {
+        motion_record_move(ext_motion);
+    }
+    g_ext_motion = new_ext_motion;
+}
 
 /// ***************************************************************************
 /// @brief  Main motion process
+/// @note   Motion time is integrated by tick duration and scaled by speed.
+///         Time is stopped at
+///         MOTION_TIME_MID_VALUE and MOTION_TIME_MAX_VALUE to keep points of
+///         configuration update and loop end
 /// ***************************************************************************
 static void main_motion_process(void) {
-    static int32_t motion_time = MOTION_TIME_MIN_VALUE;
-    static int32_t motion_loop = 0;
+    const float max_step = SURFACE_MOVE_SPEED * (float)g_dt_us / 1000000.0f * g_time_scale;
 
     //
     // Start motion state
     //
     if (g_hexapod_state == HEXAPOD_STATE_RDY && g_ext_motion.cfg.distance) {
-        g_cur_motion.cfg = g_ext_motion.cfg; // Update motion configuration
-        g_hexapod_state = HEXAPOD_STATE_MOTION_INIT;
+        if (!start_motion()) {
+            return;
+        }
     } 
     
     //
     // Motion loop
     //
     if (g_hexapod_state == HEXAPOD_STATE_MOTION_INIT) { // Prepare for motion -- move limbs to init position
-        // Move limbs 0, 2, 4 to up state for even loop
-        // Move limbs 1, 3, 5 to up state for odd loop
+        // Init position is trajectory point of gait in middle of current loop:
+        // swing limbs are up, stance limbs are on trajectory
+        limb_t init_limbs[SUPPORT_LIMBS_COUNT];
+        memcpy(init_limbs, g_limbs, sizeof(init_limbs));
+        mm_traj_process_plan(init_limbs, &g_traj_plan, &g_gait_tables[g_cur_motion.gait], MOTION_TIME_MID_VALUE, g_motion_loop);
+        
         bool is_completed = true;
-        for (int32_t i = motion_loop & 0x01; i < SUPPORT_LIMBS_COUNT; i += 2) {
-            if (!mm_move_value(&g_limbs[i].pos.y, g_cur_motion.cfg.step_height, CHANGE_SURFACE_POS_MAX_STEP)) {
+        for (int32_t i = 0; i < SUPPORT_LIMBS_COUNT; ++i) {
+            if (!mm_move_vector(&g_limbs[i].pos, &init_limbs[i].pos, max_step)) {
                 is_completed = false;
             }
         }
         if (is_completed) {
-            motion_time = MOTION_TIME_MID_VALUE;
+            reset_feet();
+            g_motion_time = MOTION_TIME_MID_VALUE;
+            g_is_mid_time = true;
             g_hexapod_state = HEXAPOD_STATE_MOTION_EXEC;
         }
     } 
     else if (g_hexapod_state == HEXAPOD_STATE_MOTION_EXEC) { // Process motion loop
         // Check reached update motion configuration time
         // Here we can update motion configuration
-        if (motion_time == MOTION_TIME_MID_VALUE) { 
+        if (g_is_mid_time) { 
+            // Gait is changed -- move limbs to init position of new gait
+            if (get_ext_gait() != g_cur_motion.gait) {
+                g_is_mid_time = false;
+                start_motion();
+                return;
+            }
             g_cur_motion.cfg = g_ext_motion.cfg;
-        }
-        
-        static uint64_t last_exec_time = 0;
-        if (g_cur_motion.cfg.distance) { // Move hexapod if step distance is present
+
+            // Time is stopped at MID without step distance -- configuration
+            // and gait are checked each tick until motion is started
+            g_is_mid_time = (g_cur_motion.cfg.distance == 0);
+
+            // Trajectory depends on motion configuration only
             const motion_cfg_t* cfg = &g_cur_motion.cfg;
-            if (!mm_process_advanced_traj(g_limbs, g_limbs_base_pos, motion_time, motion_loop, cfg->curvature, cfg->distance, cfg->step_height)) {
+            if (!mm_traj_build_plan(&g_traj_plan, g_limbs_base_pos, cfg->curvature, cfg->distance, cfg->step_height)) {
                 sysmon_set_error(SYSMON_MATH_ERROR);
                 sysmon_disable_module(SYSMON_MODULE_MOTION_CORE);
                 return;
             }
-            motion_time += MOTION_TIME_STEP;
-            if (motion_time > MOTION_TIME_MAX_VALUE) {
-                motion_time = MOTION_TIME_MIN_VALUE;
-                ++motion_loop;
+        }
+        
+        if (g_cur_motion.cfg.distance) { // Move hexapod if step distance is present
+            mm_traj_process_plan(g_limbs, &g_traj_plan, &g_gait_tables[g_cur_motion.gait], g_motion_time, g_motion_loop);
+            terrain_process(g_motion_time, g_motion_loop, max_step);
+            float next_time = g_motion_time + MOTION_TIME_SPEED * (float)g_dt_us / 1000000.0f * g_time_scale;
+            if (g_motion_time < MOTION_TIME_MID_VALUE && next_time >= MOTION_TIME_MID_VALUE) {
+                next_time = MOTION_TIME_MID_VALUE;
+                g_is_mid_time = true;
+            } else if (g_motion_time < MOTION_TIME_MAX_VALUE && next_time > MOTION_TIME_MAX_VALUE) {
+                next_time = MOTION_TIME_MAX_VALUE;
+            } else if (next_time > MOTION_TIME_MAX_VALUE) {
+                next_time = MOTION_TIME_MIN_VALUE;
+                ++g_motion_loop;
             }
-            last_exec_time = get_time_ms();
+            g_motion_time = next_time;
+            g_last_exec_time_us = g_time_us;
         } else {
             // Motion timeout. Hexapod is not move long time -- need down all limbs
-            if (get_time_ms() - last_exec_time > MOTION_LIMBS_DOWN_TIMEOUT) {
+            if (g_time_us - g_last_exec_time_us > MOTION_LIMBS_DOWN_TIMEOUT_US) {
                 g_hexapod_state = HEXAPOD_STATE_MOTION_DEINIT;
             }
         }
@@ -277,21 +618,145 @@ static void main_motion_process(void) {
         if (!g_ext_motion.cfg.distance) {
             bool is_completed = true;
             for (int32_t i = 0; i < SUPPORT_LIMBS_COUNT; ++i) { 
-                if (!mm_move_value(&g_limbs[i].pos.y, 0.0f, CHANGE_SURFACE_POS_MAX_STEP)) {
+                if (!mm_move_value(&g_limbs[i].pos.y, 0.0f, max_step)) {
+                    is_completed = false;
+                }
+                if (!mm_move_value(&g_limbs[i].ground_height, 0.0f, max_step)) {
                     is_completed = false;
                 }
             }
             if (is_completed) {
-                motion_time = MOTION_TIME_MIN_VALUE;
-                motion_loop = 0;
+                reset_feet();
+                g_motion_time = MOTION_TIME_MIN_VALUE;
+                g_motion_loop = 0;
+                g_is_mid_time = false;
                 g_hexapod_state = HEXAPOD_STATE_DOWN; // Core select corrent state automatically after this function call
             }
         } else {
-            g_hexapod_state = HEXAPOD_STATE_MOTION_INIT;
+            start_motion();
+        }
+    }
+}
+
+/// ***************************************************************************
+/// @brief  Start motion with external motion configuration and gait
+/// @note   Trajectory plan is built for init position of limbs
+/// @return true - success, false - plan build error (motion core is disabled)
+/// ***************************************************************************
+static bool start_motion(void) {
+    g_cur_motion.cfg = g_ext_motion.cfg;
+    g_cur_motion.gait = get_ext_gait();
+    
+    const motion_cfg_t* cfg = &g_cur_motion.cfg;
+    if (!mm_traj_build_plan(&g_traj_plan, g_limbs_base_pos, cfg->curvature, cfg->distance, cfg->step_height)) {
+        sysmon_set_error(SYSMON_MATH_ERROR);
+        sysmon_disable_module(SYSMON_MODULE_MOTION_CORE);
+        return false;
+    }
+    g_hexapod_state = HEXAPOD_STATE_MOTION_INIT;
+    return true;
+}
+
+/// ***************************************************************************
+/// @brief  Get gait selected by external motion control flags
+/// @return gait type, tripod for reserved value
+/// ***************************************************************************
+static gait_type_t get_ext_gait(void) {
+    switch (g_ext_motion.ctrl & MOTION_CTRL_GAIT_MASK) {
+        case MOTION_CTRL_GAIT_RIPPLE: return GAIT_RIPPLE;
+        case MOTION_CTRL_GAIT_WAVE:   return GAIT_WAVE;
+        default:                      return GAIT_TRIPOD;
+    }
+}
+
+/// ***************************************************************************
+/// @brief  Update foot contacts and latch contact events
+/// @note   Contact event is foot sensor activation, event time is motion
+///         clock time of tick
+/// @param  is_contacts_valid: foot sensors state is valid
+/// @param  contacts_mask: foot sensors state, bit per limb
+/// ***************************************************************************
+static void update_foot_contacts(bool is_contacts_valid, uint32_t contacts_mask) {
+    g_is_foot_contacts_valid = is_contacts_valid;
+    for (int32_t i = 0; i < SUPPORT_LIMBS_COUNT; ++i) {
+        bool is_contact = (contacts_mask & (1 << i)) != 0;
+        if (is_contact && !g_feet[i].is_contact) {
+            g_feet[i].contact_time_us = g_time_us;
+        }
+        g_feet[i].is_contact = is_contact;
+    }
+}
+
+/// ***************************************************************************
+/// @brief  Adapt limbs trajectory to terrain by foot contacts
+/// @note   Call after trajectory processing. Swing is finished by contact
+///         event after swing start on limb lowering, foot is hold on contact
+///         height and this height becomes ground height of limb. Stance limb
+///         without contact is lowered until contact. Ground heights are
+///         returned to flat surface if adaptation is disabled
+/// @param  motion_time: current motion time [0; 1000]
+/// @param  motion_loop: current motion loop
+/// @param  max_step: max ground height change on tick
+/// @retval g_limbs::pos::y, g_limbs::ground_height
+/// ***************************************************************************
+static void terrain_process(float motion_time, int32_t motion_loop, float max_step) {
+    bool is_enabled = (g_ext_motion.ctrl & MOTION_CTRL_EN_TERRAIN) && g_is_foot_contacts_valid;
+    
+    const gait_table_t* gait = &g_gait_tables[g_cur_motion.gait];
+    const gait_phase_t* phases = gait->phases[(uint32_t)motion_loop % gait->loops_count];
+    for (int32_t i = 0; i < SUPPORT_LIMBS_COUNT; ++i) {
+        foot_t* foot = &g_feet[i];
+        limb_t* limb = &g_limbs[i];
+        if (!is_enabled) {
+            foot->is_swing = false;
+            foot->is_landed = true;
+            mm_move_value(&limb->ground_height, 0.0f, max_step);
+            continue;
+        }
+        
+        if (phases[i].is_swing) {
+            if (!foot->is_swing) {
+                foot->is_swing = true;
+                foot->is_landed = false;
+                foot->swing_start_time_us = g_time_us;
+            }
+            
+            // Contact on limb lowering finishes swing
+            float relative_motion_time = (phases[i].phase_loop + motion_time / MOTION_TIME_MAX_VALUE) / phases[i].phase_loops_count;
+            if (!foot->is_landed && relative_motion_time >= 0.5f && foot->is_contact && foot->contact_time_us > foot->swing_start_time_us) {
+                float ground_height = limb->ground_height + limb->pos.y;
+                constrain_float(&ground_height, MOTION_GROUND_MIN_HEIGHT, MOTION_GROUND_MAX_HEIGHT);
+                foot->landed_height = limb->ground_height + limb->pos.y - ground_height;
+                foot->is_landed = true;
+                limb->ground_height = ground_height;
+            }
+            if (foot->is_landed) {
+                limb->pos.y = foot->landed_height;
+            }
+        } else {
+            foot->is_swing = false;
+            if (foot->is_landed) {
+                mm_move_value(&limb->pos.y, 0.0f, max_step); // Foot is landed above max ground height
+            } else if (foot->is_contact || mm_move_value(&limb->ground_height, MOTION_GROUND_MIN_HEIGHT, max_step)) {
+                foot->is_landed = true;
+                foot->landed_height = 0;
+            }
         }
     }
 }
 
+/// ***************************************************************************
+/// @brief  Reset feet state for new motion
+/// @note   Contact events are not changed
+/// ***************************************************************************
+static void reset_feet(void) {
+    for (int32_t i = 0; i < SUPPORT_LIMBS_COUNT; ++i) {
+        g_feet[i].is_swing = false;
+        g_feet[i].is_landed = false;
+        g_feet[i].landed_height = 0;
+    }
+}
+
 /// ***************************************************************************
 /// @brief  Load configuration
 /// @return true - load and validate success, false - fail
@@ -344,6 +809,18 @@ static void load_config(void) {
     g_limbs[5].tibia.zero_rotate = 135;
     g_limbs[5].join.z = -104;
     g_limbs[5].join.x = 53;
+
+    mm_kinematic_build_geometry(g_limbs);
+    g_is_last_inputs_valid = false;
+}
+
+/// ***************************************************************************
+/// @brief  Compare vectors
+/// @param  a, b: vectors
+/// @return true - vectors are different, false - otherwise
+/// ***************************************************************************
+static bool is_vector_changed(const v3d_t* a, const v3d_t* b) {
+    return a->x != b->x || a->y != b->y || a->z != b->z;
 }
 
 
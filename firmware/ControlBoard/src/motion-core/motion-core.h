@@ -6,9 +6,15 @@
 #ifndef _MOTION_CORE_H_
 #define _MOTION_CORE_H_
 #include "math-structs.h"
+#include "motion-math.h"
 
 #define MOTION_CTRL_NO                  (0x0000u)
 #define MOTION_CTRL_EN_STAB             (0x0001u)
+#define MOTION_CTRL_GAIT_MASK           (0x0006u)
+#define MOTION_CTRL_GAIT_TRIPOD         (0x0000u)
+#define MOTION_CTRL_GAIT_RIPPLE         (0x0002u)
+#define MOTION_CTRL_GAIT_WAVE           (0x0004u)
+#define MOTION_CTRL_EN_TERRAIN          (0x0008u)
 
 
 typedef struct {
@@ -33,6 +39,9 @@ extern void motion_core_move(const ext_motion_t* ext_motion);
 extern ext_motion_t motion_core_get_motion(void);
 extern void motion_core_process(void);
 extern bool motion_core_is_down(void);
+extern const limb_t* motion_core_get_limbs(void);
+extern uint32_t motion_core_save_state(void* buffer, uint32_t size);
+extern bool motion_core_load_state(const void* buffer, uint32_t size);
 
 
 #endif /* _MOTION_CORE_H_ */
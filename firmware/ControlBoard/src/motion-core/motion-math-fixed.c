@@ -0,0 +1,437 @@
+/// ***************************************************************************
+/// @file    motion-math-fixed.c
+/// @author  NeoProg
+/// @brief   Fixed point (Q16.16) implementation of motion math
+/// @note    Enabled by MOTION_MATH_FIXED_POINT define instead of float
+///          implementation from motion-math.c. limb_t API is not changed:
+///          values are converted to Q16.16 on input and back on output.
+///          Trigonometry is integer CORDIC with angles in degrees, so cost of
+///          each call doesn't depend on arguments values
+/// ***************************************************************************
+#include "project-base.h"
+#include "motion-math.h"
+#ifdef MOTION_MATH_FIXED_POINT
+
+typedef int32_t q16_t;                                      // Q16.16
+typedef int32_t q30_t;                                      // Q2.30
+
+#define Q16_ONE                             (1 << 16)
+#define Q30_ONE                             (1 << 30)
+#define Q16(v)                              ((q16_t)((v) * Q16_ONE))
+#define Q16_DEG_90                          Q16(90)
+#define Q16_DEG_180                         Q16(180)
+#define Q16_DEG_360                         ((int64_t)Q16(360))
+#define Q16_RAD_TO_DEG                      (3754936)       // 180 / pi
+#define Q16_LN2                             (45426)         // ln(2)
+#define Q30_MUL(a, b)                       ((q30_t)(((int64_t)(a) * (b)) >> 30))
+
+#define CORDIC_ITERATIONS_COUNT             (28)
+#define CORDIC_GAIN_INV_Q30                 (652032874)     // 1 / prod(sqrt(1 + 2^(-2i)))
+#define CORDIC_VECTOR_MAX_VALUE             (1 << 29)
+
+
+// atan(2^-i) [degree] in Q8.24. Angle is accumulated with 8 extra bits:
+// rounding of Q16.16 table accumulates to few LSB, it is 0.01mm on 6m
+// trajectory radius of straight motion
+static const int32_t cordic_atan_table[CORDIC_ITERATIONS_COUNT] = {
+    754974720, 445687602, 235489088, 119537938, 60000934, 30029717, 15018523, 7509720, 3754917, 1877466,
+    938734, 469367, 234684, 117342, 58671, 29335, 14668, 7334, 3667, 1833, 917, 458, 229, 115, 57, 29, 14, 7
+};
+
+
+static q16_t q16_from_float(float v);
+static float q16_to_float(q16_t v);
+static q16_t q16_mul_q30(q16_t a, q30_t b);
+static q16_t q16_sqrt64(uint64_t v);
+static q16_t q16_exp(q16_t x);
+static q16_t q16_acos_deg(q16_t v);
+static void  cordic_sin_cos(q16_t angle_deg, q30_t* sin_value, q30_t* cos_value);
+static q16_t cordic_atan2_deg(int64_t y, int64_t x);
+static void  surface_build_rotation(const r3d_t* rotate, q30_t r[3][3]);
+
+
+
+bool mm_surface_calculate_offsets(limb_t* limbs, const p3d_t* surface_point, const r3d_t* surface_rotate) {
+    q30_t r[3][3];
+    surface_build_rotation(surface_rotate, r);
+
+    // Foot point P on surface relatively hull is S + R * P
+    q16_t px = q16_from_float(surface_point->x);
+    q16_t py = q16_from_float(surface_point->y);
+    q16_t pz = q16_from_float(surface_point->z);
+    for (int32_t i = 0; i < SUPPORT_LIMBS_COUNT; ++i) {
+        q16_t gy = q16_from_float(limbs[i].ground_height);
+        q16_t lx = q16_from_float(limbs[i].pos.x) + limbs[i].join.x * Q16_ONE;
+        q16_t ly = q16_from_float(limbs[i].pos.y) + gy;
+        q16_t lz = q16_from_float(limbs[i].pos.z) + limbs[i].join.z * Q16_ONE;
+
+        q16_t rx = (q16_t)(((int64_t)r[0][0] * lx + (int64_t)r[0][1] * ly + (int64_t)r[0][2] * lz) >> 30);
+        q16_t ry = (q16_t)(((int64_t)r[1][0] * lx + (int64_t)r[1][1] * ly + (int64_t)r[1][2] * lz) >> 30);
+        q16_t rz = (q16_t)(((int64_t)r[2][0] * lx + (int64_t)r[2][1] * ly + (int64_t)r[2][2] * lz) >> 30);
+        limbs[i].surface_offsets.x = q16_to_float(px + rx - lx);
+        limbs[i].surface_offsets.y = q16_to_float(py + ry - ly + gy);
+        limbs[i].surface_offsets.z = q16_to_float(pz + rz - lz);
+    }
+    return true;
+}
+
+bool mm_kinematic_calculate_angles(limb_t* limbs) {
+    for (int32_t i = 0; i < SUPPORT_LIMBS_COUNT; ++i) {
+        int64_t coxa_length  = limbs[i].coxa.length;
+        int64_t femur_length = limbs[i].femur.length;
+        int64_t tibia_length = limbs[i].tibia.length;
+
+        q16_t x = q16_from_float(limbs[i].pos.x + limbs[i].surface_offsets.x);
+        q16_t y = q16_from_float(limbs[i].pos.y + limbs[i].surface_offsets.y);
+        q16_t z = q16_from_float(limbs[i].pos.z + limbs[i].surface_offsets.z);
+
+        // Move to (X*, Y*, Z*) coordinate system - rotate
+        q30_t s = 0, c = 0;
+        cordic_sin_cos(limbs[i].coxa.zero_rotate * Q16_ONE, &s, &c);
+        q16_t x1 =  q16_mul_q30(x, c) + q16_mul_q30(z, s);
+        q16_t y1 =  y;
+        q16_t z1 = -q16_mul_q30(x, s) + q16_mul_q30(z, c);
+
+
+        // Calculate COXA angle
+        q16_t coxa_angle = cordic_atan2_deg(z1, x1);
+
+
+        //
+        // Prepare for calculation FEMUR and TIBIA angles
+        //
+        // Move to (X*, Y*) coordinate system (rotate on axis Y)
+        cordic_sin_cos(coxa_angle, &s, &c);
+        x1 = q16_mul_q30(x1, c) + q16_mul_q30(z1, s);
+
+        // Move to (X**, Y**) coordinate system (remove coxa from calculations)
+        x1 = x1 - (q16_t)(coxa_length * Q16_ONE);
+
+        // Calculate angle between axis X and destination point
+        q16_t fi = cordic_atan2_deg(y1, x1);
+
+        // Calculate distance to destination point. Unreachable point is projected
+        // to nearest reachable point by distance, angle to point is not changed
+        q16_t d = q16_sqrt64((uint64_t)((int64_t)x1 * x1 + (int64_t)y1 * y1));
+        q16_t min_reach = q16_from_float(limbs[i].geometry.min_reach);
+        q16_t max_reach = q16_from_float(limbs[i].geometry.max_reach);
+        if (d > max_reach) d = max_reach;
+        if (d < min_reach) d = min_reach;
+        if (d == 0) {
+            return false; // Avoid division by zero
+        }
+
+        // Calculate triangle angles
+        int64_t a = tibia_length;
+        int64_t b = femur_length;
+        int64_t c2 = (int64_t)d * d; // Q32.32
+        q16_t cos_alpha = (q16_t)(((b * b - a * a) * ((int64_t)1 << 32) + c2) / (2 * b * d));
+        q16_t cos_gamma = (q16_t)((((a * a + b * b) * ((int64_t)1 << 32) - c2) / (2 * a * b)) >> 16);
+        q16_t alpha = q16_acos_deg(cos_alpha);
+        q16_t gamma = q16_acos_deg(cos_gamma);
+
+        // Calculate FEMUR and TIBIA angle
+        q16_t femur_angle = limbs[i].femur.zero_rotate * Q16_ONE - alpha - fi;
+        q16_t tibia_angle = gamma - limbs[i].tibia.zero_rotate * Q16_ONE;
+
+        // Protection
+        if (coxa_angle  < limbs[i].coxa.prot_min_angle  * Q16_ONE) coxa_angle  = limbs[i].coxa.prot_min_angle  * Q16_ONE;
+        if (femur_angle < limbs[i].femur.prot_min_angle * Q16_ONE) femur_angle = limbs[i].femur.prot_min_angle * Q16_ONE;
+        if (tibia_angle < limbs[i].tibia.prot_min_angle * Q16_ONE) tibia_angle = limbs[i].tibia.prot_min_angle * Q16_ONE;
+        if (coxa_angle  > limbs[i].coxa.prot_max_angle  * Q16_ONE) coxa_angle  = limbs[i].coxa.prot_max_angle  * Q16_ONE;
+        if (femur_angle > limbs[i].femur.prot_max_angle * Q16_ONE) femur_angle = limbs[i].femur.prot_max_angle * Q16_ONE;
+        if (tibia_angle > limbs[i].tibia.prot_max_angle * Q16_ONE) tibia_angle = limbs[i].tibia.prot_max_angle * Q16_ONE;
+        limbs[i].coxa.angle  = q16_to_float(coxa_angle);
+        limbs[i].femur.angle = q16_to_float(femur_angle);
+        limbs[i].tibia.angle = q16_to_float(tibia_angle);
+    }
+    return true;
+}
+
+bool mm_traj_build_plan(traj_plan_t* plan, const v3d_t* base_pos, float curvature, float distance, float step_height) {
+    // Check curvature value. Zero curvature is replaced by minimal positive value
+    int32_t curvature_value = (int32_t)curvature;
+    if      (curvature_value > 1000)  curvature_value = +1000;
+    else if (curvature_value < -1000) curvature_value = -1000;
+    q16_t curvature_abs = (curvature_value == 0) ? 66 : abs(curvature_value) * Q16_ONE; // 0.001
+
+    // Calculation radius of curvature
+    q16_t curvature_radius = q16_exp((1000 * Q16_ONE - curvature_abs) / 115);
+    if (curvature_value < 0) {
+        curvature_radius = -curvature_radius;
+    }
+
+    // Common calculations
+    q16_t max_traj_radius = 0;
+    for (int32_t i = 0; i < SUPPORT_LIMBS_COUNT; ++i) {
+        // Calculation trajectory radius
+        int64_t x0 = q16_from_float(base_pos[i].x);
+        int64_t z0 = q16_from_float(base_pos[i].z);
+        int64_t dx = curvature_radius - x0;
+        plan->traj_radius[i] = q16_sqrt64((uint64_t)(dx * dx + z0 * z0));
+
+        // Search max trajectory radius
+        if (plan->traj_radius[i] > max_traj_radius) {
+            max_traj_radius = plan->traj_radius[i];
+        }
+
+        // Calculation limb start angle
+        plan->start_angle[i] = cordic_atan2_deg(z0, -dx);
+    }
+    if (max_traj_radius == 0) {
+        return false; // Avoid division by zero
+    }
+
+    // Calculation max angle of arc
+    int64_t curvature_radius_sign = (curvature_radius >= 0) ? 1 : -1;
+    plan->max_arc_angle = (q16_t)(curvature_radius_sign * q16_from_float(distance) * Q16_RAD_TO_DEG / max_traj_radius);
+    plan->curvature_radius = curvature_radius;
+    plan->step_height = q16_from_float(step_height);
+
+    // Scale swing profile
+    foot_traj_point_t profile[FOOT_TRAJ_TABLE_SIZE];
+    mm_foot_traj_build_swing(profile);
+    for (int32_t k = 0; k < FOOT_TRAJ_TABLE_SIZE; ++k) {
+        plan->swing_arc_angle[k] = q16_from_float((0.5f - profile[k].progress) * q16_to_float(plan->max_arc_angle));
+        plan->swing_height[k] = q16_from_float(profile[k].height * step_height);
+    }
+    return true;
+}
+
+void mm_traj_process_plan(limb_t* limbs, const traj_plan_t* plan, const gait_table_t* gait, float time, int32_t loop) {
+    // Scale motion time
+    q16_t t = (q16_t)((int64_t)q16_from_float(time) / 1000);
+
+    // Calculation points by time
+    const gait_phase_t* phases = gait->phases[(uint32_t)loop % gait->loops_count];
+    for (int32_t i = 0; i < SUPPORT_LIMBS_COUNT; ++i) {
+
+        // Time of swing or stance phase
+        q16_t relative_motion_time = (phases[i].phase_loop * Q16_ONE + t) / phases[i].phase_loops_count;
+
+        // Calculation arc angle and height for current time. Swing moves
+        // limb back by trajectory, profile table is linear interpolated
+        q16_t arc_angle = 0;
+        if (phases[i].is_swing) {
+            q16_t pos = relative_motion_time * (FOOT_TRAJ_TABLE_SIZE - 1);
+            int32_t k = pos >> 16;
+            if (k > FOOT_TRAJ_TABLE_SIZE - 2) {
+                k = FOOT_TRAJ_TABLE_SIZE - 2;
+            }
+            int64_t f = pos - k * Q16_ONE;
+            arc_angle = plan->swing_arc_angle[k] + (q16_t)(((plan->swing_arc_angle[k + 1] - plan->swing_arc_angle[k]) * f + Q16_ONE / 2) >> 16) + plan->start_angle[i];
+            limbs[i].pos.y = q16_to_float(plan->swing_height[k] + (q16_t)(((plan->swing_height[k + 1] - plan->swing_height[k]) * f + Q16_ONE / 2) >> 16));
+        } else {
+            arc_angle = (q16_t)(((int64_t)(relative_motion_time - Q16_ONE / 2) * plan->max_arc_angle) >> 16) + plan->start_angle[i];
+        }
+
+        // Calculation XZ points by time
+        q30_t s = 0, c = 0;
+        cordic_sin_cos(arc_angle, &s, &c);
+        limbs[i].pos.x = q16_to_float(plan->curvature_radius + q16_mul_q30(plan->traj_radius[i], c));
+        limbs[i].pos.z = q16_to_float(                         q16_mul_q30(plan->traj_radius[i], s));
+    }
+}
+
+bool mm_process_advanced_traj(limb_t* limbs, const v3d_t* base_pos, const gait_table_t* gait, float time, int32_t loop, float curvature, float distance, float step_height) {
+    traj_plan_t plan;
+    if (!mm_traj_build_plan(&plan, base_pos, curvature, distance, step_height)) {
+        return false;
+    }
+    mm_traj_process_plan(limbs, &plan, gait, time, loop);
+    return true;
+}
+
+
+
+
+
+/// ***************************************************************************
+/// @brief  Convert float to Q16.16 with rounding
+/// ***************************************************************************
+static q16_t q16_from_float(float v) {
+    return (q16_t)(v * Q16_ONE + (v >= 0 ? 0.5f : -0.5f));
+}
+
+/// ***************************************************************************
+/// @brief  Convert Q16.16 to float
+/// ***************************************************************************
+static float q16_to_float(q16_t v) {
+    return (float)v / Q16_ONE;
+}
+
+/// ***************************************************************************
+/// @brief  Multiply Q16.16 value by Q2.30 value
+/// ***************************************************************************
+static q16_t q16_mul_q30(q16_t a, q30_t b) {
+    return (q16_t)(((int64_t)a * b + (1 << 29)) >> 30);
+}
+
+/// ***************************************************************************
+/// @brief  Square root
+/// @param  v: value in Q32.32
+/// @return square root in Q16.16
+/// ***************************************************************************
+static q16_t q16_sqrt64(uint64_t v) {
+    uint64_t result = 0;
+    uint64_t bit = (uint64_t)1 << 62;
+    while (bit > v) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (v >= result + bit) {
+            v -= result + bit;
+            result = (result >> 1) + bit;
+        } else {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (q16_t)result;
+}
+
+/// ***************************************************************************
+/// @brief  Exponent e^x
+/// @note   e^x = 2^k * e^r, r = x - k * ln(2), e^r by Taylor series
+/// @param  x: value [0; 10.39] in Q16.16
+/// @return e^x in Q16.16
+/// ***************************************************************************
+static q16_t q16_exp(q16_t x) {
+    int32_t k = x / Q16_LN2;
+    int64_t r = (int64_t)(x - k * Q16_LN2) << 14; // Q2.30
+
+    int64_t term = Q30_ONE;
+    int64_t sum = Q30_ONE;
+    for (int32_t n = 1; n <= 8; ++n) {
+        term = (term * r >> 30) / n;
+        sum += term;
+    }
+    return (q16_t)(((sum << k) + (1 << 13)) >> 14);
+}
+
+/// ***************************************************************************
+/// @brief  Arc cosine
+/// @note   acos(v) = atan2(sqrt(1 - v^2), v), argument is constrained [-1; 1]
+/// @param  v: value in Q16.16
+/// @return angle [degree] in Q16.16
+/// ***************************************************************************
+static q16_t q16_acos_deg(q16_t v) {
+    if (v > Q16_ONE)  v = Q16_ONE;
+    if (v < -Q16_ONE) v = -Q16_ONE;
+    q16_t s = q16_sqrt64((uint64_t)(((int64_t)1 << 32) - (int64_t)v * v));
+    return cordic_atan2_deg(s, v);
+}
+
+/// ***************************************************************************
+/// @brief  Sine and cosine (CORDIC, rotation mode)
+/// @param  angle_deg: angle [degree] in Q16.16
+/// @param  sin_value: sine in Q2.30
+/// @param  cos_value: cosine in Q2.30
+/// ***************************************************************************
+static void cordic_sin_cos(q16_t angle_deg, q30_t* sin_value, q30_t* cos_value) {
+    // Constrain angle to [-90; 90], CORDIC converges in [-99.8; 99.8]
+    int64_t z = angle_deg % Q16_DEG_360;
+    if (z > Q16_DEG_180)   z -= Q16_DEG_360;
+    if (z <= -Q16_DEG_180) z += Q16_DEG_360;
+    bool is_negate = false;
+    if (z > Q16_DEG_90) {
+        z -= Q16_DEG_180;
+        is_negate = true;
+    } else if (z < -Q16_DEG_90) {
+        z += Q16_DEG_180;
+        is_negate = true;
+    }
+
+    z <<= 8;
+    int32_t x = CORDIC_GAIN_INV_Q30;
+    int32_t y = 0;
+    for (int32_t i = 0; i < CORDIC_ITERATIONS_COUNT; ++i) {
+        int32_t dx = y >> i;
+        int32_t dy = x >> i;
+        if (z >= 0) {
+            x -= dx;
+            y += dy;
+            z -= cordic_atan_table[i];
+        } else {
+            x += dx;
+            y -= dy;
+            z += cordic_atan_table[i];
+        }
+    }
+    *sin_value = is_negate ? -y : y;
+    *cos_value = is_negate ? -x : x;
+}
+
+/// ***************************************************************************
+/// @brief  Arc tangent of y/x (CORDIC, vectoring mode)
+/// @param  y: Y coordinate, any fixed point format (same as X)
+/// @param  x: X coordinate, any fixed point format (same as Y)
+/// @return angle [degree] in Q16.16 (-180; 180]
+/// ***************************************************************************
+static q16_t cordic_atan2_deg(int64_t y, int64_t x) {
+    if (x == 0 && y == 0) {
+        return 0;
+    }
+
+    // Rotate vector to right half plane. Angle is accumulated in Q8.24
+    int64_t z = 0;
+    if (x < 0) {
+        z = (int64_t)((y >= 0) ? Q16_DEG_180 : -Q16_DEG_180) << 8;
+        x = -x;
+        y = -y;
+    }
+
+    // Normalize vector for max precision without overflow
+    int64_t max_value = (x > llabs(y)) ? x : llabs(y);
+    while (max_value >= CORDIC_VECTOR_MAX_VALUE) {
+        max_value >>= 1;
+        x >>= 1;
+        y >>= 1;
+    }
+    while (max_value < CORDIC_VECTOR_MAX_VALUE / 2) {
+        max_value <<= 1;
+        x <<= 1;
+        y <<= 1;
+    }
+
+    for (int32_t i = 0; i < CORDIC_ITERATIONS_COUNT; ++i) {
+        int64_t dx = y >> i;
+        int64_t dy = x >> i;
+        if (y > 0) {
+            x += dx;
+            y -= dy;
+            z += cordic_atan_table[i];
+        } else {
+            x -= dx;
+            y += dy;
+            z -= cordic_atan_table[i];
+        }
+    }
+    return (q16_t)((z + (1 << 7)) >> 8);
+}
+
+/// ***************************************************************************
+/// @brief  Build surface rotation matrix R = Ry * Rz * Rx
+/// @param  rotate: surface rotate [degree]
+/// @param  r: rotation matrix in Q2.30
+/// ***************************************************************************
+static void surface_build_rotation(const r3d_t* rotate, q30_t r[3][3]) {
+    q30_t sx = 0, cx = 0;
+    q30_t sy = 0, cy = 0;
+    q30_t sz = 0, cz = 0;
+    cordic_sin_cos(q16_from_float(rotate->x), &sx, &cx);
+    cordic_sin_cos(q16_from_float(rotate->y), &sy, &cy);
+    cordic_sin_cos(q16_from_float(rotate->z), &sz, &cz);
+
+    r[0][0] =  Q30_MUL(cy, cz);
+    r[0][1] = -Q30_MUL(Q30_MUL(cy, sz), cx) + Q30_MUL(sy, sx);
+    r[0][2] =  Q30_MUL(Q30_MUL(cy, sz), sx) + Q30_MUL(sy, cx);
+    r[1][0] =  sz;
+    r[1][1] =  Q30_MUL(cz, cx);
+    r[1][2] = -Q30_MUL(cz, sx);
+    r[2][0] = -Q30_MUL(sy, cz);
+    r[2][1] =  Q30_MUL(Q30_MUL(sy, sz), cx) + Q30_MUL(cy, sx);
+    r[2][2] = -Q30_MUL(Q30_MUL(sy, sz), sx) + Q30_MUL(cy, cx);
+}
+
+#endif // MOTION_MATH_FIXED_POINT
@@ -4,12 +4,41 @@
 /// ***************************************************************************
 #include "project-base.h"
 #include "motion-math.h"
+#include "fast-math.h"
 #include <float.h>
 #define M_PI                                (3.14159265f)
 #define RAD_TO_DEG(rad)                     ((rad) * 180.0f / M_PI)
 #define DEG_TO_RAD(deg)                     ((deg) * M_PI / 180.0f)
-#define IS_EVEN(v)                          (((v) & 0x01) == 0)
-#define IS_ODD(v)                           (((v) & 0x01) != 0)
+
+// S-curve move is completed when position, velocity and acceleration are less than tolerances
+#define SCURVE_POS_TOLERANCE                (0.01f)     // [mm or degree]
+#define SCURVE_VEL_TOLERANCE                (1.0f)      // [mm/s or degree/s]
+#define SCURVE_ACC_TOLERANCE                (50.0f)     // [mm/s^2 or degree/s^2]
+#define SCURVE_JERK_SEARCH_ITERATIONS       (10)
+
+// Long tick is integrated by sub-steps: discrete look-ahead doesn't converge
+// on destination with step much longer than braking ramp (0.1s)
+#define SCURVE_MAX_STEP_DT                  (0.005f)    // [s]
+
+
+// Gait description: cycle duration, swing duration and swing start loop of
+// each limb (limbs 0-2 - left side from front, 3-5 - right side from front)
+typedef struct {
+    uint8_t loops_count;
+    uint8_t swing_loops_count;
+    uint8_t phase_offset[SUPPORT_LIMBS_COUNT];
+} gait_t;
+
+
+static const gait_t gaits[GAITS_COUNT] = {
+    [GAIT_TRIPOD] = { 2, 1, { 0, 1, 0, 1, 0, 1 } },
+    [GAIT_RIPPLE] = { 6, 2, { 4, 2, 0, 1, 5, 3 } },
+    [GAIT_WAVE]   = { 6, 1, { 2, 1, 0, 5, 4, 3 } },
+};
+
+// Batch of limb_t adapters. Static, it is too large for stack (3 KB CSTACK).
+// Adapters are called from main loop only
+static limbs_batch_t adapter_batch;
 
 
 
@@ -111,120 +140,422 @@ bool mm_move_surface(p3d_t* src_p, const p3d_t* dst_p, r3d_t* src_r, const r3d_t
 	return false;
 }
 
-bool mm_surface_calculate_offsets(limb_t* limbs, const p3d_t* surface_point, const r3d_t* surface_rotate) {
-    v3d_t n = {0, 1, 0};
-    float x = 0;
-	float y = 0;
-	float z = 0;
-
-	// Rotate normal by axis X
-	float surface_x_rotate_rad = DEG_TO_RAD(surface_rotate->x);
-	y = n.y * cosf(surface_x_rotate_rad) + n.z * sinf(surface_x_rotate_rad);
-	z = n.y * sinf(surface_x_rotate_rad) - n.z * cosf(surface_x_rotate_rad);
-	n.y = y;
-	n.z = z;
-
-	// Rotate normal by axis Z
-	float surface_z_rotate_rad = DEG_TO_RAD(surface_rotate->z);
-	x = n.x * cosf(surface_z_rotate_rad) - n.y * sinf(surface_z_rotate_rad);
-	y = n.x * sinf(surface_z_rotate_rad) + n.y * cosf(surface_z_rotate_rad);
-	n.x = x;
-	n.y = y;
-
-	// Rotate normal by axis Y
-	float surface_y_rotate_rad = DEG_TO_RAD(surface_rotate->y);
-	x =  n.x * cosf(surface_y_rotate_rad) + n.z * sinf(surface_y_rotate_rad);
-	z = -n.x * sinf(surface_y_rotate_rad) + n.z * cosf(surface_y_rotate_rad);
-	n.x = x;
-	n.z = z;
-
-    // For avoid divide by zero
-    if (fabs(n.y) < FLT_EPSILON) {
+static void scurve_integrate(float* p, float* v, float* a, float j, float t) {
+    *p += *v * t + *a * t * t / 2.0f + j * t * t * t / 6.0f;
+    *v += *a * t + j * t * t / 2.0f;
+    *a += j * t;
+}
+
+static float scurve_stop_distance(float v, float a, const scurve_limits_t* limits) {
+    if (v < 0 || (v == 0 && a < 0)) {
+        return -scurve_stop_distance(-v, -a, limits);
+    }
+    float j_max = limits->jerk;
+    float a_max = limits->acceleration;
+    
+    // Braking is too strong: velocity reaches zero while acceleration ramp down
+    float p = 0;
+    if (a < 0 && isgreater(a * a, 2.0f * j_max * v)) {
+        float t = (-a - sqrtf(a * a - 2.0f * j_max * v)) / j_max;
+        scurve_integrate(&p, &v, &a, j_max, t);
+        return p;
+    }
+    
+    // Braking profile: acceleration ramp to peak, hold (if peak is limited) and ramp up to zero
+    float hold_time = 0;
+    float a_peak = -sqrtf(j_max * v + a * a / 2.0f);
+    if (isless(a_peak, -a_max)) {
+        a_peak = -a_max;
+        hold_time = (v + a * a / (2.0f * j_max) - a_max * a_max / j_max) / a_max;
+    }
+    scurve_integrate(&p, &v, &a, -j_max, (a - a_peak) / j_max);
+    scurve_integrate(&p, &v, &a, 0, hold_time);
+    scurve_integrate(&p, &v, &a, j_max, -a_peak / j_max);
+    return p;
+}
+
+static float scurve_overshoot(float v, float a, float j, float e, float dt, const scurve_limits_t* limits) {
+    float p = 0;
+    scurve_integrate(&p, &v, &a, j, dt);
+    return p + scurve_stop_distance(v, a, limits) - e;
+}
+
+static float scurve_velocity_overshoot(float v, float a, float j, float dt, const scurve_limits_t* limits) {
+    float p = 0;
+    scurve_integrate(&p, &v, &a, j, dt);
+    if (a > 0) {
+        v += a * a / (2.0f * limits->jerk); // Velocity gain on acceleration ramp down
+    }
+    return v - limits->velocity;
+}
+
+static bool scurve_step(float* src, scurve_axis_t* axis, float dst, const scurve_limits_t* limits, float dt) {
+    float e = dst - *src;
+    float v = axis->velocity;
+    float a = axis->acceleration;
+    
+    // Move completed?
+    if (fabs(e) < SCURVE_POS_TOLERANCE && fabs(v) < SCURVE_VEL_TOLERANCE && fabs(a) < SCURVE_ACC_TOLERANCE) {
+        *src = dst;
+        axis->velocity = 0;
+        axis->acceleration = 0;
+        return true;
+    }
+    if (islessequal(dt, 0.0f)) {
         return false;
     }
+    
+    // Plan in direction to destination
+    float sign = (e < 0) ? -1.0f : 1.0f;
+    e *= sign;
+    v *= sign;
+    a *= sign;
+    
+    // Jerk range keeps acceleration limit
+    float j_max = limits->jerk;
+    float j_min = (-limits->acceleration - a) / dt;
+    float j_max_acc = (limits->acceleration - a) / dt;
+    if (isless(j_min, -j_max)) j_min = -j_max;
+    if (isgreater(j_max_acc, j_max)) j_max_acc = j_max;
+    if (isgreater(j_min, j_max_acc)) j_min = j_max_acc;
+    
+    // Cruise: acceleration for reach velocity limit without overshoot
+    float dv = limits->velocity - v;
+    float a_des = sqrtf(2.0f * j_max * fabs(dv));
+    if (isgreater(a_des, limits->acceleration)) {
+        a_des = limits->acceleration;
+    }
+    if (dv < 0) {
+        a_des = -a_des;
+    }
+    float j = (a_des - a) / dt;
+    constrain_float(&j, j_min, j_max_acc);
+    
+    // Velocity look-ahead: acceleration ramp down after this tick shouldn't exceed velocity limit
+    if (isless(v, limits->velocity) && scurve_velocity_overshoot(v, a, j, dt, limits) > 0) {
+        float j_low = j_min;
+        float j_high = j;
+        for (int32_t i = 0; i < SCURVE_JERK_SEARCH_ITERATIONS; ++i) {
+            float j_mid = (j_low + j_high) / 2.0f;
+            if (scurve_velocity_overshoot(v, a, j_mid, dt, limits) > 0) {
+                j_high = j_mid;
+            } else {
+                j_low = j_mid;
+            }
+        }
+        j = j_low;
+    }
+    
+    // Look-ahead: braking profile after this tick should stop on destination.
+    // Otherwise search max jerk which doesn't overshoot destination
+    if (scurve_overshoot(v, a, j, e, dt, limits) > 0) {
+        float j_low = j_min;
+        float j_high = j;
+        if (scurve_overshoot(v, a, j_low, e, dt, limits) < 0) {
+            for (int32_t i = 0; i < SCURVE_JERK_SEARCH_ITERATIONS; ++i) {
+                float j_mid = (j_low + j_high) / 2.0f;
+                if (scurve_overshoot(v, a, j_mid, e, dt, limits) > 0) {
+                    j_high = j_mid;
+                } else {
+                    j_low = j_mid;
+                }
+            }
+        }
+        j = j_low;
+    }
+    
+    // Integrate with constant jerk on tick. Velocity below limit is kept below it
+    float p = 0;
+    float v_prev = v;
+    scurve_integrate(&p, &v, &a, j, dt);
+    if (isless(fabs(v_prev), limits->velocity) && isgreater(fabs(v), limits->velocity)) {
+        v = (v < 0) ? -limits->velocity : limits->velocity;
+    }
+    *src += p * sign;
+    axis->velocity = v * sign;
+    axis->acceleration = a * sign;
+    return false;
+}
 
-    // Nx(x - x0) + Ny(y - y0) + Nz(z - 0z) = 0
-    // y = (-Nx(x - x0) - Nz(z - z0)) / Ny + y0
-    for (int32_t i = 0; i < SUPPORT_LIMBS_COUNT; ++i) {
-        z = limbs[i].pos.z + limbs[i].join.z;
-        x = limbs[i].pos.x + limbs[i].join.x;
-        
-        limbs[i].surface_offsets.x = surface_point->x;
-        limbs[i].surface_offsets.z = surface_point->z;
-        limbs[i].surface_offsets.y = -(n.x * (x - surface_point->x) + n.z * (z - surface_point->z)) / n.y + surface_point->y;
+bool mm_scurve_move(float* src, scurve_axis_t* axis, float dst, const scurve_limits_t* limits, float dt) {
+    
+    // Split tick on equal sub-steps, rounding error of 5ms tick doesn't add sub-step
+    int32_t steps_count = (int32_t)ceilf(dt / SCURVE_MAX_STEP_DT - 0.01f);
+    if (steps_count < 1) {
+        steps_count = 1;
+    }
+    float step_dt = dt / steps_count;
+    for (int32_t i = 0; i < steps_count; ++i) {
+        if (scurve_step(src, axis, dst, limits, step_dt)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool mm_scurve_move_surface(surface_scurve_t* scurve, p3d_t* src_p, const p3d_t* dst_p, r3d_t* src_r, const r3d_t* dst_r,
+                            const scurve_limits_t* limits, float dt) {
+    bool is_completed = true;
+    is_completed &= mm_scurve_move(&src_p->x, &scurve->axes[0], dst_p->x, limits, dt);
+    is_completed &= mm_scurve_move(&src_p->y, &scurve->axes[1], dst_p->y, limits, dt);
+    is_completed &= mm_scurve_move(&src_p->z, &scurve->axes[2], dst_p->z, limits, dt);
+    is_completed &= mm_scurve_move(&src_r->x, &scurve->axes[3], dst_r->x, limits, dt);
+    is_completed &= mm_scurve_move(&src_r->y, &scurve->axes[4], dst_r->y, limits, dt);
+    is_completed &= mm_scurve_move(&src_r->z, &scurve->axes[5], dst_r->z, limits, dt);
+    return is_completed;
+}
+
+bool mm_gait_build_table(gait_table_t* table, gait_type_t gait) {
+    if (gait >= GAITS_COUNT) {
+        return false;
+    }
+    const gait_t* g = &gaits[gait];
+    
+    table->loops_count = g->loops_count;
+    for (uint32_t loop = 0; loop < g->loops_count; ++loop) {
+        for (int32_t i = 0; i < SUPPORT_LIMBS_COUNT; ++i) {
+            // Loop of gait cycle relatively swing start of limb
+            uint8_t cycle_loop = (loop + g->loops_count - g->phase_offset[i]) % g->loops_count;
+            gait_phase_t* phase = &table->phases[loop][i];
+            if (cycle_loop < g->swing_loops_count) {
+                phase->is_swing = true;
+                phase->phase_loop = cycle_loop;
+                phase->phase_loops_count = g->swing_loops_count;
+            } else {
+                phase->is_swing = false;
+                phase->phase_loop = cycle_loop - g->swing_loops_count;
+                phase->phase_loops_count = g->loops_count - g->swing_loops_count;
+            }
+        }
     }
     return true;
 }
 
-bool mm_kinematic_calculate_angles(limb_t* limbs) {
+void mm_kinematic_build_geometry(limb_t* limbs) {
     for (int32_t i = 0; i < SUPPORT_LIMBS_COUNT; ++i) {
-        float coxa_zero_rotate_deg  = limbs[i].coxa.zero_rotate;
-        float femur_zero_rotate_deg = limbs[i].femur.zero_rotate;
-        float tibia_zero_rotate_deg = limbs[i].tibia.zero_rotate;
-        float coxa_length  = limbs[i].coxa.length;
+        limb_geometry_t* g = &limbs[i].geometry;
         float femur_length = limbs[i].femur.length;
         float tibia_length = limbs[i].tibia.length;
 
-        float x = limbs[i].pos.x + limbs[i].surface_offsets.x;
-        float y = limbs[i].pos.y + limbs[i].surface_offsets.y;
-        float z = limbs[i].pos.z + limbs[i].surface_offsets.z;
+        g->coxa_zero_rotate_sin  = sinf(DEG_TO_RAD(limbs[i].coxa.zero_rotate));
+        g->coxa_zero_rotate_cos  = cosf(DEG_TO_RAD(limbs[i].coxa.zero_rotate));
+        g->femur_zero_rotate_rad = DEG_TO_RAD(limbs[i].femur.zero_rotate);
+        g->tibia_zero_rotate_rad = DEG_TO_RAD(limbs[i].tibia.zero_rotate);
+        g->coxa_length        = limbs[i].coxa.length;
+        g->femur_length_sq    = femur_length * femur_length;
+        g->tibia_length_sq    = tibia_length * tibia_length;
+        g->femur_length_x2    = 2.0f * femur_length;
+        g->inv_femur_tibia_x2 = 1.0f / (2.0f * femur_length * tibia_length);
+        g->min_reach          = fabsf(femur_length - tibia_length);
+        g->max_reach          = femur_length + tibia_length;
+        g->coxa_prot_min_rad  = DEG_TO_RAD(limbs[i].coxa.prot_min_angle);
+        g->coxa_prot_max_rad  = DEG_TO_RAD(limbs[i].coxa.prot_max_angle);
+        g->femur_prot_min_rad = DEG_TO_RAD(limbs[i].femur.prot_min_angle);
+        g->femur_prot_max_rad = DEG_TO_RAD(limbs[i].femur.prot_max_angle);
+        g->tibia_prot_min_rad = DEG_TO_RAD(limbs[i].tibia.prot_min_angle);
+        g->tibia_prot_max_rad = DEG_TO_RAD(limbs[i].tibia.prot_max_angle);
+    }
+}
+
+void mm_batch_load(limbs_batch_t* batch, const limb_t* limbs) {
+    for (int32_t i = 0; i < SUPPORT_LIMBS_COUNT; ++i) {
+        const limb_geometry_t* g = &limbs[i].geometry;
+        batch->pos_x[i]       = limbs[i].pos.x;
+        batch->pos_y[i]       = limbs[i].pos.y;
+        batch->pos_z[i]       = limbs[i].pos.z;
+        batch->offset_x[i]    = limbs[i].surface_offsets.x;
+        batch->offset_y[i]    = limbs[i].surface_offsets.y;
+        batch->offset_z[i]    = limbs[i].surface_offsets.z;
+        batch->ground_y[i]    = limbs[i].ground_height;
+        batch->join_x[i]      = limbs[i].join.x;
+        batch->join_z[i]      = limbs[i].join.z;
+        batch->coxa_angle[i]  = limbs[i].coxa.angle;
+        batch->femur_angle[i] = limbs[i].femur.angle;
+        batch->tibia_angle[i] = limbs[i].tibia.angle;
+
+        batch->coxa_zero_rotate_sin[i]  = g->coxa_zero_rotate_sin;
+        batch->coxa_zero_rotate_cos[i]  = g->coxa_zero_rotate_cos;
+        batch->femur_zero_rotate_rad[i] = g->femur_zero_rotate_rad;
+        batch->tibia_zero_rotate_rad[i] = g->tibia_zero_rotate_rad;
+        batch->coxa_length[i]           = g->coxa_length;
+        batch->femur_length_sq[i]       = g->femur_length_sq;
+        batch->tibia_length_sq[i]       = g->tibia_length_sq;
+        batch->femur_length_x2[i]       = g->femur_length_x2;
+        batch->inv_femur_tibia_x2[i]    = g->inv_femur_tibia_x2;
+        batch->min_reach[i]             = g->min_reach;
+        batch->max_reach[i]             = g->max_reach;
+        batch->coxa_prot_min_rad[i]     = g->coxa_prot_min_rad;
+        batch->coxa_prot_max_rad[i]     = g->coxa_prot_max_rad;
+        batch->femur_prot_min_rad[i]    = g->femur_prot_min_rad;
+        batch->femur_prot_max_rad[i]    = g->femur_prot_max_rad;
+        batch->tibia_prot_min_rad[i]    = g->tibia_prot_min_rad;
+        batch->tibia_prot_max_rad[i]    = g->tibia_prot_max_rad;
+    }
+}
+
+void mm_batch_store(const limbs_batch_t* batch, limb_t* limbs) {
+    for (int32_t i = 0; i < SUPPORT_LIMBS_COUNT; ++i) {
+        limbs[i].surface_offsets.x = batch->offset_x[i];
+        limbs[i].surface_offsets.y = batch->offset_y[i];
+        limbs[i].surface_offsets.z = batch->offset_z[i];
+        limbs[i].coxa.angle  = batch->coxa_angle[i];
+        limbs[i].femur.angle = batch->femur_angle[i];
+        limbs[i].tibia.angle = batch->tibia_angle[i];
+    }
+}
 
-        // Move to (X*, Y*, Z*) coordinate system - rotate
-        float coxa_zero_rotate_rad = DEG_TO_RAD(coxa_zero_rotate_deg);
-        float x1 = x * cosf(coxa_zero_rotate_rad) + z * sinf(coxa_zero_rotate_rad);
-        float y1 = y;
-        float z1 = -x * sinf(coxa_zero_rotate_rad) + z * cosf(coxa_zero_rotate_rad);
+static void surface_build_rotation(const r3d_t* rotate, float r[3][3]) {
+    float sx = 0, cx = 0;
+    float sy = 0, cy = 0;
+    float sz = 0, cz = 0;
+    mm_fast_sincos(DEG_TO_RAD(rotate->x), &sx, &cx);
+    mm_fast_sincos(DEG_TO_RAD(rotate->y), &sy, &cy);
+    mm_fast_sincos(DEG_TO_RAD(rotate->z), &sz, &cz);
+
+    // R = Ry * Rz * Rx, surface is rotated by axis X, Z and Y
+    r[0][0] =  cy * cz;
+    r[0][1] = -cy * sz * cx + sy * sx;
+    r[0][2] =  cy * sz * sx + sy * cx;
+    r[1][0] =  sz;
+    r[1][1] =  cz * cx;
+    r[1][2] = -cz * sx;
+    r[2][0] = -sy * cz;
+    r[2][1] =  sy * sz * cx + cy * sx;
+    r[2][2] = -sy * sz * sx + cy * cx;
+}
 
+bool mm_batch_surface_calculate_offsets(limbs_batch_t* batch, const p3d_t* surface_point, const r3d_t* surface_rotate) {
+    float r[3][3];
+    surface_build_rotation(surface_rotate, r);
 
-        // Calculate COXA angle
-        float coxa_angle_rad = atan2f(z1, x1);
-        limbs[i].coxa.angle = RAD_TO_DEG(coxa_angle_rad);
+    // Foot point P on surface relatively hull is S + R * P. Offset is
+    // difference between this point and limb position, (R - I) * P is
+    // exact zero for surface without rotation
+    for (int32_t i = 0; i < SUPPORT_LIMBS_COUNT; ++i) {
+        float x = batch->pos_x[i] + batch->join_x[i];
+        float y = batch->pos_y[i] + batch->ground_y[i];
+        float z = batch->pos_z[i] + batch->join_z[i];
 
+        batch->offset_x[i] = surface_point->x + (r[0][0] * x + r[0][1] * y + r[0][2] * z - x);
+        batch->offset_y[i] = surface_point->y + (r[1][0] * x + r[1][1] * y + r[1][2] * z - y) + batch->ground_y[i];
+        batch->offset_z[i] = surface_point->z + (r[2][0] * x + r[2][1] * y + r[2][2] * z - z);
+    }
+    return true;
+}
 
-        //
-        // Prepare for calculation FEMUR and TIBIA angles
-        //
-        // Move to (X*, Y*) coordinate system (rotate on axis Y)
-        x1 = x1 * cosf(coxa_angle_rad) + z1 * sinf(coxa_angle_rad);
+bool mm_batch_kinematic_calculate_angles(limbs_batch_t* batch) {
+    float x1[SUPPORT_LIMBS_COUNT];
+    float y1[SUPPORT_LIMBS_COUNT];
+    float z1[SUPPORT_LIMBS_COUNT];
+    float tmp[SUPPORT_LIMBS_COUNT];
+    float coxa[SUPPORT_LIMBS_COUNT];
+    float fi[SUPPORT_LIMBS_COUNT];
+    float c[SUPPORT_LIMBS_COUNT];
+    float alpha[SUPPORT_LIMBS_COUNT];
+    float gamma[SUPPORT_LIMBS_COUNT];
+
+    // Move to (X*, Y*, Z*) coordinate system - rotate
+    for (int32_t i = 0; i < SUPPORT_LIMBS_COUNT; ++i) {
+        float x = batch->pos_x[i] + batch->offset_x[i];
+        float z = batch->pos_z[i] + batch->offset_z[i];
+        x1[i] =  x * batch->coxa_zero_rotate_cos[i] + z * batch->coxa_zero_rotate_sin[i];
+        y1[i] =  batch->pos_y[i] + batch->offset_y[i];
+        z1[i] = -x * batch->coxa_zero_rotate_sin[i] + z * batch->coxa_zero_rotate_cos[i];
+        tmp[i] = x1[i] * x1[i] + z1[i] * z1[i];
+    }
 
-        // Move to (X**, Y**) coordinate system (remove coxa from calculations)
-        x1 = x1 - coxa_length;
+    // Calculate COXA angle
+    mm_fast_atan2_array(z1, x1, coxa, SUPPORT_LIMBS_COUNT);
 
-        // Calculate angle between axis X and destination point
-        float fi = atan2f(y1, x1);
+    //
+    // Prepare for calculation FEMUR and TIBIA angles
+    //
+    // Move to (X*, Y*) coordinate system (rotate on axis Y by COXA angle):
+    // x1 * cos(atan2(z1, x1)) + z1 * sin(atan2(z1, x1)) = sqrt(x1^2 + z1^2)
+    mm_fast_sqrt_array(tmp, x1, SUPPORT_LIMBS_COUNT);
 
-        // Calculate distance to destination point
-        float d = sqrt(x1 * x1 + y1 * y1);
-        if (d > femur_length + tibia_length) {
-            return false; // Point not attainable
+    // Move to (X**, Y**) coordinate system (remove coxa from calculations)
+    for (int32_t i = 0; i < SUPPORT_LIMBS_COUNT; ++i) {
+        x1[i] = x1[i] - batch->coxa_length[i];
+        tmp[i] = x1[i] * x1[i] + y1[i] * y1[i];
+    }
+
+    // Calculate angle between axis X and destination point
+    mm_fast_atan2_array(y1, x1, fi, SUPPORT_LIMBS_COUNT);
+
+    // Calculate distance to destination point. Unreachable point is projected
+    // to nearest reachable point by distance, angle to point is not changed
+    mm_fast_sqrt_array(tmp, c, SUPPORT_LIMBS_COUNT);
+    for (int32_t i = 0; i < SUPPORT_LIMBS_COUNT; ++i) {
+        if (isgreater(c[i], batch->max_reach[i])) {
+            c[i] = batch->max_reach[i];
+            tmp[i] = c[i] * c[i];
+        } else if (isless(c[i], batch->min_reach[i])) {
+            c[i] = batch->min_reach[i];
+            tmp[i] = c[i] * c[i];
         }
+    }
 
-        // Calculate triangle angles
-        float a = tibia_length;
-        float b = femur_length;
-        float c = d;
-        float alpha = acosf( (b * b + c * c - a * a) / (2.0f * b * c) );
-        float gamma = acosf( (a * a + b * b - c * c) / (2.0f * a * b) );
-
-        // Calculate FEMUR and TIBIA angle
-        limbs[i].femur.angle = femur_zero_rotate_deg - RAD_TO_DEG(alpha) - RAD_TO_DEG(fi);
-        limbs[i].tibia.angle = RAD_TO_DEG(gamma) - tibia_zero_rotate_deg;
-
-        // Protection
-        if (isless(limbs[i].coxa.angle,  limbs[i].coxa.prot_min_angle))  limbs[i].coxa.angle  = limbs[i].coxa.prot_min_angle;
-        if (isless(limbs[i].femur.angle, limbs[i].femur.prot_min_angle)) limbs[i].femur.angle = limbs[i].femur.prot_min_angle;
-        if (isless(limbs[i].tibia.angle, limbs[i].tibia.prot_min_angle)) limbs[i].tibia.angle = limbs[i].tibia.prot_min_angle;
-        if (isgreater(limbs[i].coxa.angle,  limbs[i].coxa.prot_max_angle))  limbs[i].coxa.angle  = limbs[i].coxa.prot_max_angle;
-        if (isgreater(limbs[i].femur.angle, limbs[i].femur.prot_max_angle)) limbs[i].femur.angle = limbs[i].femur.prot_max_angle;
-        if (isgreater(limbs[i].tibia.angle, limbs[i].tibia.prot_max_angle)) limbs[i].tibia.angle = limbs[i].tibia.prot_max_angle;
+    // Calculate triangle angles (a - tibia, b - femur, c - distance)
+    for (int32_t i = 0; i < SUPPORT_LIMBS_COUNT; ++i) {
+        alpha[i] = (batch->femur_length_sq[i] + tmp[i] - batch->tibia_length_sq[i]) / (batch->femur_length_x2[i] * c[i]);
+        gamma[i] = (batch->tibia_length_sq[i] + batch->femur_length_sq[i] - tmp[i]) * batch->inv_femur_tibia_x2[i];
+    }
+    mm_fast_acos_array(alpha, alpha, SUPPORT_LIMBS_COUNT);
+    mm_fast_acos_array(gamma, gamma, SUPPORT_LIMBS_COUNT);
+
+    // Calculate FEMUR and TIBIA angle, protection
+    for (int32_t i = 0; i < SUPPORT_LIMBS_COUNT; ++i) {
+        float coxa_angle  = coxa[i];
+        float femur_angle = batch->femur_zero_rotate_rad[i] - alpha[i] - fi[i];
+        float tibia_angle = gamma[i] - batch->tibia_zero_rotate_rad[i];
+
+        coxa_angle  = (coxa_angle  < batch->coxa_prot_min_rad[i])  ? batch->coxa_prot_min_rad[i]  : coxa_angle;
+        femur_angle = (femur_angle < batch->femur_prot_min_rad[i]) ? batch->femur_prot_min_rad[i] : femur_angle;
+        tibia_angle = (tibia_angle < batch->tibia_prot_min_rad[i]) ? batch->tibia_prot_min_rad[i] : tibia_angle;
+        coxa_angle  = (coxa_angle  > batch->coxa_prot_max_rad[i])  ? batch->coxa_prot_max_rad[i]  : coxa_angle;
+        femur_angle = (femur_angle > batch->femur_prot_max_rad[i]) ? batch->femur_prot_max_rad[i] : femur_angle;
+        tibia_angle = (tibia_angle > batch->tibia_prot_max_rad[i]) ? batch->tibia_prot_max_rad[i] : tibia_angle;
+
+        batch->coxa_angle[i]  = RAD_TO_DEG(coxa_angle);
+        batch->femur_angle[i] = RAD_TO_DEG(femur_angle);
+        batch->tibia_angle[i] = RAD_TO_DEG(tibia_angle);
     }
     return true;
 }
 
-bool mm_process_advanced_traj(limb_t* limbs, const v3d_t* base_pos, float time, int32_t loop, float curvature, float distance, float step_height) {
-    // Scale motion time
-    time /= 1000.0f;
+#ifndef MOTION_MATH_FIXED_POINT // Fixed point implementation is in motion-math-fixed.c
+bool mm_surface_calculate_offsets(limb_t* limbs, const p3d_t* surface_point, const r3d_t* surface_rotate) {
+    limbs_batch_t* batch = &adapter_batch; // Surface kernel uses positions and joins only
+    for (int32_t i = 0; i < SUPPORT_LIMBS_COUNT; ++i) {
+        batch->pos_x[i]    = limbs[i].pos.x;
+        batch->pos_y[i]    = limbs[i].pos.y;
+        batch->pos_z[i]    = limbs[i].pos.z;
+        batch->ground_y[i] = limbs[i].ground_height;
+        batch->join_x[i]   = limbs[i].join.x;
+        batch->join_z[i]   = limbs[i].join.z;
+    }
+    if (!mm_batch_surface_calculate_offsets(batch, surface_point, surface_rotate)) {
+        return false;
+    }
+    for (int32_t i = 0; i < SUPPORT_LIMBS_COUNT; ++i) {
+        limbs[i].surface_offsets.x = batch->offset_x[i];
+        limbs[i].surface_offsets.y = batch->offset_y[i];
+        limbs[i].surface_offsets.z = batch->offset_z[i];
+    }
+    return true;
+}
+
+bool mm_kinematic_calculate_angles(limb_t* limbs) {
+    mm_batch_load(&adapter_batch, limbs);
+    if (!mm_batch_kinematic_calculate_angles(&adapter_batch)) {
+        return false;
+    }
+    mm_batch_store(&adapter_batch, limbs);
+    return true;
+}
 
+bool mm_traj_build_plan(traj_plan_t* plan, const v3d_t* base_pos, float curvature, float distance, float step_height) {
     // Check curvature value
     if      ((int32_t)curvature == 0)    curvature = +0.001f;
     else if ((int32_t)curvature > 1000)  curvature = +1000.0f;
@@ -234,22 +565,20 @@ bool mm_process_advanced_traj(limb_t* limbs, const v3d_t* base_pos, float time,
     float curvature_radius = expf((1000.0f - fabs(curvature)) / 115.0f) * (curvature / fabs(curvature));
 
     // Common calculations
-    float traj_radius[SUPPORT_LIMBS_COUNT];
-    float start_angle_rad[SUPPORT_LIMBS_COUNT];
     float max_traj_radius = 0;
     for (int32_t i = 0; i < SUPPORT_LIMBS_COUNT; ++i) {
         // Calculation trajectory radius
         float x0 = base_pos[i].x;
         float z0 = base_pos[i].z;
-        traj_radius[i] = sqrtf((curvature_radius - x0) * (curvature_radius - x0) + z0 * z0);
+        plan->traj_radius[i] = mm_fast_sqrt((curvature_radius - x0) * (curvature_radius - x0) + z0 * z0);
 
         // Search max trajectory radius
-        if (isgreater(traj_radius[i], max_traj_radius)) {
-            max_traj_radius = traj_radius[i];
+        if (isgreater(plan->traj_radius[i], max_traj_radius)) {
+            max_traj_radius = plan->traj_radius[i];
         }
 
         // Calculation limb start angle
-        start_angle_rad[i] = atan2f(z0, -(curvature_radius - x0));
+        plan->start_angle[i] = mm_fast_atan2(z0, -(curvature_radius - x0));
     }
     if (fabs(max_traj_radius) < FLT_EPSILON) {
         return false; // Avoid division by zero
@@ -257,41 +586,62 @@ bool mm_process_advanced_traj(limb_t* limbs, const v3d_t* base_pos, float time,
 
     // Calculation max angle of arc
     int32_t curvature_radius_sign = (curvature_radius >= 0) ? 1 : -1;
-    float max_arc_angle = curvature_radius_sign * distance / max_traj_radius;
+    plan->max_arc_angle = curvature_radius_sign * distance / max_traj_radius;
+    plan->curvature_radius = curvature_radius;
+    plan->step_height = step_height;
+    
+    // Scale swing profile
+    foot_traj_point_t profile[FOOT_TRAJ_TABLE_SIZE];
+    mm_foot_traj_build_swing(profile);
+    for (int32_t k = 0; k < FOOT_TRAJ_TABLE_SIZE; ++k) {
+        plan->swing_arc_angle[k] = (0.5f - profile[k].progress) * plan->max_arc_angle;
+        plan->swing_height[k] = profile[k].height * step_height;
+    }
+    return true;
+}
+
+void mm_traj_process_plan(limb_t* limbs, const traj_plan_t* plan, const gait_table_t* gait, float time, int32_t loop) {
+    // Scale motion time
+    time /= 1000.0f;
 
     // Calculation points by time
+    const gait_phase_t* phases = gait->phases[(uint32_t)loop % gait->loops_count];
     for (int32_t i = 0; i < SUPPORT_LIMBS_COUNT; ++i) {
 
-        // Inversion motion time if needed
-        float relative_motion_time = time;
-        if ((loop & 0x01) == 0) {
-            if ((i & 0x01) == 0) { // Even?
-                relative_motion_time = 1.0f - relative_motion_time;
+        // Time of swing or stance phase
+        float relative_motion_time = (phases[i].phase_loop + time) / phases[i].phase_loops_count;
+        
+        // Calculation arc angle and height for current time. Swing moves
+        // limb back by trajectory, profile table is linear interpolated
+        float arc_angle_rad = 0;
+        if (phases[i].is_swing) {
+            float pos = relative_motion_time * (FOOT_TRAJ_TABLE_SIZE - 1);
+            int32_t k = (int32_t)pos;
+            if (k > FOOT_TRAJ_TABLE_SIZE - 2) {
+                k = FOOT_TRAJ_TABLE_SIZE - 2;
             }
+            float f = pos - k;
+            arc_angle_rad = plan->swing_arc_angle[k] + (plan->swing_arc_angle[k + 1] - plan->swing_arc_angle[k]) * f + plan->start_angle[i];
+            limbs[i].pos.y = plan->swing_height[k] + (plan->swing_height[k + 1] - plan->swing_height[k]) * f;
         } else {
-            if ((i & 0x01) != 0) { // Odd?
-                relative_motion_time = 1.0f - relative_motion_time;
-            }
+            arc_angle_rad = (relative_motion_time - 0.5f) * plan->max_arc_angle + plan->start_angle[i];
         }
-        
-        
-        // Calculation arc angle for current time
-        float arc_angle_rad = (relative_motion_time - 0.5f) * max_arc_angle + start_angle_rad[i];
 
         // Calculation XZ points by time
-        limbs[i].pos.x = curvature_radius + traj_radius[i] * cosf(arc_angle_rad);
-        limbs[i].pos.z =                    traj_radius[i] * sinf(arc_angle_rad);
-        
-        // Calculation Y points by time
-        if ((loop & 0x01) == 0) {
-            if ((i & 0x01) == 0) { // Odd?
-                limbs[i].pos.y = step_height * sinf(relative_motion_time * M_PI);
-            }
-        } else {
-            if ((i & 0x01) != 0) { // Even?
-                limbs[i].pos.y = step_height * sinf(relative_motion_time * M_PI);
-            }
-        }
+        float s = 0;
+        float c = 0;
+        mm_fast_sincos(arc_angle_rad, &s, &c);
+        limbs[i].pos.x = plan->curvature_radius + plan->traj_radius[i] * c;
+        limbs[i].pos.z =                          plan->traj_radius[i] * s;
+    }
+}
+
+bool mm_process_advanced_traj(limb_t* limbs, const v3d_t* base_pos, const gait_table_t* gait, float time, int32_t loop, float curvature, float distance, float step_height) {
+    traj_plan_t plan;
+    if (!mm_traj_build_plan(&plan, base_pos, curvature, distance, step_height)) {
+        return false;
     }
+    mm_traj_process_plan(limbs, &plan, gait, time, loop);
     return true;
 }
+#endif // MOTION_MATH_FIXED_POINT
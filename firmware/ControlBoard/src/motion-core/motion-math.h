@@ -6,8 +6,14 @@
 #ifndef _MOTION_MATH_H_
 #define _MOTION_MATH_H_
 #include "math-structs.h"
+#include "foot-traj.h"
 
 #define SUPPORT_LIMBS_COUNT                 (6)
+#define GAIT_MAX_LOOPS_COUNT                (6)
+
+// Define MOTION_MATH_FIXED_POINT for use fixed point (Q16.16) implementation
+// of mm_surface_calculate_offsets(), mm_kinematic_calculate_angles() and
+// trajectory functions (motion-math-fixed.c) instead of float
 
 
 typedef struct {
@@ -18,15 +24,137 @@ typedef struct {
     int16_t  prot_max_angle; // [CFG] Protection max angle, [degree]
 } link_t;
 
+typedef struct {
+    float coxa_zero_rotate_sin;   // sin(coxa.zero_rotate)
+    float coxa_zero_rotate_cos;   // cos(coxa.zero_rotate)
+    float femur_zero_rotate_rad;
+    float tibia_zero_rotate_rad;
+    float coxa_length;
+    float femur_length_sq;        // femur.length^2
+    float tibia_length_sq;        // tibia.length^2
+    float femur_length_x2;        // 2 * femur.length
+    float inv_femur_tibia_x2;     // 1 / (2 * femur.length * tibia.length)
+    float min_reach;              // |femur.length - tibia.length|, [mm]
+    float max_reach;              // femur.length + tibia.length, [mm]
+    float coxa_prot_min_rad;
+    float coxa_prot_max_rad;
+    float femur_prot_min_rad;
+    float femur_prot_max_rad;
+    float tibia_prot_min_rad;
+    float tibia_prot_max_rad;
+} limb_geometry_t;
+
 typedef struct {
     v3d_t  pos;              // Limb position on flat surface with (0; 0; 0) coords and normal vector (0; 1; 0)
     v3d_t  surface_offsets;  // Limb position relatively surface height from (0; 0; 0) and rotate
+    float  ground_height;    // Ground height under limb relatively flat surface, added to surface_offsets::y
     link_t coxa;
     link_t femur;
     link_t tibia;
     v2d_t  join;
+    limb_geometry_t geometry; // Derived from [CFG] fields, @ref mm_kinematic_build_geometry
 } limb_t;
 
+// Limbs in structure of arrays layout for batched kernels (mm_batch_*).
+// limb_t is adapter for this layout, @ref mm_batch_load and @ref mm_batch_store
+typedef struct {
+    float pos_x[SUPPORT_LIMBS_COUNT];                // limb_t::pos
+    float pos_y[SUPPORT_LIMBS_COUNT];
+    float pos_z[SUPPORT_LIMBS_COUNT];
+    float offset_x[SUPPORT_LIMBS_COUNT];             // limb_t::surface_offsets
+    float offset_y[SUPPORT_LIMBS_COUNT];
+    float offset_z[SUPPORT_LIMBS_COUNT];
+    float ground_y[SUPPORT_LIMBS_COUNT];             // limb_t::ground_height
+    float join_x[SUPPORT_LIMBS_COUNT];               // limb_t::join
+    float join_z[SUPPORT_LIMBS_COUNT];
+    float coxa_angle[SUPPORT_LIMBS_COUNT];           // limb_t::coxa::angle, [degree]
+    float femur_angle[SUPPORT_LIMBS_COUNT];          // limb_t::femur::angle, [degree]
+    float tibia_angle[SUPPORT_LIMBS_COUNT];          // limb_t::tibia::angle, [degree]
+
+    // limb_t::geometry
+    float coxa_zero_rotate_sin[SUPPORT_LIMBS_COUNT];
+    float coxa_zero_rotate_cos[SUPPORT_LIMBS_COUNT];
+    float femur_zero_rotate_rad[SUPPORT_LIMBS_COUNT];
+    float tibia_zero_rotate_rad[SUPPORT_LIMBS_COUNT];
+    float coxa_length[SUPPORT_LIMBS_COUNT];
+    float femur_length_sq[SUPPORT_LIMBS_COUNT];
+    float tibia_length_sq[SUPPORT_LIMBS_COUNT];
+    float femur_length_x2[SUPPORT_LIMBS_COUNT];
+    float inv_femur_tibia_x2[SUPPORT_LIMBS_COUNT];
+    float min_reach[SUPPORT_LIMBS_COUNT];
+    float max_reach[SUPPORT_LIMBS_COUNT];
+    float coxa_prot_min_rad[SUPPORT_LIMBS_COUNT];
+    float coxa_prot_max_rad[SUPPORT_LIMBS_COUNT];
+    float femur_prot_min_rad[SUPPORT_LIMBS_COUNT];
+    float femur_prot_max_rad[SUPPORT_LIMBS_COUNT];
+    float tibia_prot_min_rad[SUPPORT_LIMBS_COUNT];
+    float tibia_prot_max_rad[SUPPORT_LIMBS_COUNT];
+} limbs_batch_t;
+
+
+
+// Trajectory invariants for motion configuration, @ref mm_traj_build_plan
+typedef struct {
+#ifndef MOTION_MATH_FIXED_POINT
+    float curvature_radius;                          // [mm]
+    float max_arc_angle;                             // [rad]
+    float step_height;                               // [mm]
+    float traj_radius[SUPPORT_LIMBS_COUNT];          // [mm]
+    float start_angle[SUPPORT_LIMBS_COUNT];          // [rad]
+    float swing_arc_angle[FOOT_TRAJ_TABLE_SIZE];     // [rad] relatively limb start angle
+    float swing_height[FOOT_TRAJ_TABLE_SIZE];        // [mm]
+#else
+    int32_t curvature_radius;                        // Q16.16 [mm]
+    int32_t max_arc_angle;                           // Q16.16 [degree]
+    int32_t step_height;                             // Q16.16 [mm]
+    int32_t traj_radius[SUPPORT_LIMBS_COUNT];        // Q16.16 [mm]
+    int32_t start_angle[SUPPORT_LIMBS_COUNT];        // Q16.16 [degree]
+    int32_t swing_arc_angle[FOOT_TRAJ_TABLE_SIZE];   // Q16.16 [degree] relatively limb start angle
+    int32_t swing_height[FOOT_TRAJ_TABLE_SIZE];      // Q16.16 [mm]
+#endif // MOTION_MATH_FIXED_POINT
+} traj_plan_t;
+
+// Gaits. Gait cycle is few motion loops, each limb swings during
+// part of cycle from its phase offset and stays on ground (stance) during rest
+// of cycle. Tripod is fastest, ripple carries payload, wave is most stable
+typedef enum {
+    GAIT_TRIPOD,                                     // Duty factor 1/2, 3 limbs swing
+    GAIT_RIPPLE,                                     // Duty factor 2/3, 2 limbs swing
+    GAIT_WAVE,                                       // Duty factor 5/6, 1 limb swings
+    GAITS_COUNT
+} gait_type_t;
+
+// Limb phase on motion loop of gait cycle
+typedef struct {
+    uint8_t is_swing;
+    uint8_t phase_loop;                              // Loop of swing or stance phase
+    uint8_t phase_loops_count;                       // Swing or stance phase duration [loops]
+} gait_phase_t;
+
+// Phase table of gait, @ref mm_gait_build_table
+typedef struct {
+    uint32_t loops_count;                            // Gait cycle duration [loops]
+    gait_phase_t phases[GAIT_MAX_LOOPS_COUNT][SUPPORT_LIMBS_COUNT];
+} gait_table_t;
+
+// S-curve move limits, @ref mm_scurve_move
+typedef struct {
+    float velocity;                                  // [mm/s or degree/s]
+    float acceleration;                              // [mm/s^2 or degree/s^2]
+    float jerk;                                      // [mm/s^3 or degree/s^3]
+} scurve_limits_t;
+
+// S-curve move state of one axis
+typedef struct {
+    float velocity;                                  // [mm/s or degree/s]
+    float acceleration;                              // [mm/s^2 or degree/s^2]
+} scurve_axis_t;
+
+// S-curve move state of surface: point X, Y, Z and rotation X, Y, Z axes
+typedef struct {
+    scurve_axis_t axes[6];
+} surface_scurve_t;
+
 
 
 /// ***************************************************************************
@@ -58,8 +186,41 @@ extern bool mm_move_vector(v3d_t* src, const v3d_t* dst, float max_step);
 /// ***************************************************************************
 extern bool mm_move_surface(p3d_t* src_p, const p3d_t* dst_p, r3d_t* src_r, const r3d_t* dst_r, float max_step);
 
+/// ***************************************************************************
+/// @brief  Move value on tick with jerk limited (S-curve) velocity profile
+/// @param  src: source value
+/// @param  axis: axis velocity and acceleration, zero state for axis at rest
+/// @param  dst: destination value, may be changed on any tick
+/// @param  limits: velocity, acceleration and jerk limits
+/// @param  dt: tick duration [s]
+/// @return true - value already reached destination value, false - otherwise
+/// @note   Online planner: braking distance is calculated each tick for
+///         state after acceleration ramp down (look-ahead), so destination
+///         or limits change doesn't make velocity or acceleration steps.
+///         Tick longer than 5ms is integrated by equal sub-steps
+/// ***************************************************************************
+extern bool mm_scurve_move(float* src, scurve_axis_t* axis, float dst, const scurve_limits_t* limits, float dt);
+
+/// ***************************************************************************
+/// @brief  Move surface on tick with jerk limited (S-curve) velocity profile
+/// @param  scurve: surface axes state
+/// @param  src_p: source surface point pos
+/// @param  dst_p: destination surface point pos
+/// @param  src_r: source surface rotation
+/// @param  dst_r: destination surface rotation
+/// @param  limits: velocity, acceleration and jerk limits for each axis
+/// @param  dt: tick duration [s]
+/// @return true - surface already reached destination pos, false - otherwise
+/// ***************************************************************************
+extern bool mm_scurve_move_surface(surface_scurve_t* scurve, p3d_t* src_p, const p3d_t* dst_p, r3d_t* src_r, const r3d_t* dst_r,
+                                   const scurve_limits_t* limits, float dt);
+
 /// ***************************************************************************
 /// @brief  Surface compensation
+/// @note   Surface is rotated by axis X, Z and Y (R = Ry * Rz * Rx) around
+///         surface point, rotation matrix is applied to foot points of all
+///         limbs. Ground height under each limb is added to surface height,
+///         @ref limb_t::ground_height
 /// @param  limbs: hexapod limbs
 /// @param  surface_point: surface point
 /// @param  surface_rotate: surface rotate
@@ -67,18 +228,98 @@ extern bool mm_move_surface(p3d_t* src_p, const p3d_t* dst_p, r3d_t* src_r, cons
 /// ***************************************************************************
 extern bool mm_surface_calculate_offsets(limb_t* limbs, const p3d_t* surface_point, const r3d_t* surface_rotate);
 
+/// ***************************************************************************
+/// @brief  Build limbs geometry from configuration
+/// @note   Must be called after any change of [CFG] fields of limbs. Geometry
+///         includes reachable workspace of limb: range of distance from femur
+///         join to foot by links lengths, @ref mm_kinematic_calculate_angles
+/// @param  limbs: limb_t structure, @ref limb_t
+/// @retval limb_t::geometry
+/// ***************************************************************************
+extern void mm_kinematic_build_geometry(limb_t* limbs);
+
 /// ***************************************************************************
 /// @brief  Calculate angles
+/// @note   Unreachable foot point is projected to nearest reachable point:
+///         distance from femur join to foot is constrained by
+///         [min_reach; max_reach] of limb geometry, direction is not changed
 /// @param  limbs: limb_t structure, @ref limb_t
 /// @retval limb_t::link_t::servo_angle
 /// @return true - calculation success, false - no
 /// ***************************************************************************
 extern bool mm_kinematic_calculate_angles(limb_t* limbs);
 
+/// ***************************************************************************
+/// @brief  Load limbs to batch
+/// @param  batch: limbs in structure of arrays layout
+/// @param  limbs: hexapod limbs
+/// ***************************************************************************
+extern void mm_batch_load(limbs_batch_t* batch, const limb_t* limbs);
+
+/// ***************************************************************************
+/// @brief  Store batch results (surface offsets and angles) to limbs
+/// @param  batch: limbs in structure of arrays layout
+/// @param  limbs: hexapod limbs
+/// ***************************************************************************
+extern void mm_batch_store(const limbs_batch_t* batch, limb_t* limbs);
+
+/// ***************************************************************************
+/// @brief  Surface compensation for all limbs
+/// @note   Float implementation of mm_surface_calculate_offsets()
+/// @param  batch: limbs in structure of arrays layout
+/// @param  surface_point: surface point
+/// @param  surface_rotate: surface rotate
+/// @return true - calculation success, false - no
+/// ***************************************************************************
+extern bool mm_batch_surface_calculate_offsets(limbs_batch_t* batch, const p3d_t* surface_point, const r3d_t* surface_rotate);
+
+/// ***************************************************************************
+/// @brief  Calculate angles for all limbs
+/// @note   Float implementation of mm_kinematic_calculate_angles()
+/// @param  batch: limbs in structure of arrays layout
+/// @return true - calculation success, false - no
+/// ***************************************************************************
+extern bool mm_batch_kinematic_calculate_angles(limbs_batch_t* batch);
+
+/// ***************************************************************************
+/// @brief  Build phase table of gait
+/// @note   Call once for each gait, switch gaits by table pointer
+/// @param  table: gait table
+/// @param  gait: gait type
+/// @return true - build success, false - unknown gait
+/// ***************************************************************************
+extern bool mm_gait_build_table(gait_table_t* table, gait_type_t gait);
+
+/// ***************************************************************************
+/// @brief  Build trajectory plan for motion configuration
+/// @note   Call on motion configuration change only. Swing profile is
+///         scaled by step distance and height, @ref mm_foot_traj_build_swing
+/// @param  plan: trajectory plan
+/// @param  base_pos: base limbs position
+/// @param  curvature: trajectory curvature
+/// @param  distance: trajectory distance
+/// @param  step_height: max step height
+/// @return true - calculation success, false - no
+/// ***************************************************************************
+extern bool mm_traj_build_plan(traj_plan_t* plan, const v3d_t* base_pos, float curvature, float distance, float step_height);
+
+/// ***************************************************************************
+/// @brief  Process trajectory plan
+/// @param  limbs: limb_t structure, @ref limb_t
+/// @param  plan: trajectory plan, @ref mm_traj_build_plan
+/// @param  gait: gait table, @ref mm_gait_build_table
+/// @param  time: current motion time [0; 1000]
+/// @param  loop: current motion loop
+/// @retval modify g_limbs::pos
+/// ***************************************************************************
+extern void mm_traj_process_plan(limb_t* limbs, const traj_plan_t* plan, const gait_table_t* gait, float time, int32_t loop);
+
 /// ***************************************************************************
 /// @brief  Process advanced trajectory
+/// @note   Builds plan and processes it. Use plan functions for periodic calls
 /// @param  limbs: limb_t structure, @ref limb_t
 /// @param  base_pos: base limbs position
+/// @param  gait: gait table, @ref mm_gait_build_table
 /// @param  time: current motion time [0; 1000]
 /// @param  loop: current motion loop
 /// @param  curvature: trajectory curvature
@@ -87,7 +328,7 @@ extern bool mm_kinematic_calculate_angles(limb_t* limbs);
 /// @retval modify g_limbs::pos
 /// @return true - calculation success, false - no
 /// ***************************************************************************
-extern bool mm_process_advanced_traj(limb_t* limbs, const v3d_t* base_pos, float time, int32_t loop, float curvature, float distance, float step_height);
+extern bool mm_process_advanced_traj(limb_t* limbs, const v3d_t* base_pos, const gait_table_t* gait, float time, int32_t loop, float curvature, float distance, float step_height);
 
 
 #endif // _MOTION_MATH_H_
@@ -0,0 +1,350 @@
+/// ***************************************************************************
+/// @file    motion-record.c
+/// @author  NeoProg
+/// ***************************************************************************
+#include "project-base.h"
+#include "motion-record.h"
+#define FNV_OFFSET_BASIS                    (2166136261u)
+#define FNV_PRIME                           (16777619u)
+#ifdef MOTION_RECORD_ENABLED
+#define HALF_SIZE                           (MOTION_RECORD_BUFFER_SIZE / 2)
+#define TICK_RESERVE_SIZE                   (sizeof(motion_record_move_t) + sizeof(motion_record_time_t) + sizeof(motion_record_tick_t))
+#define DUMP_CHUNK_SIZE                     (256)
+
+
+typedef struct {
+    uint8_t  data[HALF_SIZE];
+    uint32_t state_size;        // Motion core state snapshot in data start
+    uint32_t size;              // Used size with snapshot, 0 - half is empty
+} half_t;
+
+
+static void switch_half(void);
+static bool write_record(const void* record, uint32_t size);
+
+CLI_CMD_HANDLER(motion_record_cli_cmd_help);
+CLI_CMD_HANDLER(motion_record_cli_cmd_status);
+CLI_CMD_HANDLER(motion_record_cli_cmd_start);
+CLI_CMD_HANDLER(motion_record_cli_cmd_stop);
+CLI_CMD_HANDLER(motion_record_cli_cmd_dump);
+
+static const cli_cmd_t cli_cmd_list[] = {
+    { .cmd = "help",   .handler = motion_record_cli_cmd_help   },
+    { .cmd = "status", .handler = motion_record_cli_cmd_status },
+    { .cmd = "start",  .handler = motion_record_cli_cmd_start  },
+    { .cmd = "stop",   .handler = motion_record_cli_cmd_stop   },
+    { .cmd = "dump",   .handler = motion_record_cli_cmd_dump   },
+};
+
+
+static half_t   g_halves[2] = {0};
+static uint32_t g_cur_half = 0;
+static bool     g_is_recording = false;
+static bool     g_is_last_reset = false;
+static bool     g_is_tick_time_valid = false; // Time of next tick is counted from g_tick_time_us
+static uint64_t g_tick_time_us = 0;
+static uint32_t g_stop_angles_hash = 0;     // Limbs angles on record end
+#endif // MOTION_RECORD_ENABLED
+
+
+
+/// ***************************************************************************
+/// @brief  Calculate hash of limbs angles
+/// @note   FNV-1a of coxa, femur and tibia angles bits
+/// @param  limbs: limbs (SUPPORT_LIMBS_COUNT items)
+/// @return hash
+/// ***************************************************************************
+uint32_t motion_record_hash_angles(const limb_t* limbs) {
+    uint32_t hash = FNV_OFFSET_BASIS;
+    for (uint32_t i = 0; i < SUPPORT_LIMBS_COUNT; ++i) {
+        const float angles[3] = { limbs[i].coxa.angle, limbs[i].femur.angle, limbs[i].tibia.angle };
+        const uint8_t* bytes = (const uint8_t*)angles;
+        for (uint32_t k = 0; k < sizeof(angles); ++k) {
+            hash = (hash ^ bytes[k]) * FNV_PRIME;
+        }
+    }
+    return hash;
+}
+
+#ifdef MOTION_RECORD_ENABLED
+/// ***************************************************************************
+/// @brief  Start recording
+/// @note   Previous record is cleared. Call between motion core ticks only:
+///         motion core state snapshot is taken here
+/// ***************************************************************************
+void motion_record_start(void) {
+    g_halves[0].size = 0;
+    g_halves[1].size = 0;
+    g_cur_half = 1;
+    g_is_last_reset = false;
+    switch_half();
+    g_is_recording = true;
+}
+
+/// ***************************************************************************
+/// @brief  Stop recording
+/// @note   Record is kept for dump. Call between motion core ticks only
+/// ***************************************************************************
+void motion_record_stop(void) {
+    if (g_is_recording) {
+        g_stop_angles_hash = motion_record_hash_angles(motion_core_get_limbs());
+    }
+    g_is_recording = false;
+}
+
+/// ***************************************************************************
+/// @brief  Check recording state
+/// @return true - record is in progress
+/// ***************************************************************************
+bool motion_record_is_recording(void) {
+    return g_is_recording;
+}
+
+/// ***************************************************************************
+/// @brief  Record external motion
+/// @note   Call on each external motion load. Repeated resets do not change
+///         motion core state and are recorded once
+/// @param  ext_motion: external motion, NULL - reset
+/// ***************************************************************************
+void motion_record_move(const ext_motion_t* ext_motion) {
+    if (!g_is_recording) return;
+
+    if (!ext_motion) {
+        if (!g_is_last_reset) {
+            uint8_t type = MOTION_RECORD_RESET;
+            write_record(&type, sizeof(type));
+            g_is_last_reset = true;
+        }
+        return;
+    }
+
+    motion_record_move_t record = {0};
+    record.type             = MOTION_RECORD_MOVE;
+    record.speed            = ext_motion->cfg.speed;
+    record.curvature        = ext_motion->cfg.curvature;
+    record.distance         = ext_motion->cfg.distance;
+    record.step_height      = ext_motion->cfg.step_height;
+    record.ctrl             = ext_motion->ctrl;
+    record.surface_point_x  = ext_motion->surface_point.x;
+    record.surface_point_y  = ext_motion->surface_point.y;
+    record.surface_point_z  = ext_motion->surface_point.z;
+    record.surface_rotate_x = ext_motion->surface_rotate.x;
+    record.surface_rotate_y = ext_motion->surface_rotate.y;
+    record.surface_rotate_z = ext_motion->surface_rotate.z;
+    write_record(&record, sizeof(record));
+    g_is_last_reset = false;
+}
+
+/// ***************************************************************************
+/// @brief  Prepare space for tick records
+/// @note   Call on motion core tick start before any state change. Half is
+///         switched here if tick records (external motion of script and
+///         tick inputs) may not fit into current half
+/// ***************************************************************************
+void motion_record_sync(void) {
+    if (!g_is_recording) return;
+
+    if (g_halves[g_cur_half].size + TICK_RESERVE_SIZE > HALF_SIZE) {
+        switch_half();
+    }
+}
+
+/// ***************************************************************************
+/// @brief  Record tick inputs
+/// @note   Tick duration is recorded. Time record is written before first
+///         tick of half and if tick duration does not fit to record
+/// @param  time_us: motion clock time
+/// @param  xz: hull orientation
+/// @param  is_contacts_valid, contacts_mask: foot contacts
+/// ***************************************************************************
+void motion_record_tick(uint64_t time_us, const float* xz, bool is_contacts_valid, uint32_t contacts_mask) {
+    if (!g_is_recording) return;
+
+    if (!g_is_tick_time_valid || time_us - g_tick_time_us > UINT16_MAX) {
+        motion_record_time_t time_record = {0};
+        time_record.type    = MOTION_RECORD_TIME;
+        time_record.time_us = time_us;
+        write_record(&time_record, sizeof(time_record));
+        g_tick_time_us = time_us;
+        g_is_tick_time_valid = true;
+    }
+
+    motion_record_tick_t record = {0};
+    record.type          = MOTION_RECORD_TICK;
+    record.dt_us         = (uint16_t)(time_us - g_tick_time_us);
+    record.orientation_x = xz[0];
+    record.orientation_z = xz[1];
+    record.foot_contacts = (uint8_t)(contacts_mask & ~MOTION_RECORD_CONTACTS_VALID);
+    if (is_contacts_valid) {
+        record.foot_contacts |= MOTION_RECORD_CONTACTS_VALID;
+    }
+    record.angles_hash   = motion_record_hash_angles(motion_core_get_limbs());
+    write_record(&record, sizeof(record));
+    g_tick_time_us = time_us;
+}
+
+/// ***************************************************************************
+/// @brief  Read record dump
+/// @note   Dump is header, state snapshot and records of older half and
+///         records of newer half. Stop recording before read
+/// @param  offset: dump offset
+/// @param  buffer: buffer for dump data
+/// @param  size: buffer size
+/// @return bytes count, 0 - end of dump
+/// ***************************************************************************
+uint32_t motion_record_read(uint32_t offset, uint8_t* buffer, uint32_t size) {
+    const half_t* newer = &g_halves[g_cur_half];
+    const half_t* older = &g_halves[g_cur_half ^ 1];
+    if (older->size == 0) {
+        older = newer;
+        newer = NULL;
+    }
+    if (older->size == 0) {
+        return 0; // Record is empty
+    }
+
+    motion_record_header_t header = {0};
+    header.magic        = MOTION_RECORD_MAGIC;
+    header.version      = MOTION_RECORD_VERSION;
+#ifdef MOTION_MATH_FIXED_POINT
+    header.flags        = MOTION_RECORD_FLAG_FIXED_POINT;
+#endif
+    header.state_size   = (uint16_t)older->state_size;
+    header.records_size = older->size - older->state_size;
+    if (newer) {
+        header.records_size += newer->size - newer->state_size;
+    }
+    header.angles_hash  = g_is_recording ? motion_record_hash_angles(motion_core_get_limbs()) : g_stop_angles_hash;
+
+    // Dump is sequence of segments
+    const uint8_t* segments[3] = { (const uint8_t*)&header, older->data, newer ? &newer->data[newer->state_size] : NULL };
+    uint32_t segment_sizes[3]  = { sizeof(header), older->size, newer ? newer->size - newer->state_size : 0 };
+    uint32_t bytes_count = 0;
+    for (uint32_t i = 0; i < 3 && bytes_count < size; ++i) {
+        if (offset >= segment_sizes[i]) {
+            offset -= segment_sizes[i];
+            continue;
+        }
+        uint32_t count = segment_sizes[i] - offset;
+        if (count > size - bytes_count) {
+            count = size - bytes_count;
+        }
+        memcpy(&buffer[bytes_count], &segments[i][offset], count);
+        bytes_count += count;
+        offset = 0;
+    }
+    return bytes_count;
+}
+
+/// ***************************************************************************
+/// @brief  Get command list for CLI
+/// @param  cmd_list: pointer to cmd list size
+/// @return command list
+/// ***************************************************************************
+const cli_cmd_t* motion_record_get_cmd_list(uint32_t* count) {
+    *count = sizeof(cli_cmd_list) / sizeof(cli_cmd_t);
+    return cli_cmd_list;
+}
+
+
+
+
+
+/// ***************************************************************************
+/// @brief  Switch to other half and take motion core state snapshot
+/// @note   Snapshot is taken between motion core ticks only. Half records
+///         start from time record, so replay can start from any half
+/// ***************************************************************************
+static void switch_half(void) {
+    g_cur_half ^= 1;
+    half_t* half = &g_halves[g_cur_half];
+    half->state_size = motion_core_save_state(half->data, sizeof(half->data));
+    half->size = half->state_size;
+    g_is_tick_time_valid = false;
+}
+
+/// ***************************************************************************
+/// @brief  Write record to current half
+/// @note   Half is switched if record does not fit. Switch is
+///         safe between motion core ticks, tick records are fitted into half
+///         by motion_record_sync()
+/// @param  record: record data
+/// @param  size: record size
+/// @return true - success, false - no space after half switch
+/// ***************************************************************************
+static bool write_record(const void* record, uint32_t size) {
+    if (g_halves[g_cur_half].size + size > HALF_SIZE) {
+        switch_half();
+    }
+    half_t* half = &g_halves[g_cur_half];
+    if (half->size + size > HALF_SIZE) {
+        return false;
+    }
+    memcpy(&half->data[half->size], record, size);
+    half->size += size;
+    return true;
+}
+
+
+
+
+
+// ***************************************************************************
+// CLI SECTION
+// ***************************************************************************
+CLI_CMD_HANDLER(motion_record_cli_cmd_help) {
+    const char* help = CLI_HELP(
+        "[MOTION RECORD]\r\n"
+        "  record status - print recorder status\r\n"
+        "  record start - clear record and start recording\r\n"
+        "  record stop - stop recording, record is kept\r\n"
+        "  record dump - stop recording and send binary dump, replay it by motion-replay host tool");
+    strcpy(response, help);
+    return true;
+}
+CLI_CMD_HANDLER(motion_record_cli_cmd_status) {
+    sprintf(response, CLI_OK("motion record status report")
+                      CLI_OK("    - recording: %d")
+                      CLI_OK("    - halves usage: %lu, %lu of %lu bytes")
+                      CLI_OK("    - current half: %lu"),
+            g_is_recording, g_halves[0].size, g_halves[1].size, (uint32_t)HALF_SIZE, g_cur_half);
+    return true;
+}
+CLI_CMD_HANDLER(motion_record_cli_cmd_start) {
+    motion_record_start();
+    strcpy(response, CLI_OK("recording is started"));
+    return true;
+}
+CLI_CMD_HANDLER(motion_record_cli_cmd_stop) {
+    motion_record_stop();
+    strcpy(response, CLI_OK("recording is stopped"));
+    return true;
+}
+CLI_CMD_HANDLER(motion_record_cli_cmd_dump) {
+    motion_record_stop();
+
+    uint8_t chunk[DUMP_CHUNK_SIZE];
+    uint32_t offset = 0;
+    uint32_t bytes_count = 0;
+    while ((bytes_count = motion_record_read(offset, chunk, sizeof(chunk))) != 0) {
+        cli_send_binary(chunk, bytes_count);
+        offset += bytes_count;
+    }
+    sprintf(response, CLI_OK("record dump is sent, %lu bytes"), offset);
+    return true;
+}
+#else
+
+// Recorder is disabled: motion core calls are empty, CLI has no record commands
+void motion_record_start(void) {}
+void motion_record_stop(void) {}
+bool motion_record_is_recording(void) { return false; }
+void motion_record_move(const ext_motion_t* ext_motion) {}
+void motion_record_sync(void) {}
+void motion_record_tick(uint64_t time_us, const float* xz, bool is_contacts_valid, uint32_t contacts_mask) {}
+uint32_t motion_record_read(uint32_t offset, uint8_t* buffer, uint32_t size) { return 0; }
+const cli_cmd_t* motion_record_get_cmd_list(uint32_t* count) {
+    *count = 0;
+    return NULL;
+}
+#endif // MOTION_RECORD_ENABLED
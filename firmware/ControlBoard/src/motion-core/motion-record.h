@@ -0,0 +1,97 @@
+/// ***************************************************************************
+/// @file    motion-record.h
+/// @author  NeoProg
+/// @brief   Motion core inputs recorder
+/// @note    Inputs of motion core are recorded to RAM ring buffer: external
+///          motions passed to motion_core_move() (repeated motions are
+///          skipped) and sensors and tick duration per tick. Ring
+///          buffer is two halves, each half starts from motion core state
+///          snapshot. Record is replayed from snapshot of older half by
+///          motion-replay host tool tick-exact. Recording is started by CLI
+///          "record start" and stopped on SYSMON_MATH_ERROR, record keeps
+///          inputs of failed tick
+/// @note    Recorder is built with MOTION_RECORD_ENABLED define only (host
+///          build enables it), otherwise it takes no RAM and CLI has no
+///          record commands. Buffer size can be defined by build
+/// @note    Dump format (little-endian, packed, float - IEEE754 binary32):
+///          motion_record_header_t, state_size bytes of motion core state,
+///          records_size bytes of records. Record starts from type byte
+/// ***************************************************************************
+#ifndef _MOTION_RECORD_H_
+#define _MOTION_RECORD_H_
+#include <stdint.h>
+#include <stdbool.h>
+#include "motion-core.h"
+#include "motion-math.h"
+#include "cli.h"
+
+#define MOTION_RECORD_MAGIC                 (0x524Du)   // "MR"
+#define MOTION_RECORD_VERSION               (0x01u)
+#define MOTION_RECORD_FLAG_FIXED_POINT      (0x01u)     // Recorded by MOTION_MATH_FIXED_POINT build
+#ifndef MOTION_RECORD_BUFFER_SIZE
+#define MOTION_RECORD_BUFFER_SIZE           (4096)      // Both halves, half keeps state snapshot (~0.7 KB) and records
+#endif
+
+#define MOTION_RECORD_TICK                  (0x01u)     // Motion core tick, motion_record_tick_t
+#define MOTION_RECORD_MOVE                  (0x02u)     // motion_core_move() call, motion_record_move_t
+#define MOTION_RECORD_RESET                 (0x03u)     // motion_core_move(NULL) call, type byte only
+#define MOTION_RECORD_TIME                  (0x04u)     // Motion clock time of next tick, motion_record_time_t
+
+#define MOTION_RECORD_CONTACTS_VALID        (0x80u)     // Foot contacts are valid, bits 0..5 - limbs mask
+
+
+#pragma pack(push, 1)
+typedef struct {
+    uint16_t magic;
+    uint8_t  version;
+    uint8_t  flags;
+    uint16_t state_size;
+    uint16_t reserved;
+    uint32_t records_size;
+    uint32_t angles_hash;       // Limbs angles on dump
+} motion_record_header_t;
+
+typedef struct {
+    uint8_t  type;
+    uint64_t time_us;           // Motion clock time, tick dt is counted from it
+} motion_record_time_t;
+
+typedef struct {
+    uint8_t  type;
+    uint16_t dt_us;             // Motion clock time from previous tick or time record
+    float    orientation_x;     // sensors_core_get_orientation()
+    float    orientation_z;
+    uint8_t  foot_contacts;     // sensors_core_get_foot_contacts()
+    uint32_t angles_hash;       // Limbs angles on tick start, @ref motion_record_hash_angles
+} motion_record_tick_t;
+
+typedef struct {
+    uint8_t  type;
+    uint16_t speed;
+    int16_t  curvature;
+    int16_t  distance;
+    uint16_t step_height;
+    uint16_t ctrl;
+    float    surface_point_x;
+    float    surface_point_y;
+    float    surface_point_z;
+    float    surface_rotate_x;
+    float    surface_rotate_y;
+    float    surface_rotate_z;
+} motion_record_move_t;
+#pragma pack(pop)
+
+
+extern void motion_record_start(void);
+extern void motion_record_stop(void);
+extern bool motion_record_is_recording(void);
+extern void motion_record_move(const ext_motion_t* ext_motion);
+extern void motion_record_sync(void);
+extern void motion_record_tick(uint64_t time_us, const float* xz, bool is_contacts_valid, uint32_t contacts_mask);
+extern uint32_t motion_record_read(uint32_t offset, uint8_t* buffer, uint32_t size);
+extern uint32_t motion_record_hash_angles(const limb_t* limbs);
+
+extern const cli_cmd_t* motion_record_get_cmd_list(uint32_t* count);
+
+
+#endif /* _MOTION_RECORD_H_ */
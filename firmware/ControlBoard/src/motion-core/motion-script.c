@@ -0,0 +1,364 @@
+/// ***************************************************************************
+/// @file    motion-script.c
+/// @author  NeoProg
+/// ***************************************************************************
+#include "project-base.h"
+#include "motion-script.h"
+#define SCRIPT(count)                       struct { motion_script_header_t header; motion_script_keyframe_t keyframes[count]; }
+#define SCRIPT_HEADER(flags, count)         { MOTION_SCRIPT_MAGIC, MOTION_SCRIPT_VERSION, (flags), (count) }
+#define KEYFRAME(ms, speed, curvature, distance, step_height, ctrl, px, py, pz, rx, ry, rz, interp) \
+    { (ms), (speed), (distance), (curvature), (step_height), (ctrl), (px), (py), (pz), (rx), (ry), (rz), (interp) }
+
+
+typedef struct {
+    uint8_t id;
+    const motion_script_header_t* header;
+    uint32_t size;
+} flash_script_t;
+
+
+static const motion_script_header_t* get_script(uint8_t script_id);
+static bool is_script_valid(const motion_script_header_t* header, uint32_t size);
+static void load_keyframe_motion(const motion_script_keyframe_t* keyframe, float t, ext_motion_t* ext_motion);
+static bool parse_hex(const char* str, uint8_t* data, uint32_t* size);
+
+CLI_CMD_HANDLER(motion_script_cli_cmd_help);
+CLI_CMD_HANDLER(motion_script_cli_cmd_status);
+CLI_CMD_HANDLER(motion_script_cli_cmd_play);
+CLI_CMD_HANDLER(motion_script_cli_cmd_stop);
+CLI_CMD_HANDLER(motion_script_cli_cmd_upload);
+
+static const cli_cmd_t cli_cmd_list[] = {
+    { .cmd = "help",   .handler = motion_script_cli_cmd_help   },
+    { .cmd = "status", .handler = motion_script_cli_cmd_status },
+    { .cmd = "play",   .handler = motion_script_cli_cmd_play   },
+    { .cmd = "stop",   .handler = motion_script_cli_cmd_stop   },
+    { .cmd = "upload", .handler = motion_script_cli_cmd_upload },
+};
+
+
+// Stand up from down position. Surface target is changed by step: limbs
+// are lifted by surface planner, intermediate heights are inhibited while down
+static const SCRIPT(1) g_stand_up_script = {
+    SCRIPT_HEADER(0, 1), {
+    //        ms    spd curv  dist step ctrl            point            rotate      interp
+    KEYFRAME(1500,  50,    0,    0, 30, MOTION_CTRL_NO,   0,  -85,   0,  0,   0,  0, MOTION_SCRIPT_INTERP_STEP),
+}};
+
+// Surface dance on place
+static const SCRIPT(7) g_dance_script = {
+    SCRIPT_HEADER(0, 7), {
+    //        ms    spd curv  dist step ctrl            point            rotate      interp
+    KEYFRAME(1500,  50,    0,    0, 30, MOTION_CTRL_NO,   0,  -85,   0,  0,   0,  0, MOTION_SCRIPT_INTERP_STEP),
+    KEYFRAME( 800, 100,    0,    0, 30, MOTION_CTRL_NO,  30, -100,   0,  5,   0, -5, MOTION_SCRIPT_INTERP_LINEAR),
+    KEYFRAME( 800, 100,    0,    0, 30, MOTION_CTRL_NO, -30, -100,   0, -5,   0,  5, MOTION_SCRIPT_INTERP_LINEAR),
+    KEYFRAME( 800, 100,    0,    0, 30, MOTION_CTRL_NO,   0,  -85,  30,  0,  15,  0, MOTION_SCRIPT_INTERP_LINEAR),
+    KEYFRAME( 800, 100,    0,    0, 30, MOTION_CTRL_NO,   0,  -85, -30,  0, -15,  0, MOTION_SCRIPT_INTERP_LINEAR),
+    KEYFRAME( 600, 100,    0,    0, 30, MOTION_CTRL_NO,   0, -120,   0,  0,   0,  0, MOTION_SCRIPT_INTERP_LINEAR),
+    KEYFRAME( 600, 100,    0,    0, 30, MOTION_CTRL_NO,   0,  -85,   0,  0,   0,  0, MOTION_SCRIPT_INTERP_LINEAR),
+}};
+
+// Walk by square: go forward and turn on place
+static const SCRIPT(2) g_walk_square_script = {
+    SCRIPT_HEADER(MOTION_SCRIPT_FLAG_LOOP, 2), {
+    //        ms    spd curv  dist step ctrl            point            rotate      interp
+    KEYFRAME(4000, 100,    1,  110, 30, MOTION_CTRL_NO,   0,  -85,   0,  0,   0,  0, MOTION_SCRIPT_INTERP_STEP),
+    KEYFRAME(2500, 100, 1000,   90, 30, MOTION_CTRL_NO,   0,  -85,   0,  0,   0,  0, MOTION_SCRIPT_INTERP_STEP),
+}};
+
+static const flash_script_t g_flash_scripts[] = {
+    { MOTION_SCRIPT_ID_STAND_UP,    &g_stand_up_script.header,    sizeof(g_stand_up_script)    },
+    { MOTION_SCRIPT_ID_DANCE,       &g_dance_script.header,       sizeof(g_dance_script)       },
+    { MOTION_SCRIPT_ID_WALK_SQUARE, &g_walk_square_script.header, sizeof(g_walk_square_script) },
+};
+
+static uint8_t g_ram_script[MOTION_SCRIPT_MAX_SIZE] = {0};
+
+static const motion_script_header_t* g_script = NULL;
+static uint8_t  g_script_id = MOTION_SCRIPT_ID_NO;
+static bool     g_is_start_pending = false;
+static uint32_t g_keyframe_index = 0;
+static uint64_t g_segment_start_time_us = 0;
+static p3d_t    g_segment_start_point = {0};
+static r3d_t    g_segment_start_rotate = {0};
+
+
+
+/// ***************************************************************************
+/// @brief  Start script playback
+/// @note   Playback is started by next motion_script_process() call from
+///         current motion, previous script is stopped
+/// @param  script_id: script identifier, MOTION_SCRIPT_ID_*
+/// @return true - success, false - script not found or invalid
+/// ***************************************************************************
+bool motion_script_play(uint8_t script_id) {
+    const motion_script_header_t* header = get_script(script_id);
+    if (!header) {
+        return false;
+    }
+    g_script = header;
+    g_script_id = script_id;
+    g_is_start_pending = true;
+    return true;
+}
+
+/// ***************************************************************************
+/// @brief  Stop script playback
+/// @note   Motion is left as is, it should be changed by caller
+/// ***************************************************************************
+void motion_script_stop(void) {
+    g_script = NULL;
+    g_script_id = MOTION_SCRIPT_ID_NO;
+    g_is_start_pending = false;
+}
+
+/// ***************************************************************************
+/// @brief  Check script playback state
+/// @return true - script is playing
+/// ***************************************************************************
+bool motion_script_is_playing(void) {
+    return g_script != NULL;
+}
+
+/// ***************************************************************************
+/// @brief  Get playing script
+/// @return script identifier or MOTION_SCRIPT_ID_NO
+/// ***************************************************************************
+uint8_t motion_script_get_id(void) {
+    return g_script_id;
+}
+
+/// ***************************************************************************
+/// @brief  Script playback process
+/// @note   Call each motion tick with motion clock time. Script time is not
+///         depended on communication, keyframes are passed by motion clock.
+///         Motion of last keyframe is returned with zero distance after
+///         script end
+/// @param  time_us: motion clock time
+/// @param  cur_motion: current motion, used as start point of playback
+/// @param  ext_motion: motion of script for time_us
+/// @retval ext_motion
+/// @return true - ext_motion is loaded, false - script is not playing
+/// ***************************************************************************
+bool motion_script_process(uint64_t time_us, const ext_motion_t* cur_motion, ext_motion_t* ext_motion) {
+    if (!g_script) {
+        return false;
+    }
+
+    const motion_script_keyframe_t* keyframes = (const motion_script_keyframe_t*)(g_script + 1);
+    if (g_is_start_pending) {
+        g_is_start_pending = false;
+        g_keyframe_index = 0;
+        g_segment_start_time_us = time_us;
+        g_segment_start_point = cur_motion->surface_point;
+        g_segment_start_rotate = cur_motion->surface_rotate;
+    }
+
+    // Pass completed segments. Loop scripts have nonzero duration
+    const motion_script_keyframe_t* keyframe = &keyframes[g_keyframe_index];
+    while (time_us - g_segment_start_time_us >= keyframe->duration_ms * 1000ull) {
+        g_segment_start_time_us += keyframe->duration_ms * 1000ull;
+        load_keyframe_motion(keyframe, 1.0f, ext_motion);
+        g_segment_start_point = ext_motion->surface_point;
+        g_segment_start_rotate = ext_motion->surface_rotate;
+
+        if (++g_keyframe_index >= g_script->keyframes_count) {
+            if (!(g_script->flags & MOTION_SCRIPT_FLAG_LOOP)) {
+                ext_motion->cfg.distance = 0;
+                motion_script_stop();
+                return true;
+            }
+            g_keyframe_index = 0;
+        }
+        keyframe = &keyframes[g_keyframe_index];
+    }
+
+    // Interpolate surface into segment
+    float t = 1.0f;
+    if (keyframe->interp == MOTION_SCRIPT_INTERP_LINEAR) {
+        t = (float)(time_us - g_segment_start_time_us) / (keyframe->duration_ms * 1000.0f);
+    }
+    load_keyframe_motion(keyframe, t, ext_motion);
+    return true;
+}
+
+/// ***************************************************************************
+/// @brief  Upload RAM script data
+/// @note   Upload is inhibited while RAM script is playing. Script is
+///         checked on playback start
+/// @param  offset: data offset into script
+/// @param  data: script data
+/// @param  size: data size
+/// @return true - success, false - error
+/// ***************************************************************************
+bool motion_script_upload(uint32_t offset, const uint8_t* data, uint32_t size) {
+    if (g_script_id == MOTION_SCRIPT_ID_RAM || offset > sizeof(g_ram_script) || size > sizeof(g_ram_script) - offset) {
+        return false;
+    }
+    memcpy(&g_ram_script[offset], data, size);
+    return true;
+}
+
+/// ***************************************************************************
+/// @brief  Get command list for CLI
+/// @param  cmd_list: pointer to cmd list size
+/// @return command list
+/// ***************************************************************************
+const cli_cmd_t* motion_script_get_cmd_list(uint32_t* count) {
+    *count = sizeof(cli_cmd_list) / sizeof(cli_cmd_t);
+    return cli_cmd_list;
+}
+
+
+
+
+
+/// ***************************************************************************
+/// @brief  Get script by identifier
+/// @param  script_id: script identifier
+/// @return script header or NULL if script not found or invalid
+/// ***************************************************************************
+static const motion_script_header_t* get_script(uint8_t script_id) {
+    if (script_id == MOTION_SCRIPT_ID_RAM) {
+        const motion_script_header_t* header = (const motion_script_header_t*)g_ram_script;
+        return is_script_valid(header, sizeof(g_ram_script)) ? header : NULL;
+    }
+    for (uint32_t i = 0; i < sizeof(g_flash_scripts) / sizeof(g_flash_scripts[0]); ++i) {
+        if (g_flash_scripts[i].id == script_id) {
+            return is_script_valid(g_flash_scripts[i].header, g_flash_scripts[i].size) ? g_flash_scripts[i].header : NULL;
+        }
+    }
+    return NULL;
+}
+
+/// ***************************************************************************
+/// @brief  Check script
+/// @param  header: script header
+/// @param  size: script storage size
+/// @return true - script is valid
+/// ***************************************************************************
+static bool is_script_valid(const motion_script_header_t* header, uint32_t size) {
+    if (header->magic != MOTION_SCRIPT_MAGIC || header->version != MOTION_SCRIPT_VERSION) {
+        return false;
+    }
+    if (header->keyframes_count == 0 || header->keyframes_count > (size - sizeof(motion_script_header_t)) / sizeof(motion_script_keyframe_t)) {
+        return false;
+    }
+
+    // Loop script without duration never passes keyframes
+    const motion_script_keyframe_t* keyframes = (const motion_script_keyframe_t*)(header + 1);
+    uint32_t duration_ms = 0;
+    for (uint32_t i = 0; i < header->keyframes_count; ++i) {
+        if (keyframes[i].interp != MOTION_SCRIPT_INTERP_LINEAR && keyframes[i].interp != MOTION_SCRIPT_INTERP_STEP) {
+            return false;
+        }
+        duration_ms += keyframes[i].duration_ms;
+    }
+    return !(header->flags & MOTION_SCRIPT_FLAG_LOOP) || duration_ms != 0;
+}
+
+/// ***************************************************************************
+/// @brief  Load motion of keyframe segment
+/// @param  keyframe: segment keyframe
+/// @param  t: segment progress [0; 1], surface is moved from segment start
+/// @param  ext_motion: motion
+/// @retval ext_motion
+/// ***************************************************************************
+static void load_keyframe_motion(const motion_script_keyframe_t* keyframe, float t, ext_motion_t* ext_motion) {
+    ext_motion->cfg.speed       = keyframe->speed;
+    ext_motion->cfg.curvature   = keyframe->curvature;
+    ext_motion->cfg.distance    = keyframe->distance;
+    ext_motion->cfg.step_height = keyframe->step_height;
+    ext_motion->ctrl            = keyframe->motion_ctrl;
+
+    ext_motion->surface_point.x  = g_segment_start_point.x  + (keyframe->surface_point_x  - g_segment_start_point.x)  * t;
+    ext_motion->surface_point.y  = g_segment_start_point.y  + (keyframe->surface_point_y  - g_segment_start_point.y)  * t;
+    ext_motion->surface_point.z  = g_segment_start_point.z  + (keyframe->surface_point_z  - g_segment_start_point.z)  * t;
+    ext_motion->surface_rotate.x = g_segment_start_rotate.x + (keyframe->surface_rotate_x - g_segment_start_rotate.x) * t;
+    ext_motion->surface_rotate.y = g_segment_start_rotate.y + (keyframe->surface_rotate_y - g_segment_start_rotate.y) * t;
+    ext_motion->surface_rotate.z = g_segment_start_rotate.z + (keyframe->surface_rotate_z - g_segment_start_rotate.z) * t;
+}
+
+/// ***************************************************************************
+/// @brief  Convert hex string to bytes
+/// @param  str: hex string, two digits per byte
+/// @param  data: bytes buffer (CLI_ARG_MAX_SIZE / 2 bytes)
+/// @param  size: bytes count
+/// @retval data
+/// @retval size
+/// @return true - success, false - bad string
+/// ***************************************************************************
+static bool parse_hex(const char* str, uint8_t* data, uint32_t* size) {
+    uint32_t length = strlen(str);
+    if (length % 2 != 0) {
+        return false;
+    }
+    for (uint32_t i = 0; i < length; ++i) {
+        char c = str[i];
+        uint8_t nibble = 0;
+        if (c >= '0' && c <= '9')      nibble = c - '0';
+        else if (c >= 'a' && c <= 'f') nibble = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') nibble = c - 'A' + 10;
+        else return false;
+        data[i / 2] = (i % 2) ? (data[i / 2] | nibble) : (nibble << 4);
+    }
+    *size = length / 2;
+    return true;
+}
+
+
+
+
+
+// ***************************************************************************
+// CLI SECTION
+// ***************************************************************************
+CLI_CMD_HANDLER(motion_script_cli_cmd_help) {
+    const char* help = CLI_HELP(
+        "[MOTION SCRIPT]\r\n"
+        "  script status - print playback status\r\n"
+        "  script play <id> - play script: 1 - uploaded, 2 - stand up, 3 - dance, 4 - walk by square\r\n"
+        "  script stop - stop playback, motion is returned to external control\r\n"
+        "  script upload <offset> <hex data> - write uploaded script data, up to 31 bytes per command");
+    strcpy(response, help);
+    return true;
+}
+CLI_CMD_HANDLER(motion_script_cli_cmd_status) {
+    sprintf(response, CLI_OK("motion script status report")
+                      CLI_OK("    - script: %u")
+                      CLI_OK("    - keyframe: %lu"),
+            g_script_id, g_script ? g_keyframe_index : 0);
+    return true;
+}
+CLI_CMD_HANDLER(motion_script_cli_cmd_play) {
+    if (argc != 1) {
+        strcpy(response, CLI_ERROR("Bad usage. Use \"script help\" for details"));
+        return false;
+    }
+    if (!motion_script_play((uint8_t)atoi(argv[0]))) {
+        strcpy(response, CLI_ERROR("Script not found or invalid"));
+        return false;
+    }
+    sprintf(response, CLI_OK("script %u is started"), g_script_id);
+    return true;
+}
+CLI_CMD_HANDLER(motion_script_cli_cmd_stop) {
+    motion_script_stop();
+    strcpy(response, CLI_OK("script is stopped"));
+    return true;
+}
+CLI_CMD_HANDLER(motion_script_cli_cmd_upload) {
+    uint8_t data[CLI_ARG_MAX_SIZE / 2] = {0};
+    uint32_t size = 0;
+    if (argc != 2 || !parse_hex(argv[1], data, &size)) {
+        strcpy(response, CLI_ERROR("Bad usage. Use \"script help\" for details"));
+        return false;
+    }
+    uint32_t offset = (uint32_t)atoi(argv[0]);
+    if (!motion_script_upload(offset, data, size)) {
+        strcpy(response, CLI_ERROR("Out of script memory or uploaded script is playing"));
+        return false;
+    }
+    sprintf(response, CLI_OK("%lu bytes are written at %lu"), size, offset);
+    return true;
+}
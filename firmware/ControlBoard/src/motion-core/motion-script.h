@@ -0,0 +1,75 @@
+/// ***************************************************************************
+/// @file    motion-script.h
+/// @author  NeoProg
+/// @brief   Keyframe motion scripts
+/// @note    Script is compact binary sequence of keyframes (little-endian,
+///          packed): header and keyframes. Keyframe contains surface point
+///          and rotate which should be reached at end of keyframe segment
+///          and motion configuration which is active during segment.
+///          Surface is interpolated between keyframes by motion clock,
+///          configuration is changed by steps. Scripts are stored in flash
+///          or uploaded to RAM by CLI
+/// ***************************************************************************
+#ifndef _MOTION_SCRIPT_H_
+#define _MOTION_SCRIPT_H_
+#include <stdint.h>
+#include <stdbool.h>
+#include "motion-core.h"
+#include "cli.h"
+
+#define MOTION_SCRIPT_MAGIC                 (0x534Du)   // "MS"
+#define MOTION_SCRIPT_VERSION               (0x01u)
+#define MOTION_SCRIPT_FLAG_LOOP             (0x01u)     // Restart from first keyframe after last one
+#define MOTION_SCRIPT_MAX_KEYFRAMES         (32)        // Keyframes count of RAM script
+
+#define MOTION_SCRIPT_INTERP_LINEAR         (0x00u)     // Surface moved linearly during segment
+#define MOTION_SCRIPT_INTERP_STEP           (0x01u)     // Surface target changed at segment start
+
+#define MOTION_SCRIPT_ID_NO                 (0x00u)
+#define MOTION_SCRIPT_ID_RAM                (0x01u)     // Script uploaded by CLI
+#define MOTION_SCRIPT_ID_STAND_UP           (0x02u)
+#define MOTION_SCRIPT_ID_DANCE              (0x03u)
+#define MOTION_SCRIPT_ID_WALK_SQUARE        (0x04u)
+
+
+#pragma pack(push, 1)
+typedef struct {
+    uint16_t magic;
+    uint8_t  version;
+    uint8_t  flags;
+    uint16_t keyframes_count;
+} motion_script_header_t;
+
+typedef struct {
+    uint16_t duration_ms;       // Segment duration, time to reach keyframe surface from previous one
+    // Motion configuration, see ext_motion_t
+    uint8_t  speed;
+    int8_t   distance;
+    int16_t  curvature;
+    uint8_t  step_height;
+    uint8_t  motion_ctrl;       // MOTION_CTRL_* flags
+    // Surface at segment end
+    int16_t  surface_point_x;   // [mm]
+    int16_t  surface_point_y;
+    int16_t  surface_point_z;
+    int8_t   surface_rotate_x;  // [deg]
+    int8_t   surface_rotate_y;
+    int8_t   surface_rotate_z;
+    uint8_t  interp;            // MOTION_SCRIPT_INTERP_*
+} motion_script_keyframe_t;
+#pragma pack(pop)
+
+#define MOTION_SCRIPT_MAX_SIZE              (sizeof(motion_script_header_t) + MOTION_SCRIPT_MAX_KEYFRAMES * sizeof(motion_script_keyframe_t))
+
+
+extern bool motion_script_play(uint8_t script_id);
+extern void motion_script_stop(void);
+extern bool motion_script_is_playing(void);
+extern uint8_t motion_script_get_id(void);
+extern bool motion_script_process(uint64_t time_us, const ext_motion_t* cur_motion, ext_motion_t* ext_motion);
+extern bool motion_script_upload(uint32_t offset, const uint8_t* data, uint32_t size);
+
+extern const cli_cmd_t* motion_script_get_cmd_list(uint32_t* count);
+
+
+#endif /* _MOTION_SCRIPT_H_ */
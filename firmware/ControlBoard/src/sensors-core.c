@@ -61,6 +61,29 @@ void sensors_core_get_orientation(float* xz) {
     }
 }
 
+/// ***************************************************************************
+/// @brief  Get foot contacts state
+/// @param  limbs_mask: limbs with foot contact, bit N -- limb N (0-2 left
+///         side, 3-5 right side, from front)
+/// @return true - foot sensors are available, false - PCA9555 is disabled
+/// ***************************************************************************
+bool sensors_core_get_foot_contacts(uint32_t* limbs_mask) {
+    static const uint16_t limbs_sensors[] = {
+        PCA9555_GPIO_SENSOR_LEFT_1,  PCA9555_GPIO_SENSOR_LEFT_2,  PCA9555_GPIO_SENSOR_LEFT_3,
+        PCA9555_GPIO_SENSOR_RIGHT_1, PCA9555_GPIO_SENSOR_RIGHT_2, PCA9555_GPIO_SENSOR_RIGHT_3
+    };
+    *limbs_mask = 0;
+    if (sysmon_is_module_disable(SYSMON_MODULE_PCA9555)) {
+        return false;
+    }
+    for (uint32_t i = 0; i < sizeof(limbs_sensors) / sizeof(limbs_sensors[0]); ++i) {
+        if (sensors_inputs & limbs_sensors[i]) {
+            *limbs_mask |= (1 << i);
+        }
+    }
+    return true;
+}
+
 
 void sensors_core_process(void) {
     if (!sysmon_is_module_disable(SYSMON_MODULE_PCA9555) && pca9555_is_input_changed()) {
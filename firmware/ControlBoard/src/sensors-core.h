@@ -9,6 +9,7 @@
 extern void sensors_core_init(void);
 extern bool sensors_core_calibration_process(void);
 extern void sensors_core_get_orientation(float* xy);
+extern bool sensors_core_get_foot_contacts(uint32_t* limbs_mask);
 extern void sensors_core_process(void);
 
 #endif // _SENSORS_CORE_H_
@@ -49,6 +49,7 @@ CLI_CMD_HANDLER(servo_cli_cmd_logging);
 CLI_CMD_HANDLER(servo_cli_cmd_calibration);
 CLI_CMD_HANDLER(servo_cli_cmd_set);
 CLI_CMD_HANDLER(servo_cli_cmd_reset);
+CLI_CMD_HANDLER(servo_cli_cmd_pwm_stats);
 
 static const cli_cmd_t cli_cmd_list[] = {
     { .cmd = "help",        .handler = servo_cli_cmd_help        },
@@ -57,7 +58,8 @@ static const cli_cmd_t cli_cmd_list[] = {
     { .cmd = "logging",     .handler = servo_cli_cmd_logging     },
     { .cmd = "calibration", .handler = servo_cli_cmd_calibration },
     { .cmd = "set",         .handler = servo_cli_cmd_set         },
-    { .cmd = "reset",       .handler = servo_cli_cmd_reset       }
+    { .cmd = "reset",       .handler = servo_cli_cmd_reset       },
+    { .cmd = "pwm-stats",   .handler = servo_cli_cmd_pwm_stats   }
 };
 
 
@@ -117,17 +119,6 @@ void servo_driver_power_off(void) {
     pwm_set_state(false);
 }
 
-/// ***************************************************************************
-/// @brief  Set servo speed
-/// @param  speed: speed [0; 100]
-/// ***************************************************************************
-void servo_driver_set_speed(uint32_t speed) {
-    speed = (speed > 100) ? 100 : speed;
-    float factor = (float)speed / 100.0f;
-    uint32_t freq = (uint32_t)(PWM_MIN_FREQUENCY_HZ + (float)(PWM_MAX_FREQUENCY_HZ - PWM_MIN_FREQUENCY_HZ) * factor);
-    pwm_set_frequency(freq);
-}
-
 /// ***************************************************************************
 /// @brief  Servo driver process
 /// @note   Call each PWM period
@@ -307,7 +298,8 @@ CLI_CMD_HANDLER(servo_cli_cmd_help) {
         "  servo calibration - move all servos to logic zero\r\n"
         "  servo status <servo idx> - print servo status\r\n"
         "  servo set <servo idx> <zero-trim|logic|physic|pulse> <value> - move servo\r\n"
-        "  servo reset [servo idx] return servo to subsystem control");
+        "  servo reset [servo idx] return servo to subsystem control\r\n"
+        "  servo pwm-stats [reset] - print/reset PWM edge timing (debug build)");
     if (strlen(response) >= USART1_TX_BUFFER_SIZE) {
         strcpy(response, CLI_ERROR("Help message size more USART1_TX_BUFFER_SIZE"));
         return false;
@@ -404,3 +396,37 @@ CLI_CMD_HANDLER(servo_cli_cmd_reset) {
     }
     return true;
 }
+CLI_CMD_HANDLER(servo_cli_cmd_pwm_stats) {
+#ifndef NDEBUG
+    if (argc >= 1 && strcmp(argv[0], "reset") == 0) {
+        pwm_reset_stats();
+        strcpy(response, CLI_OK("PWM statistics is reset"));
+        return true;
+    }
+    
+    // Error and latency in us, mean in ns. Bins: <0, 0, 1, 2, 3-4, 5-8, 9-16, >16 us
+    const pwm_stats_t* stats = pwm_get_stats();
+    if (!stats) {
+        sprintf(response, CLI_ERROR("PWM edges are not measured on this target, overruns %lu"), pwm_get_overruns_count());
+        return false;
+    }
+    response += sprintf(response, CLI_OK("PWM edge timing report, overruns %lu")
+                                  CLI_OK("     ch  count  min  max  mean(ns)  bins"),
+                        pwm_get_overruns_count());
+    for (uint32_t i = 0; i <= SUPPORT_PWM_CHANNELS_COUNT; ++i) {
+        const pwm_timing_t* t = (i < SUPPORT_PWM_CHANNELS_COUNT) ? &stats->edge_error[i] : &stats->isr_latency;
+        int32_t mean_ns = (t->count != 0) ? (int32_t)(t->sum * 1000 / t->count) : 0;
+        char name[8] = "isr";
+        if (i < SUPPORT_PWM_CHANNELS_COUNT) {
+            sprintf(name, "%lu", i);
+        }
+        response += sprintf(response, CLI_OK("    %3s %6lu %4ld %4ld %9ld  %lu %lu %lu %lu %lu %lu %lu %lu"),
+                            name, t->count, t->min, t->max, mean_ns,
+                            t->bins[0], t->bins[1], t->bins[2], t->bins[3], t->bins[4], t->bins[5], t->bins[6], t->bins[7]);
+    }
+    return true;
+#else
+    strcpy(response, CLI_ERROR("PWM statistics is available in debug build only"));
+    return false;
+#endif
+}
@@ -13,7 +13,6 @@
 extern void servo_driver_init(void); 
 extern void servo_driver_power_on(void);
 extern void servo_driver_power_off(void);
-extern void servo_driver_set_speed(uint32_t speed);
 extern void servo_driver_move(uint32_t ch, float angle);
 extern void servo_driver_process(void);
 
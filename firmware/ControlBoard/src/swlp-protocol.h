@@ -13,6 +13,16 @@
 // Motion ctrl flags
 #define SWLP_MOTION_CTRL_NO             (0x0000u)
 #define SWLP_MOTION_CTRL_EN_STAB        (0x0001u)
+#define SWLP_MOTION_CTRL_GAIT_MASK      (0x0006u)
+#define SWLP_MOTION_CTRL_GAIT_TRIPOD    (0x0000u)
+#define SWLP_MOTION_CTRL_GAIT_RIPPLE    (0x0002u)
+#define SWLP_MOTION_CTRL_GAIT_WAVE      (0x0004u)
+#define SWLP_MOTION_CTRL_EN_TERRAIN     (0x0008u)
+
+// Motion script control. Script is started on change of request field,
+// other values are motion script identifiers
+#define SWLP_SCRIPT_NO                  (0x00u)
+#define SWLP_SCRIPT_STOP                (0xFFu)
 
 
 #pragma pack(push, 1)
@@ -37,7 +47,8 @@ typedef struct {
     int16_t surface_rotate_x;
     int16_t surface_rotate_y;
     int16_t surface_rotate_z;
-    uint8_t reserved[6];
+    uint8_t script;
+    uint8_t reserved[5];
 } swlp_request_t;
 
 typedef struct {
@@ -58,7 +69,7 @@ typedef struct {
     int16_t surface_rotate_x;
     int16_t surface_rotate_y;
     int16_t surface_rotate_z;
-    uint8_t reserved[1];
+    uint8_t script;             // Playing motion script
 } swlp_response_t;
 #pragma pack(pop)
 
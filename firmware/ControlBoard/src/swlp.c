@@ -10,6 +10,7 @@
 #include "system-monitor.h"
 #include "servo-driver.h"
 #include "motion-core.h"
+#include "motion-script.h"
 #include "systimer.h"
 #include <math.h>
 #define COMMUNICATION_BAUD_RATE                     (115200)
@@ -26,6 +27,7 @@ typedef enum {
 
 static state_t state = STATE_NO_INIT;
 static uint32_t received_frame_size = 0;
+static uint8_t last_script = SWLP_SCRIPT_NO;
 
 
 static void frame_received_callback(uint32_t frame_size);
@@ -73,6 +75,16 @@ void swlp_process(void) {
         swlp_response_t* response = (swlp_response_t*)swlp_tx_frame->payload;
         memset(swlp_tx_frame, 0, sizeof(swlp_frame_t));
         
+        // Process motion script control. Motion parameters are ignored while script is playing
+        if (request->script != last_script) {
+            if (request->script == SWLP_SCRIPT_STOP) {
+                motion_script_stop();
+            } else if (request->script != SWLP_SCRIPT_NO) {
+                motion_script_play(request->script);
+            }
+            last_script = request->script;
+        }
+        
         // Process motion parameters
         ext_motion_t motion = {0};
         motion.cfg.speed = request->speed;
@@ -107,6 +119,7 @@ void swlp_process(void) {
         response->surface_rotate_x = (int16_t)motion.surface_rotate.x;
         response->surface_rotate_y = (int16_t)motion.surface_rotate.y;
         response->surface_rotate_z = (int16_t)motion.surface_rotate.z;
+        response->script = motion_script_get_id();
 
         // Prepare response
         swlp_tx_frame->start_mark = SWLP_START_MARK_VALUE;
@@ -10,7 +10,7 @@
 #define SYSMON_FATAL_ERROR              (0x01)                          // Not resettable (enter to emergency loop)
 #define SYSMON_INTERNAL_ERROR           (0x02 | SYSMON_FATAL_ERROR)     // Not resettable (enter to emergency loop)
 #define SYSMON_VOLTAGE_ERROR            (0x04)                          // Not resettable
-#define SYSMON_SYNC_ERROR               (0x08)                          // Not resettable
+#define SYSMON_SYNC_ERROR               (0x08)                          // Resettable (PWM overruns, cleared by PWM driver)
 #define SYSMON_MATH_ERROR               (0x10)                          // Resettable
 #define SYSMON_I2C_ERROR                (0x20)                          // Not resettable
 #define SYSMON_CALIBRATION              (0x40)                          // Resettable